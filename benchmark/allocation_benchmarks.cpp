@@ -0,0 +1,163 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "planning/lane_follow_planner.hpp"
+#include "planning/optinlc_trajectory_optimizer.hpp"
+#include "planning/optinlc_trajectory_planner.hpp"
+#include "planning/safety_corridor_planner.hpp"
+#include "scenarios.hpp"
+
+// Heap allocations of the steady state plan_trajectory_into calls. The global operator new of this executable counts
+// every allocation while counting is on, which is why these benchmarks have their own target and do not distort the
+// latency benchmarks. The OptiNLC solver getters return their results by value, so the OCP planners keep a small
+// constant number of allocations per cycle, it must not grow with the number of cycles.
+
+namespace
+{
+std::atomic<bool>   counting{ false };
+std::atomic<size_t> allocations{ 0 };
+} // namespace
+
+void*
+operator new( std::size_t size )
+{
+  if( counting.load( std::memory_order_relaxed ) )
+    allocations.fetch_add( 1, std::memory_order_relaxed );
+  if( void* pointer = std::malloc( size ? size : 1 ) )
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void*
+operator new[]( std::size_t size )
+{
+  return operator new( size );
+}
+
+void
+operator delete( void* pointer ) noexcept
+{
+  std::free( pointer );
+}
+
+void
+operator delete[]( void* pointer ) noexcept
+{
+  std::free( pointer );
+}
+
+void
+operator delete( void* pointer, std::size_t ) noexcept
+{
+  std::free( pointer );
+}
+
+void
+operator delete[]( void* pointer, std::size_t ) noexcept
+{
+  std::free( pointer );
+}
+
+namespace adore
+{
+namespace planner
+{
+namespace bench
+{
+
+// Runs plan once to reach the steady state, then counts the allocations of every further call. Reported as
+// allocations_per_cycle, the mean over the benchmark iterations, and max_allocations, the largest count of one call.
+template<typename Plan>
+static void
+count_allocations( benchmark::State& state, Plan&& plan )
+{
+  plan();
+  size_t total   = 0;
+  size_t largest = 0;
+  size_t cycles  = 0;
+  for( auto _ : state )
+  {
+    allocations.store( 0, std::memory_order_relaxed );
+    counting.store( true, std::memory_order_relaxed );
+    plan();
+    counting.store( false, std::memory_order_relaxed );
+    size_t count  = allocations.load( std::memory_order_relaxed );
+    total        += count;
+    largest       = std::max( largest, count );
+    cycles++;
+  }
+  state.counters["allocations_per_cycle"] = cycles > 0 ? static_cast<double>( total ) / cycles : 0.0;
+  state.counters["max_allocations"]       = static_cast<double>( largest );
+}
+
+static void
+optinlc_trajectory_planner_allocations( benchmark::State& state, ScenarioType type )
+{
+  auto                     scenario = make_scenario( type );
+  OptiNLCTrajectoryPlanner planner;
+  dynamics::Trajectory     trajectory;
+  count_allocations( state, [&]() {
+    planner.plan_trajectory_into( trajectory, scenario.route, scenario.ego_state, scenario.map, scenario.traffic );
+    benchmark::DoNotOptimize( trajectory );
+  } );
+}
+
+static void
+safety_corridor_planner_allocations( benchmark::State& state, ScenarioType type )
+{
+  auto                  scenario = make_scenario( type );
+  SafetyCorridorPlanner planner;
+  dynamics::Trajectory  trajectory;
+  count_allocations( state, [&]() {
+    planner.plan_trajectory_into( trajectory, scenario.left_border, scenario.right_border, scenario.ego_state );
+    benchmark::DoNotOptimize( trajectory );
+  } );
+}
+
+static void
+optinlc_trajectory_optimizer_allocations( benchmark::State& state, ScenarioType type )
+{
+  auto                       scenario = make_scenario( type );
+  OptiNLCTrajectoryOptimizer optimizer;
+  dynamics::Trajectory       trajectory;
+  count_allocations( state, [&]() {
+    optimizer.plan_trajectory_into( trajectory, scenario.reference_trajectory, scenario.ego_state );
+    benchmark::DoNotOptimize( trajectory );
+  } );
+}
+
+static void
+lane_follow_planner_allocations( benchmark::State& state, ScenarioType type )
+{
+  auto                 scenario = make_scenario( type );
+  LaneFollowPlanner    planner;
+  dynamics::Trajectory trajectory;
+  count_allocations( state, [&]() {
+    planner.plan_trajectory_into( trajectory, scenario.ego_state, scenario.route_points, scenario.map, scenario.limits );
+    benchmark::DoNotOptimize( trajectory );
+  } );
+}
+
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_allocations, straight, ScenarioType::straight );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_allocations, dense_traffic, ScenarioType::dense_traffic );
+BENCHMARK_CAPTURE( safety_corridor_planner_allocations, straight, ScenarioType::straight );
+BENCHMARK_CAPTURE( optinlc_trajectory_optimizer_allocations, straight, ScenarioType::straight );
+BENCHMARK_CAPTURE( lane_follow_planner_allocations, straight, ScenarioType::straight );
+
+} // namespace bench
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,80 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include "planning/multi_agent_PID.hpp"
+#include "planning/planning_helpers.hpp"
+#include "scenarios.hpp"
+
+namespace adore
+{
+namespace planner
+{
+namespace bench
+{
+
+// state.range( 0 ) vehicles per neighbouring lane
+static void
+multi_agent_pid( benchmark::State& state, ScenarioType type )
+{
+  auto          road_type = type == ScenarioType::curve ? ScenarioType::curve : ScenarioType::straight;
+  auto          traffic   = make_traffic( road_type, static_cast<int>( state.range( 0 ) ) );
+  MultiAgentPID planner;
+  planner.set_parameters( {} );
+  LatencyRecorder recorder( state );
+  for( auto _ : state )
+  {
+    // plan_trajectories overwrites the trajectories and speeds, every call starts from the same set
+    auto participants = traffic;
+    recorder.measure( [&]() {
+      planner.plan_trajectories( participants );
+      benchmark::DoNotOptimize( participants );
+    } );
+  }
+  state.counters["participants"] = static_cast<double>( traffic.participants.size() );
+  recorder.report();
+}
+
+static void
+waypoints_to_trajectory( benchmark::State& state, ScenarioType type )
+{
+  auto            scenario = make_scenario( type );
+  auto            model    = make_vehicle_model();
+  LatencyRecorder recorder( state );
+  for( auto _ : state )
+  {
+    recorder.measure( [&]() {
+      auto trajectory = planner::waypoints_to_trajectory( scenario.ego_state, scenario.route_points, 0.1, ego_speed, scenario.limits,
+                                                          scenario.traffic, model );
+      benchmark::DoNotOptimize( trajectory );
+    } );
+  }
+  recorder.report();
+}
+
+BENCHMARK_CAPTURE( multi_agent_pid, straight, ScenarioType::straight )
+  ->RangeMultiplier( 2 )
+  ->Range( 1, 64 )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( multi_agent_pid, curve, ScenarioType::curve )->RangeMultiplier( 2 )->Range( 1, 64 )->UseManualTime()->Unit( benchmark::kMillisecond );
+
+BENCHMARK_CAPTURE( waypoints_to_trajectory, straight, ScenarioType::straight )->UseManualTime()->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( waypoints_to_trajectory, curve, ScenarioType::curve )->UseManualTime()->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( waypoints_to_trajectory, dense_traffic, ScenarioType::dense_traffic )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+
+} // namespace bench
+} // namespace planner
+} // namespace adore
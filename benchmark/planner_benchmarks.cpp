@@ -0,0 +1,144 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include "planning/lane_follow_planner.hpp"
+#include "planning/batch_planner.hpp"
+#include "planning/optinlc_trajectory_optimizer.hpp"
+#include "planning/optinlc_trajectory_planner.hpp"
+#include "planning/safety_corridor_planner.hpp"
+#include "scenarios.hpp"
+
+namespace adore
+{
+namespace planner
+{
+namespace bench
+{
+
+// The planners keep their previous solution, so after the first iteration every call is a steady state replanning cycle
+
+static void
+optinlc_trajectory_planner( benchmark::State& state, ScenarioType type )
+{
+  auto                     scenario = make_scenario( type );
+  OptiNLCTrajectoryPlanner planner;
+  LatencyRecorder          recorder( state );
+  for( auto _ : state )
+  {
+    recorder.measure( [&]() {
+      auto trajectory = planner.plan_trajectory( scenario.route, scenario.ego_state, scenario.map, scenario.traffic );
+      benchmark::DoNotOptimize( trajectory );
+    } );
+  }
+  recorder.report();
+}
+
+static void
+safety_corridor_planner( benchmark::State& state, ScenarioType type )
+{
+  auto                  scenario = make_scenario( type );
+  SafetyCorridorPlanner planner;
+  LatencyRecorder       recorder( state );
+  for( auto _ : state )
+  {
+    recorder.measure( [&]() {
+      auto trajectory = planner.plan_trajectory( scenario.left_border, scenario.right_border, scenario.ego_state );
+      benchmark::DoNotOptimize( trajectory );
+    } );
+  }
+  recorder.report();
+}
+
+static void
+optinlc_trajectory_optimizer( benchmark::State& state, ScenarioType type )
+{
+  auto                       scenario = make_scenario( type );
+  OptiNLCTrajectoryOptimizer optimizer;
+  LatencyRecorder            recorder( state );
+  for( auto _ : state )
+  {
+    recorder.measure( [&]() {
+      auto trajectory = optimizer.plan_trajectory( scenario.reference_trajectory, scenario.ego_state );
+      benchmark::DoNotOptimize( trajectory );
+    } );
+  }
+  recorder.report();
+}
+
+static void
+lane_follow_planner( benchmark::State& state, ScenarioType type )
+{
+  auto              scenario = make_scenario( type );
+  LaneFollowPlanner planner;
+  LatencyRecorder   recorder( state );
+  for( auto _ : state )
+  {
+    recorder.measure( [&]() {
+      auto trajectory = planner.plan_trajectory( scenario.ego_state, scenario.route_points, scenario.map, scenario.limits );
+      benchmark::DoNotOptimize( trajectory );
+    } );
+  }
+  recorder.report();
+}
+
+// state.range( 0 ) vehicles on the scenario route planned per batch on state.range( 1 ) threads
+static void
+batch_lane_follow_planner( benchmark::State& state, ScenarioType type )
+{
+  auto                   scenario = make_scenario( type );
+  BatchLaneFollowPlanner planner( static_cast<size_t>( state.range( 1 ) ) );
+  planner.limits = scenario.limits;
+
+  std::vector<BatchPlanningJob> jobs( static_cast<size_t>( state.range( 0 ) ) );
+  for( size_t i = 0; i < jobs.size(); ++i )
+  {
+    jobs[i].vehicle_id   = static_cast<int>( i );
+    jobs[i].state        = scenario.ego_state;
+    jobs[i].route_points = &scenario.route_points;
+  }
+
+  LatencyRecorder recorder( state );
+  for( auto _ : state )
+  {
+    recorder.measure( [&]() {
+      planner.plan( jobs, scenario.map, scenario.traffic );
+      benchmark::DoNotOptimize( planner.get_trajectories() );
+    } );
+  }
+  state.counters["vehicles_per_s"] = benchmark::Counter( static_cast<double>( jobs.size() ), benchmark::Counter::kIsIterationInvariantRate );
+  recorder.report();
+}
+
+BENCHMARK_CAPTURE( optinlc_trajectory_planner, straight, ScenarioType::straight )->UseManualTime()->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner, curve, ScenarioType::curve )->UseManualTime()->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner, dense_traffic, ScenarioType::dense_traffic )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+
+BENCHMARK_CAPTURE( safety_corridor_planner, straight, ScenarioType::straight )->UseManualTime()->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( safety_corridor_planner, curve, ScenarioType::curve )->UseManualTime()->Unit( benchmark::kMillisecond );
+
+BENCHMARK_CAPTURE( optinlc_trajectory_optimizer, straight, ScenarioType::straight )->UseManualTime()->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_optimizer, curve, ScenarioType::curve )->UseManualTime()->Unit( benchmark::kMillisecond );
+
+BENCHMARK_CAPTURE( lane_follow_planner, straight, ScenarioType::straight )->UseManualTime()->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( lane_follow_planner, curve, ScenarioType::curve )->UseManualTime()->Unit( benchmark::kMillisecond );
+
+BENCHMARK_CAPTURE( batch_lane_follow_planner, straight, ScenarioType::straight )
+  ->ArgsProduct( { { 64, 256 }, { 1, 2, 4, 8 } } )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+
+} // namespace bench
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,211 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "adore_map/map.hpp"
+#include "planning/planning_replay.hpp"
+#include "planning/speed_band_planner.hpp"
+
+// Replays a planning log recorded with PlanningRecorder and reports the per cycle latency and the difference of the
+// replayed outputs to the recorded ones. The map is not part of the log, route and lane follow cycles are planned on an
+// empty map as in the benchmark scenarios, so their outputs differ where the recorded planner used lane speed limits.
+//
+//   planning_replay <log> [--route-planner name] [--csv file] [--tolerance m]
+
+namespace adore
+{
+namespace planner
+{
+namespace replay
+{
+
+struct Options
+{
+  std::string log_path;
+  std::string route_planner = "optinlc";
+  std::string csv_path;
+  double      tolerance = 1e-3; // position difference in m above which a cycle counts as differing
+};
+
+static void
+print_usage()
+{
+  std::cerr << "usage: planning_replay <log> [--route-planner optinlc|low_speed|high_speed|speed_band|float_solver|single_precision]"
+            << " [--csv file] [--tolerance m]\n";
+}
+
+static bool
+parse_options( int argc, char** argv, Options& options )
+{
+  for( int i = 1; i < argc; ++i )
+  {
+    std::string argument  = argv[i];
+    bool        has_value = i + 1 < argc;
+    if( argument == "--route-planner" && has_value )
+      options.route_planner = argv[++i];
+    else if( argument == "--csv" && has_value )
+      options.csv_path = argv[++i];
+    else if( argument == "--tolerance" && has_value )
+      options.tolerance = std::atof( argv[++i] );
+    else if( argument.compare( 0, 2, "--" ) != 0 && options.log_path.empty() )
+      options.log_path = argument;
+    else
+      return false;
+  }
+  return !options.log_path.empty();
+}
+
+// Nearest rank percentile of sorted values in ms
+static double
+percentile_ms( const std::vector<double>& sorted, double fraction )
+{
+  if( sorted.empty() )
+    return 0.0;
+  size_t rank = static_cast<size_t>( std::ceil( fraction * sorted.size() ) );
+  return sorted[std::min( std::max<size_t>( rank, 1 ), sorted.size() ) - 1] * 1e3;
+}
+
+static void
+print_latency( const char* name, std::vector<double> times )
+{
+  std::sort( times.begin(), times.end() );
+  std::printf( "%-9s p50 %8.3f ms  p90 %8.3f ms  p99 %8.3f ms  max %8.3f ms\n", name, percentile_ms( times, 0.5 ),
+               percentile_ms( times, 0.9 ), percentile_ms( times, 0.99 ), percentile_ms( times, 1.0 ) );
+}
+
+template<typename RoutePlanner>
+static int
+run( const Options& options )
+{
+  PlanningLogReader            reader( options.log_path );
+  map::Map                     map;
+  PlanningReplay<RoutePlanner> replay( map );
+
+  std::ofstream csv;
+  if( !options.csv_path.empty() )
+  {
+    csv.open( options.csv_path );
+    if( !csv )
+    {
+      std::cerr << "cannot open " << options.csv_path << "\n";
+      return 1;
+    }
+    csv << "cycle,type,recorded_ms,replay_ms,max_position_m,max_speed_mps,max_yaw_rad,compared_states,missing_states,failed\n";
+  }
+
+  std::vector<double>  replay_times;
+  std::vector<double>  recorded_times;
+  std::vector<size_t>  cycles_per_type( static_cast<size_t>( PlanningCycleType::multi_agent ) + 1, 0 );
+  ReplayedCycle        cycle;
+  ReplayedCycle        slowest;
+  TrajectoryDifference difference;
+  size_t               differing = 0;
+  size_t               failed    = 0;
+
+  while( replay.step( reader, cycle ) )
+  {
+    replay_times.push_back( cycle.replay_time );
+    recorded_times.push_back( cycle.recorded_time );
+    cycles_per_type[static_cast<size_t>( cycle.type )]++;
+    if( cycle.replay_time >= slowest.replay_time )
+      slowest = cycle;
+    if( cycle.failed )
+      failed++;
+    else
+    {
+      difference.merge( cycle.difference );
+      if( cycle.difference.max_position > options.tolerance || cycle.difference.missing_states > 0 )
+        differing++;
+    }
+
+    if( csv.is_open() )
+      csv << cycle.index << ',' << planning_cycle_type_name( cycle.type ) << ',' << cycle.recorded_time * 1e3 << ','
+          << cycle.replay_time * 1e3 << ',' << cycle.difference.max_position << ',' << cycle.difference.max_speed << ','
+          << cycle.difference.max_yaw << ',' << cycle.difference.compared_states << ',' << cycle.difference.missing_states << ','
+          << cycle.failed << '\n';
+  }
+
+  std::printf( "%s: %zu cycles, %zu bytes\n", options.log_path.c_str(), replay_times.size(), reader.size() );
+  for( size_t type = 0; type < cycles_per_type.size(); ++type )
+    if( cycles_per_type[type] > 0 )
+      std::printf( "  %-11s %zu\n", planning_cycle_type_name( static_cast<PlanningCycleType>( type ) ), cycles_per_type[type] );
+  if( replay_times.empty() )
+    return 0;
+
+  print_latency( "replay", replay_times );
+  print_latency( "recorded", recorded_times );
+  std::printf( "slowest replayed cycle %zu (%s), %.3f ms replayed, %.3f ms recorded\n", slowest.index,
+               planning_cycle_type_name( slowest.type ), slowest.replay_time * 1e3, slowest.recorded_time * 1e3 );
+  std::printf( "max difference: position %.6f m, speed %.6f m/s, yaw %.6f rad, steering %.6f rad, acceleration %.6f m/s2\n",
+               difference.max_position, difference.max_speed, difference.max_yaw, difference.max_steering,
+               difference.max_acceleration );
+  std::printf( "%zu cycles differ by more than %g m or in their number of states, %zu cycles failed\n", differing, options.tolerance,
+               failed );
+  if( reader.truncated() )
+    std::printf( "the last record of the log is cut off and was skipped\n" );
+  return 0;
+}
+
+static int
+run_with_route_planner( const Options& options )
+{
+  if( options.route_planner == "optinlc" )
+    return run<OptiNLCTrajectoryPlanner>( options );
+  if( options.route_planner == "low_speed" )
+    return run<LowSpeedOptiNLCTrajectoryPlanner>( options );
+  if( options.route_planner == "high_speed" )
+    return run<HighSpeedOptiNLCTrajectoryPlanner>( options );
+  if( options.route_planner == "speed_band" )
+    return run<SpeedBandTrajectoryPlanner>( options );
+  if( options.route_planner == "float_solver" )
+    return run<FloatSolverOptiNLCTrajectoryPlanner>( options );
+  if( options.route_planner == "single_precision" )
+    return run<SinglePrecisionOptiNLCTrajectoryPlanner>( options );
+  std::cerr << "unknown route planner " << options.route_planner << "\n";
+  return 1;
+}
+
+} // namespace replay
+} // namespace planner
+} // namespace adore
+
+int
+main( int argc, char** argv )
+{
+  adore::planner::replay::Options options;
+  if( !adore::planner::replay::parse_options( argc, argv, options ) )
+  {
+    adore::planner::replay::print_usage();
+    return 1;
+  }
+
+  try
+  {
+    return adore::planner::replay::run_with_route_planner( options );
+  }
+  catch( const std::exception& error )
+  {
+    std::cerr << error.what() << "\n";
+    return 1;
+  }
+}
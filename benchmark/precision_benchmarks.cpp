@@ -0,0 +1,161 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include "planning/optinlc_trajectory_optimizer.hpp"
+#include "planning/optinlc_trajectory_planner.hpp"
+#include "planning/safety_corridor_planner.hpp"
+#include "scenarios.hpp"
+
+namespace adore
+{
+namespace planner
+{
+namespace bench
+{
+
+// Accuracy and latency of the precision variants of the OCP planners, see planner_precision.hpp
+
+enum class PrecisionType
+{
+  double_precision,
+  float_solver,
+  single_precision
+};
+
+// Largest distance between the positions of two trajectories over their common states
+static double
+max_position_deviation( const dynamics::Trajectory& trajectory, const dynamics::Trajectory& reference )
+{
+  double deviation = 0.0;
+  size_t states    = std::min( trajectory.states.size(), reference.states.size() );
+  for( size_t i = 0; i < states; ++i )
+  {
+    double dx = trajectory.states[i].x - reference.states[i].x;
+    double dy = trajectory.states[i].y - reference.states[i].y;
+    deviation = std::max( deviation, std::sqrt( dx * dx + dy * dy ) );
+  }
+  return deviation;
+}
+
+// The deviation compares the first solve of a fresh planner with the one of a fresh double planner on the same input,
+// later solves start from the previous solution. The latency is measured over the following steady state cycles.
+template<typename Planner, typename DoublePlanner, typename Plan>
+static void
+compare_to_double( benchmark::State& state, Plan&& plan )
+{
+  DoublePlanner double_planner;
+  auto          reference = plan( double_planner );
+
+  Planner planner;
+  auto    first_trajectory = plan( planner );
+
+  state.counters["max_deviation_m"]   = max_position_deviation( first_trajectory, reference );
+  state.counters["trajectory_states"] = static_cast<double>( first_trajectory.states.size() );
+
+  LatencyRecorder recorder( state );
+  for( auto _ : state )
+  {
+    recorder.measure( [&]() {
+      auto trajectory = plan( planner );
+      benchmark::DoNotOptimize( trajectory );
+    } );
+  }
+  recorder.report();
+}
+
+template<typename DoublePlanner, typename FloatSolverPlanner, typename SinglePlanner, typename Plan>
+static void
+compare_precision( benchmark::State& state, PrecisionType precision, Plan&& plan )
+{
+  switch( precision )
+  {
+    case PrecisionType::double_precision:
+      compare_to_double<DoublePlanner, DoublePlanner>( state, plan );
+      break;
+    case PrecisionType::float_solver:
+      compare_to_double<FloatSolverPlanner, DoublePlanner>( state, plan );
+      break;
+    case PrecisionType::single_precision:
+      compare_to_double<SinglePlanner, DoublePlanner>( state, plan );
+      break;
+  }
+}
+
+static void
+optinlc_trajectory_planner_precision( benchmark::State& state, ScenarioType type, PrecisionType precision )
+{
+  auto scenario = make_scenario( type );
+  compare_precision<OptiNLCTrajectoryPlanner, FloatSolverOptiNLCTrajectoryPlanner, SinglePrecisionOptiNLCTrajectoryPlanner>(
+    state, precision,
+    [&]( auto& planner ) { return planner.plan_trajectory( scenario.route, scenario.ego_state, scenario.map, scenario.traffic ); } );
+}
+
+static void
+safety_corridor_planner_precision( benchmark::State& state, ScenarioType type, PrecisionType precision )
+{
+  auto scenario = make_scenario( type );
+  compare_precision<SafetyCorridorPlanner, FloatSolverSafetyCorridorPlanner, SinglePrecisionSafetyCorridorPlanner>(
+    state, precision,
+    [&]( auto& planner ) { return planner.plan_trajectory( scenario.left_border, scenario.right_border, scenario.ego_state ); } );
+}
+
+static void
+optinlc_trajectory_optimizer_precision( benchmark::State& state, ScenarioType type, PrecisionType precision )
+{
+  auto scenario = make_scenario( type );
+  compare_precision<OptiNLCTrajectoryOptimizer, FloatSolverOptiNLCTrajectoryOptimizer, SinglePrecisionOptiNLCTrajectoryOptimizer>(
+    state, precision, [&]( auto& optimizer ) { return optimizer.plan_trajectory( scenario.reference_trajectory, scenario.ego_state ); } );
+}
+
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_precision, straight_double, ScenarioType::straight, PrecisionType::double_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_precision, straight_float_solver, ScenarioType::straight, PrecisionType::float_solver )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_precision, straight_single, ScenarioType::straight, PrecisionType::single_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_precision, curve_double, ScenarioType::curve, PrecisionType::double_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_precision, curve_float_solver, ScenarioType::curve, PrecisionType::float_solver )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_planner_precision, curve_single, ScenarioType::curve, PrecisionType::single_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+
+BENCHMARK_CAPTURE( safety_corridor_planner_precision, curve_double, ScenarioType::curve, PrecisionType::double_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( safety_corridor_planner_precision, curve_float_solver, ScenarioType::curve, PrecisionType::float_solver )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( safety_corridor_planner_precision, curve_single, ScenarioType::curve, PrecisionType::single_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+
+BENCHMARK_CAPTURE( optinlc_trajectory_optimizer_precision, curve_double, ScenarioType::curve, PrecisionType::double_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_optimizer_precision, curve_float_solver, ScenarioType::curve, PrecisionType::float_solver )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+BENCHMARK_CAPTURE( optinlc_trajectory_optimizer_precision, curve_single, ScenarioType::curve, PrecisionType::single_precision )
+  ->UseManualTime()
+  ->Unit( benchmark::kMillisecond );
+
+} // namespace bench
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,253 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cmath>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include "adore_map/map.hpp"
+#include "adore_map/route.hpp"
+#include "adore_math/point.h"
+#include "benchmark/benchmark.h"
+#include "dynamics/integration.hpp"
+#include "dynamics/physical_vehicle_model.hpp"
+#include "dynamics/traffic_participant.hpp"
+#include "dynamics/trajectory.hpp"
+#include "dynamics/vehicle_state.hpp"
+
+namespace adore
+{
+namespace planner
+{
+namespace bench
+{
+
+enum class ScenarioType
+{
+  straight,
+  curve,
+  dense_traffic
+};
+
+// Synthetic driving situation, the route is built directly from center lane points so no map file is needed.
+// The map has no lanes, traffic is placed on the neighbouring lanes outside the route corridor of the ego vehicle.
+struct Scenario
+{
+  map::Route                      route;
+  map::Map                        map;
+  dynamics::VehicleStateDynamic   ego_state;
+  dynamics::TrafficParticipantSet traffic;
+  std::vector<math::Point2d>      left_border;
+  std::vector<math::Point2d>      right_border;
+  std::deque<map::MapPoint>       route_points;
+  dynamics::Trajectory            reference_trajectory;
+  dynamics::VehicleCommandLimits  limits;
+};
+
+constexpr double route_length  = 200.0;
+constexpr double point_spacing = 0.5;
+constexpr double curve_radius  = 60.0;
+constexpr double lane_width    = 3.5;
+constexpr double ego_speed     = 5.0;
+
+// Pose on the center line of the scenario, lateral offset to the left
+inline math::Pose2d
+center_line_pose( ScenarioType type, double s, double offset = 0.0 )
+{
+  math::Pose2d pose;
+  if( type == ScenarioType::curve )
+  {
+    double angle = s / curve_radius;
+    double r     = curve_radius - offset;
+    pose.x       = r * std::sin( angle );
+    pose.y       = curve_radius - r * std::cos( angle );
+    pose.yaw     = angle;
+  }
+  else
+  {
+    pose.x   = s;
+    pose.y   = offset;
+    pose.yaw = 0.0;
+  }
+  return pose;
+}
+
+inline map::Route
+make_route( ScenarioType type, double offset = 0.0 )
+{
+  map::Route route;
+  for( double s = 0.0; s <= route_length; s += point_spacing )
+  {
+    auto          pose = center_line_pose( type, s, offset );
+    map::MapPoint point;
+    point.x         = pose.x;
+    point.y         = pose.y;
+    point.s         = s;
+    point.parent_id = 1;
+    point.max_speed = std::nullopt;
+    route.center_lane[s] = point;
+  }
+  return route;
+}
+
+inline dynamics::TrafficParticipant
+make_participant( ScenarioType type, int id, double s, double offset, double speed )
+{
+  auto                         pose = center_line_pose( type, s, offset );
+  dynamics::TrafficParticipant participant;
+  participant.id                            = id;
+  participant.state.x                       = pose.x;
+  participant.state.y                       = pose.y;
+  participant.state.yaw_angle               = pose.yaw;
+  participant.state.vx                      = speed;
+  participant.physical_parameters.wheelbase = 2.7;
+  participant.route                         = make_route( type, offset );
+  return participant;
+}
+
+// Vehicles every 10 m on the two neighbouring lanes, 2 * vehicles_per_lane in total, and vehicles_ahead slower
+// vehicles every 25 m on the ego lane starting 20 m ahead, so that the planners have obstacles on their route
+inline dynamics::TrafficParticipantSet
+make_traffic( ScenarioType type, int vehicles_per_lane, int vehicles_ahead = 0 )
+{
+  dynamics::TrafficParticipantSet traffic;
+  int                             id = 2;
+  for( int k = 0; k < vehicles_per_lane; k++ )
+  {
+    double s = 10.0 * k;
+    for( double offset : { 2.0 * lane_width, -2.0 * lane_width } )
+    {
+      traffic.participants[id] = make_participant( type, id, s, offset, ego_speed );
+      id++;
+    }
+  }
+  for( int k = 0; k < vehicles_ahead; k++ )
+  {
+    traffic.participants[id] = make_participant( type, id, 20.0 + 25.0 * k, 0.0, 0.6 * ego_speed );
+    id++;
+  }
+  return traffic;
+}
+
+inline Scenario
+make_scenario( ScenarioType type )
+{
+  auto     road_type = type == ScenarioType::curve ? ScenarioType::curve : ScenarioType::straight;
+  Scenario scenario;
+  scenario.route = make_route( road_type );
+
+  auto start                   = center_line_pose( road_type, 0.0 );
+  scenario.ego_state.x         = start.x;
+  scenario.ego_state.y         = start.y;
+  scenario.ego_state.yaw_angle = start.yaw;
+  scenario.ego_state.vx        = ego_speed;
+
+  for( const auto& [s, point] : scenario.route.center_lane )
+  {
+    scenario.route_points.push_back( point );
+
+    auto          left  = center_line_pose( road_type, s, lane_width / 2 );
+    auto          right = center_line_pose( road_type, s, -lane_width / 2 );
+    math::Point2d left_point;
+    left_point.x = left.x;
+    left_point.y = left.y;
+    math::Point2d right_point;
+    right_point.x = right.x;
+    right_point.y = right.y;
+    scenario.left_border.push_back( left_point );
+    scenario.right_border.push_back( right_point );
+  }
+
+  // Constant speed reference along the center line, as produced by the lane follow planner
+  for( double t = 0.0; t <= 10.0; t += 0.1 )
+  {
+    auto                          pose = center_line_pose( road_type, ego_speed * t );
+    dynamics::VehicleStateDynamic state;
+    state.x         = pose.x;
+    state.y         = pose.y;
+    state.yaw_angle = pose.yaw;
+    state.vx        = ego_speed;
+    state.time      = t;
+    scenario.reference_trajectory.states.push_back( state );
+  }
+
+  if( type == ScenarioType::dense_traffic )
+    scenario.traffic = make_traffic( road_type, 20, 3 );
+  return scenario;
+}
+
+inline dynamics::PhysicalVehicleModel
+make_vehicle_model()
+{
+  dynamics::PhysicalVehicleModel model;
+  model.motion_model = []( const dynamics::VehicleStateDynamic& state, const dynamics::VehicleCommand& cmd ) {
+    dynamics::PhysicalVehicleParameters params;
+    return dynamics::kinematic_bicycle_model( state, params, cmd );
+  };
+  return model;
+}
+
+// Per call wall time, reported as manual iteration time and as latency percentiles in milliseconds
+class LatencyRecorder
+{
+public:
+
+  explicit LatencyRecorder( benchmark::State& state ) :
+    state( state )
+  {}
+
+  template<typename Function>
+  void
+  measure( Function&& function )
+  {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    state.SetIterationTime( elapsed.count() );
+    samples.push_back( elapsed.count() );
+  }
+
+  // Has to be called after the benchmark loop
+  void
+  report()
+  {
+    if( samples.empty() )
+      return;
+    std::sort( samples.begin(), samples.end() );
+    state.counters["p50_ms"] = percentile( 0.50 ) * 1e3;
+    state.counters["p90_ms"] = percentile( 0.90 ) * 1e3;
+    state.counters["p99_ms"] = percentile( 0.99 ) * 1e3;
+    state.counters["max_ms"] = samples.back() * 1e3;
+  }
+
+private:
+
+  double
+  percentile( double fraction ) const
+  {
+    size_t index = static_cast<size_t>( std::ceil( fraction * samples.size() ) );
+    return samples[std::min( std::max( index, size_t{ 1 } ), samples.size() ) - 1];
+  }
+
+  benchmark::State&   state;
+  std::vector<double> samples;
+};
+
+} // namespace bench
+} // namespace planner
+} // namespace adore
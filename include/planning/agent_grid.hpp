@@ -0,0 +1,105 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cmath>
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+namespace adore
+{
+namespace planner
+{
+
+// Uniform grid over agent positions, rebuilt once per integration step.
+// Entries are kept sorted by cell, so the storage is reused between steps and queries need no hashing.
+class AgentGrid
+{
+public:
+
+  void
+  clear( double new_cell_size )
+  {
+    cell_size = std::max( new_cell_size, 1.0 );
+    entries.clear();
+  }
+
+  void
+  insert( int id, double x, double y )
+  {
+    entries.push_back( { cell_index( x ), cell_index( y ), id } );
+  }
+
+  // Has to be called after the last insert and before the first query
+  void
+  finalize()
+  {
+    std::sort( entries.begin(), entries.end(), []( const Entry& a, const Entry& b ) {
+      return std::tie( a.cell_x, a.cell_y, a.id ) < std::tie( b.cell_x, b.cell_y, b.id );
+    } );
+  }
+
+  // Appends the ids of all agents in the cells overlapping the square of half size radius around x, y, sorted by id
+  void
+  query( double x, double y, double radius, std::vector<int>& ids ) const
+  {
+    ids.clear();
+    int min_y = cell_index( y - radius );
+    int max_y = cell_index( y + radius );
+    for( int cell_x = cell_index( x - radius ); cell_x <= cell_index( x + radius ); cell_x++ )
+    {
+      auto first = std::lower_bound( entries.begin(), entries.end(), Entry{ cell_x, min_y, 0 }, compare_cell );
+      auto last  = std::upper_bound( first, entries.end(), Entry{ cell_x, max_y, 0 }, compare_cell );
+      for( auto it = first; it != last; ++it )
+        ids.push_back( it->id );
+    }
+    std::sort( ids.begin(), ids.end() );
+  }
+
+  bool
+  empty() const
+  {
+    return entries.empty();
+  }
+
+private:
+
+  struct Entry
+  {
+    int cell_x;
+    int cell_y;
+    int id;
+  };
+
+  static bool
+  compare_cell( const Entry& a, const Entry& b )
+  {
+    return std::tie( a.cell_x, a.cell_y ) < std::tie( b.cell_x, b.cell_y );
+  }
+
+  int
+  cell_index( double coordinate ) const
+  {
+    return static_cast<int>( std::floor( coordinate / cell_size ) );
+  }
+
+  double             cell_size = 25.0;
+  std::vector<Entry> entries;
+};
+
+} // namespace planner
+} // namespace adore
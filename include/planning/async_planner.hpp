@@ -0,0 +1,240 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "adore_map/map.hpp"
+#include "adore_map/route.hpp"
+#include "adore_math/point.h"
+#include "dynamics/traffic_participant.hpp"
+#include "dynamics/trajectory.hpp"
+#include "dynamics/vehicle_state.hpp"
+#include "planning/optinlc_trajectory_optimizer.hpp"
+#include "planning/optinlc_trajectory_planner.hpp"
+#include "planning/safety_corridor_planner.hpp"
+#include "planning/triple_buffer.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Inputs of one planning call, route and map are shared so posting a request does not copy them
+struct RoutePlanningRequest
+{
+  std::shared_ptr<const map::Route> route;
+  std::shared_ptr<const map::Map>   map;
+  dynamics::VehicleStateDynamic     state;
+  dynamics::TrafficParticipantSet   traffic_participants;
+};
+
+struct CorridorPlanningRequest
+{
+  std::vector<math::Point2d>    left_border;
+  std::vector<math::Point2d>    right_border;
+  dynamics::VehicleStateDynamic state;
+};
+
+struct ReferencePlanningRequest
+{
+  dynamics::Trajectory          reference_trajectory;
+  dynamics::VehicleStateDynamic state;
+};
+
+// The trajectory is filled in place, so the result slots keep their storage between solves
+template<typename Planner>
+void
+run_planner( Planner& planner, const RoutePlanningRequest& request, dynamics::Trajectory& trajectory )
+{
+  planner.plan_trajectory_into( trajectory, *request.route, request.state, *request.map, request.traffic_participants );
+}
+
+template<typename Planner>
+void
+run_planner( Planner& planner, const CorridorPlanningRequest& request, dynamics::Trajectory& trajectory )
+{
+  planner.plan_trajectory_into( trajectory, request.left_border, request.right_border, request.state );
+}
+
+template<typename Planner>
+void
+run_planner( Planner& planner, const ReferencePlanningRequest& request, dynamics::Trajectory& trajectory )
+{
+  planner.plan_trajectory_into( trajectory, request.reference_trajectory, request.state );
+}
+
+// Drops the states before current_time and starts the trajectory with the interpolated state at current_time
+inline dynamics::Trajectory
+retime_trajectory( const dynamics::Trajectory& trajectory, double current_time )
+{
+  if( trajectory.states.empty() || current_time <= trajectory.states.front().time )
+    return trajectory;
+
+  dynamics::Trajectory retimed;
+  auto                 first = trajectory.states.begin();
+  while( first != trajectory.states.end() && first->time <= current_time )
+    ++first;
+  retimed.states.reserve( static_cast<size_t>( trajectory.states.end() - first ) + 1 );
+  if( first == trajectory.states.end() )
+  {
+    retimed.states.push_back( trajectory.states.back() );
+    return retimed;
+  }
+  retimed.states.push_back( trajectory.get_state_at_time( current_time ) );
+  retimed.states.insert( retimed.states.end(), first, trajectory.states.end() );
+  return retimed;
+}
+
+struct PlanningResult
+{
+  dynamics::Trajectory trajectory;
+  double               request_time = 0.0; // state time of the request the trajectory was planned for
+  uint64_t             sequence     = 0;   // number of the request, counted from 1
+};
+
+// Runs a planner on a dedicated worker thread. The caller posts the newest inputs into a single slot mailbox,
+// requests that were not picked up yet are replaced. Results are published through a triple buffer, so the caller
+// picks up the newest completed trajectory without waiting, even while a solve is running. The planner is owned by
+// the worker while the front-end exists and must not be used by the caller in that time.
+template<typename Planner, typename Request>
+class AsyncPlanner
+{
+public:
+
+  explicit AsyncPlanner( Planner& planner ) :
+    planner( planner )
+  {
+    worker = std::thread( [this]() { worker_loop(); } );
+  }
+
+  ~AsyncPlanner()
+  {
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      stop = true;
+    }
+    wake_up.notify_one();
+    worker.join();
+  }
+
+  AsyncPlanner( const AsyncPlanner& )            = delete;
+  AsyncPlanner& operator=( const AsyncPlanner& ) = delete;
+
+  // Never blocks on a running solve
+  void
+  post( Request request )
+  {
+    posted_requests++;
+    mailbox.back().request  = std::move( request );
+    mailbox.back().sequence = posted_requests;
+    mailbox.publish();
+
+    // The lock only orders the wake up against the wait of the worker, it is never held during a solve
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+    }
+    wake_up.notify_one();
+  }
+
+  // Newest completed trajectory re-timed to current_time, empty until the first solve finished
+  std::optional<dynamics::Trajectory>
+  latest_trajectory( double current_time )
+  {
+    results.update();
+    if( results.front().sequence == 0 )
+      return std::nullopt;
+    return retime_trajectory( results.front().trajectory, current_time );
+  }
+
+  // Newest completed result as it was published by the worker
+  const PlanningResult&
+  latest_result()
+  {
+    results.update();
+    return results.front();
+  }
+
+  // Requests that threw in the planner, the previous result stays published
+  size_t
+  failed_requests() const
+  {
+    return failures.load( std::memory_order_relaxed );
+  }
+
+private:
+
+  struct Mail
+  {
+    Request  request;
+    uint64_t sequence = 0;
+  };
+
+  void
+  worker_loop()
+  {
+    while( true )
+    {
+      {
+        std::unique_lock<std::mutex> lock( mutex );
+        wake_up.wait( lock, [this]() { return stop || mailbox.has_update(); } );
+        if( stop )
+          return;
+      }
+      mailbox.update();
+      const Mail& mail = mailbox.front();
+
+      auto& result = results.back();
+      try
+      {
+        run_planner( planner, mail.request, result.trajectory );
+      }
+      catch( const std::exception& )
+      {
+        failures.fetch_add( 1, std::memory_order_relaxed );
+        continue;
+      }
+      result.request_time = mail.request.state.time;
+      result.sequence     = mail.sequence;
+      results.publish();
+    }
+  }
+
+  Planner& planner;
+
+  TripleBuffer<Mail>           mailbox;
+  TripleBuffer<PlanningResult> results;
+  uint64_t                     posted_requests = 0;
+  std::atomic<size_t>          failures{ 0 };
+
+  std::mutex              mutex;
+  std::condition_variable wake_up;
+  bool                    stop = false;
+  std::thread             worker;
+};
+
+using AsyncOptiNLCTrajectoryPlanner   = AsyncPlanner<OptiNLCTrajectoryPlanner, RoutePlanningRequest>;
+using AsyncSafetyCorridorPlanner      = AsyncPlanner<SafetyCorridorPlanner, CorridorPlanningRequest>;
+using AsyncOptiNLCTrajectoryOptimizer = AsyncPlanner<OptiNLCTrajectoryOptimizer, ReferencePlanningRequest>;
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,123 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cmath>
+
+#include <vector>
+
+#include "dynamics/vehicle_state.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// One explicit Euler step of the kinematic bicycle model, x' = v cos( psi ), y' = v sin( psi ), psi' = v tan( delta ) / L,
+// v' = a. The sequential and the batch prediction of MultiAgentPID both step with it, so they give the same trajectories.
+inline void
+kinematic_bicycle_step( double& x, double& y, double& yaw, double& vx, double steering, double wheelbase, double acceleration,
+                        double dt )
+{
+  double v  = vx;
+  x        += v * std::cos( yaw ) * dt;
+  y        += v * std::sin( yaw ) * dt;
+  yaw      += v * std::tan( steering ) / wheelbase * dt;
+  vx        = v + acceleration * dt;
+}
+
+// States of many agents in structure of arrays form, all agents of a prediction step are kept in a few contiguous
+// arrays and advanced by one plain loop over them with the inlined kernel, without indirect calls or state copies.
+// The loop is not vectorized, GCC fuses cos and sin of the yaw angle into sincos, which has no vector variant.
+struct BatchBicycleState
+{
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> yaw;
+  std::vector<double> vx;
+  std::vector<double> steering;
+  std::vector<double> wheelbase;
+  std::vector<double> time;
+
+  // Commands applied in the next step
+  std::vector<double> acceleration;
+  std::vector<double> steering_command;
+
+  void
+  resize( size_t count )
+  {
+    for( auto* field : { &x, &y, &yaw, &vx, &steering, &wheelbase, &time, &acceleration, &steering_command } )
+      field->assign( count, 0.0 );
+  }
+
+  size_t
+  size() const
+  {
+    return x.size();
+  }
+
+  void
+  set_state( size_t k, const dynamics::VehicleStateDynamic& state )
+  {
+    x[k]        = state.x;
+    y[k]        = state.y;
+    yaw[k]      = state.yaw_angle;
+    vx[k]       = state.vx;
+    steering[k] = state.steering_angle;
+    time[k]     = state.time;
+  }
+
+  dynamics::VehicleStateDynamic
+  get_state( size_t k ) const
+  {
+    dynamics::VehicleStateDynamic state;
+    state.x              = x[k];
+    state.y              = y[k];
+    state.yaw_angle      = yaw[k];
+    state.vx             = vx[k];
+    state.steering_angle = steering[k];
+    state.ax             = acceleration[k];
+    state.yaw_rate       = vx[k] * std::tan( steering[k] ) / wheelbase[k];
+    state.time           = time[k];
+    return state;
+  }
+
+  // One step of every agent. As in the sequential prediction the steering angle is the command after the step.
+  void
+  integrate( double dt )
+  {
+    const size_t n = size();
+
+    double*       px        = x.data();
+    double*       py        = y.data();
+    double*       pyaw      = yaw.data();
+    double*       pvx       = vx.data();
+    double*       psteering = steering.data();
+    double*       ptime     = time.data();
+    const double* pbase     = wheelbase.data();
+    const double* pacc      = acceleration.data();
+    const double* pcommand  = steering_command.data();
+
+    for( size_t k = 0; k < n; k++ )
+    {
+      kinematic_bicycle_step( px[k], py[k], pyaw[k], pvx[k], psteering[k], pbase[k], pacc[k], dt );
+      psteering[k]  = pcommand[k];
+      ptime[k]     += dt;
+    }
+  }
+};
+
+} // namespace planner
+} // namespace adore
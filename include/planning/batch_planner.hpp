@@ -0,0 +1,252 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "adore_map/map.hpp"
+#include "adore_map/route.hpp"
+#include "dynamics/traffic_participant.hpp"
+#include "dynamics/trajectory.hpp"
+#include "dynamics/vehicle_state.hpp"
+#include "planning/agent_grid.hpp"
+#include "planning/lane_attribute_cache.hpp"
+#include "planning/lane_follow_planner.hpp"
+#include "planning/optinlc_trajectory_planner.hpp"
+#include "planning/thread_pool.hpp"
+#include "planning/work_stealing_ranges.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// One vehicle of a batch, route and route points are owned by the caller and must outlive the plan call
+struct BatchPlanningJob
+{
+  int                              vehicle_id = 0; // selects the planner of the vehicle, the participant with this id is left out
+  dynamics::VehicleStateDynamic    state;
+  const map::Route*                route        = nullptr; // route based planners
+  const std::deque<map::MapPoint>* route_points = nullptr; // LaneFollowPlanner
+};
+
+struct BatchReport
+{
+  size_t jobs        = 0;
+  size_t failed_jobs = 0; // jobs that threw in the planner, their trajectory is empty
+  size_t steals      = 0; // ranges of jobs moved between threads by the scheduler
+};
+
+// The planner searches the shared participant set, restricted to participant_ids when given and without the vehicle
+// of the job, nothing is copied per job
+template<typename Planner>
+void
+run_batch_job( Planner& planner, const BatchPlanningJob& job, const map::Map& map, const dynamics::TrafficParticipantSet& traffic_participants,
+               const std::vector<int>* participant_ids, const dynamics::VehicleCommandLimits&, dynamics::Trajectory& trajectory )
+{
+  if( !job.route )
+    throw std::invalid_argument( "batch job without route" );
+  planner.set_participant_filter( participant_ids, job.vehicle_id );
+  planner.plan_trajectory_into( trajectory, *job.route, job.state, map, traffic_participants );
+}
+
+inline void
+run_batch_job( LaneFollowPlanner& planner, const BatchPlanningJob& job, const map::Map& map, const dynamics::TrafficParticipantSet&,
+               const std::vector<int>*, const dynamics::VehicleCommandLimits& limits, dynamics::Trajectory& trajectory )
+{
+  if( !job.route_points )
+    throw std::invalid_argument( "batch job without route points" );
+  planner.plan_trajectory_into( trajectory, job.state, *job.route_points, map, limits );
+}
+
+// Plans the trajectories of many vehicles that share one map and one set of traffic participants, e.g. all simulated
+// vehicles of a closed loop simulation tick. Jobs are spread over a thread pool by a work stealing scheduler.
+//
+// Every vehicle keeps its own planner, created on its first job with the batch parameters, so warm starts and the
+// other state carried between cycles stay per vehicle. What is independent of the vehicle is shared: each thread has
+// one lane attribute cache that the planners use while they run on it, and the participants are indexed once per
+// batch. With participant_search_radius > 0 a job only sees the participants within that distance of its vehicle.
+template<typename Planner>
+class BatchPlanner
+{
+public:
+
+  explicit BatchPlanner( size_t number_of_threads, std::map<std::string, double> planner_parameters = {} ) :
+    thread_pool( number_of_threads ),
+    parameters( std::move( planner_parameters ) ),
+    slots( thread_pool.size() )
+  {}
+
+  BatchPlanner( const BatchPlanner& )            = delete;
+  BatchPlanner& operator=( const BatchPlanner& ) = delete;
+
+  // Plans all jobs, the trajectory of job i is get_trajectories()[i]. A vehicle may occur only once per batch.
+  void
+  plan( const std::vector<BatchPlanningJob>& jobs, const map::Map& map, const dynamics::TrafficParticipantSet& traffic_participants )
+  {
+    batch++;
+    job_planners.resize( jobs.size() );
+    for( size_t i = 0; i < jobs.size(); ++i )
+      job_planners[i] = &acquire_planner( jobs[i].vehicle_id );
+
+    trajectories.resize( jobs.size() );
+    failed.assign( jobs.size(), 0 );
+
+    if( participant_search_radius > 0.0 )
+    {
+      participant_grid.clear( participant_search_radius );
+      for( const auto& [id, participant] : traffic_participants.participants )
+        participant_grid.insert( id, participant.state.x, participant.state.y );
+      participant_grid.finalize();
+    }
+
+    size_t steals_before = scheduler.steal_count();
+    scheduler.reset( jobs.size(), slots.size() );
+    thread_pool.parallel_for( slots.size(), [&]( size_t slot ) {
+      size_t i = 0;
+      while( scheduler.next( slot, i ) )
+        run_job( slots[slot], jobs[i], *job_planners[i], map, traffic_participants, trajectories[i], failed[i] );
+    } );
+
+    report.jobs        = jobs.size();
+    report.failed_jobs = 0;
+    for( char job_failed : failed )
+      report.failed_jobs += job_failed;
+    report.steals = scheduler.steal_count() - steals_before;
+  }
+
+  const std::vector<dynamics::Trajectory>&
+  get_trajectories() const
+  {
+    return trajectories;
+  }
+
+  bool
+  job_failed( size_t job ) const
+  {
+    return failed[job] != 0;
+  }
+
+  const BatchReport&
+  get_report() const
+  {
+    return report;
+  }
+
+  // Drops the planner of a vehicle that left the simulation
+  void
+  remove_vehicle( int vehicle_id )
+  {
+    planners.erase( vehicle_id );
+  }
+
+  size_t
+  vehicle_count() const
+  {
+    return planners.size();
+  }
+
+  // Participants farther away than this from a vehicle are not passed to its planner, 0 passes all of them.
+  // Has to cover the obstacle search distance of the planner.
+  double participant_search_radius = 0.0;
+
+  // Used by planners that take the limits per call
+  dynamics::VehicleCommandLimits limits;
+
+private:
+
+  struct VehiclePlanner
+  {
+    std::unique_ptr<Planner> planner;
+    uint64_t                 batch = 0; // last batch with a job of the vehicle
+  };
+
+  // Per thread state, only touched by the thread that runs the slot
+  struct Slot
+  {
+    std::shared_ptr<LaneAttributeCache> lane_cache = std::make_shared<LaneAttributeCache>();
+    std::vector<int>                    nearby_ids;
+  };
+
+  Planner&
+  acquire_planner( int vehicle_id )
+  {
+    auto& entry = planners[vehicle_id];
+    if( entry.batch == batch )
+      throw std::invalid_argument( "vehicle " + std::to_string( vehicle_id ) + " occurs twice in the batch" );
+    entry.batch = batch;
+    if( !entry.planner )
+    {
+      entry.planner = std::make_unique<Planner>();
+      if( !parameters.empty() )
+        entry.planner->set_parameters( parameters );
+    }
+    return *entry.planner;
+  }
+
+  // Ids of the participants near the vehicle of the job, null if all participants are passed
+  const std::vector<int>*
+  select_participants( Slot& slot, const BatchPlanningJob& job ) const
+  {
+    if( participant_search_radius <= 0.0 )
+      return nullptr;
+    participant_grid.query( job.state.x, job.state.y, participant_search_radius, slot.nearby_ids );
+    return &slot.nearby_ids;
+  }
+
+  void
+  run_job( Slot& slot, const BatchPlanningJob& job, Planner& planner, const map::Map& map,
+           const dynamics::TrafficParticipantSet& traffic_participants, dynamics::Trajectory& trajectory, char& job_failed )
+  {
+    // The planner may run on a different thread than in the last batch, it always uses the cache of the current one
+    planner.set_lane_attribute_cache( slot.lane_cache );
+    try
+    {
+      run_batch_job( planner, job, map, traffic_participants, select_participants( slot, job ), limits, trajectory );
+    }
+    catch( const std::exception& )
+    {
+      trajectory.states.clear();
+      job_failed = 1;
+    }
+  }
+
+  ThreadPool                              thread_pool;
+  std::map<std::string, double>           parameters;
+  std::vector<Slot>                       slots;
+  std::unordered_map<int, VehiclePlanner> planners;
+  uint64_t                                batch = 0;
+
+  WorkStealingRanges                scheduler;
+  AgentGrid                         participant_grid;
+  std::vector<Planner*>             job_planners;
+  std::vector<dynamics::Trajectory> trajectories;
+  std::vector<char>                 failed; // char instead of bool, the flags are written concurrently
+  BatchReport                       report;
+};
+
+using BatchOptiNLCTrajectoryPlanner = BatchPlanner<OptiNLCTrajectoryPlanner>;
+using BatchLaneFollowPlanner        = BatchPlanner<LaneFollowPlanner>;
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,89 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "adore_math/curvature.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Curvature of every point of a polyline, from the three point formula with the neighbours averaged pairwise,
+// ( i - 2, i - 1 ) and ( i + 1, i + 2 ), for robustness against noise. The two points at each end copy the nearest
+// computed value, lines with fewer than five points get zero curvature. This is the array form of
+// adore::math::compute_curvature, a vectorized kernel belongs here.
+inline void
+compute_point_curvatures( const double* x, const double* y, size_t n, bool absolute, double* curvatures )
+{
+  if( n < 5 )
+  {
+    std::fill( curvatures, curvatures + n, 0.0 );
+    return;
+  }
+
+  for( size_t i = 2; i < n - 2; ++i )
+  {
+    double x1 = ( x[i - 2] + x[i - 1] ) / 2.0;
+    double y1 = ( y[i - 2] + y[i - 1] ) / 2.0;
+    double x3 = ( x[i + 1] + x[i + 2] ) / 2.0;
+    double y3 = ( y[i + 1] + y[i + 2] ) / 2.0;
+
+    double kappa  = adore::math::compute_curvature( x1, y1, x[i], y[i], x3, y3 );
+    curvatures[i] = absolute ? std::abs( kappa ) : kappa;
+  }
+
+  curvatures[0]     = curvatures[2];
+  curvatures[1]     = curvatures[2];
+  curvatures[n - 1] = curvatures[n - 3];
+  curvatures[n - 2] = curvatures[n - 3];
+}
+
+// Centered moving average over +-half_window points, truncated at the ends of the line.
+// The window sums are differences of one prefix sum, so the cost does not depend on the window size.
+inline void
+smooth_moving_average( const double* values, size_t n, int half_window, std::vector<double>& prefix_sum, double* smoothed )
+{
+  prefix_sum.resize( n + 1 );
+  prefix_sum[0] = 0.0;
+  for( size_t i = 0; i < n; ++i )
+    prefix_sum[i + 1] = prefix_sum[i] + values[i];
+
+  size_t window = static_cast<size_t>( std::max( half_window, 0 ) );
+  for( size_t i = 0; i < n; ++i )
+  {
+    size_t first = i > window ? i - window : 0;
+    size_t last  = std::min( i + window + 1, n );
+    smoothed[i]  = ( prefix_sum[last] - prefix_sum[first] ) / static_cast<double>( last - first );
+  }
+}
+
+// Fused curvature and smoothing, scratch is reused between calls so that the caller does not allocate
+inline void
+compute_smoothed_curvatures( const double* x, const double* y, size_t n, int half_window, bool absolute, std::vector<double>& scratch,
+                             std::vector<double>& curvatures )
+{
+  curvatures.resize( n );
+  compute_point_curvatures( x, y, n, absolute, curvatures.data() );
+  // The prefix sum is built before the first output is written, so the smoothing can run in place
+  smooth_moving_average( curvatures.data(), n, half_window, scratch, curvatures.data() );
+}
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,134 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "adore_map/map.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Resolved lane of a route point, stays valid until the cache is invalidated. The lane is shared with the map, so it
+// outlives a map that is reassigned or cleared while the entry is in use.
+struct LaneAttributes
+{
+  std::shared_ptr<const map::Lane> lane; // empty if the lane is not part of the map
+  double                           speed_limit = std::numeric_limits<double>::infinity();
+};
+
+// Per lane attributes looked up once per map instead of once per route point. update() drops the entries when the lane
+// set of the map changed: another map object, or the same object with lanes added, removed or replaced, which covers a
+// map reassigned in place. The fingerprint visits every lane once per update, far fewer than the route points. A lane
+// edited in place keeps its identity, its speed limit is only looked up again after invalidate().
+// Planners that run on the same thread can share one cache, it is not synchronized.
+class LaneAttributeCache
+{
+public:
+
+  void
+  update( const map::Map& map )
+  {
+    size_t fingerprint = lane_fingerprint( map );
+    if( &map != current_map || fingerprint != lanes_fingerprint )
+      invalidate();
+    current_map       = &map;
+    lanes_fingerprint = fingerprint;
+  }
+
+  void
+  invalidate()
+  {
+    entries.clear();
+    last_lane_id = 0;
+    last_entry   = nullptr;
+    current_map       = nullptr;
+    lanes_fingerprint = 0;
+  }
+
+  // Attributes of the lane, lanes that are not part of the map resolve to an entry without lane.
+  // Consecutive route points mostly share their lane, so the last entry is checked before the hash lookup.
+  const LaneAttributes&
+  resolve( size_t lane_id )
+  {
+    if( last_entry && lane_id == last_lane_id )
+      return *last_entry;
+
+    auto [it, inserted] = entries.try_emplace( lane_id );
+    if( inserted && current_map )
+    {
+      auto lane = current_map->lanes.find( lane_id );
+      if( lane != current_map->lanes.end() )
+      {
+        it->second.lane        = lane->second;
+        it->second.speed_limit = current_map->get_lane_speed_limit( lane_id );
+      }
+    }
+    last_lane_id = lane_id;
+    last_entry   = &it->second;
+    return it->second;
+  }
+
+  // Like map::Map::lanes.at, throws for lanes that are not part of the map
+  const map::Lane&
+  lane( size_t lane_id )
+  {
+    const LaneAttributes& attributes = resolve( lane_id );
+    if( !attributes.lane )
+      throw std::out_of_range( "lane " + std::to_string( lane_id ) + " is not part of the map" );
+    return *attributes.lane;
+  }
+
+  // Like map::Map::get_lane_speed_limit, only lanes of the map are cached
+  double
+  speed_limit( size_t lane_id )
+  {
+    const LaneAttributes& attributes = resolve( lane_id );
+    if( attributes.lane || !current_map )
+      return attributes.speed_limit;
+    return current_map->get_lane_speed_limit( lane_id );
+  }
+
+private:
+
+  // Ids and identities of the lanes of the map, independent of the iteration order
+  static size_t
+  lane_fingerprint( const map::Map& map )
+  {
+    size_t fingerprint = map.lanes.size();
+    for( const auto& [id, lane] : map.lanes )
+    {
+      size_t entry  = std::hash<size_t>{}( id ) ^ ( std::hash<const void*>{}( lane.get() ) + 0x9e3779b9 + ( id << 6 ) + ( id >> 2 ) );
+      fingerprint  += entry * 0x9e3779b97f4a7c15ull;
+    }
+    return fingerprint;
+  }
+
+  const map::Map*                            current_map       = nullptr;
+  size_t                                     lanes_fingerprint = 0;
+  std::unordered_map<size_t, LaneAttributes> entries; // node based, references stay valid on insertion
+  size_t                                     last_lane_id = 0;
+  const LaneAttributes*                      last_entry   = nullptr;
+};
+
+} // namespace planner
+} // namespace adore
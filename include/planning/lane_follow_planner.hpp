@@ -13,6 +13,7 @@
  ********************************************************************************/
 #pragma once
 
+#include <memory>
 #include <optional>
 #include <unordered_map>
 
@@ -20,6 +21,9 @@
 
 #include "dynamics/trajectory.hpp"
 #include "dynamics/vehicle_state.hpp"
+#include "planning/lane_attribute_cache.hpp"
+#include "planning/path_buffer.hpp"
+#include "planning/trace_buffer.hpp"
 
 namespace adore
 {
@@ -35,6 +39,18 @@ public:
   dynamics::Trajectory plan_trajectory( const dynamics::VehicleStateDynamic& current_state, const std::deque<map::MapPoint>& route_points,
                                         const map::Map& local_map, const dynamics::VehicleCommandLimits& limits );
 
+  // Same as plan_trajectory but fills trajectory in place, its storage is reused between calls
+  void plan_trajectory_into( dynamics::Trajectory& trajectory, const dynamics::VehicleStateDynamic& current_state,
+                             const std::deque<map::MapPoint>& route_points, const map::Map& local_map,
+                             const dynamics::VehicleCommandLimits& limits );
+
+  // Shares the lane attributes with other planners running on the same thread
+  void
+  set_lane_attribute_cache( std::shared_ptr<LaneAttributeCache> cache )
+  {
+    lane_cache = std::move( cache );
+  }
+
   double       desired_acceleration     = 0.3;
   double       desired_deceleration     = 0.3;
   double       max_lateral_acceleration = 0.5;
@@ -45,34 +61,46 @@ public:
   const double min_point_distance       = 0.05;
   double       max_speed                = 2.5;
 
+  // Half width of the curvature moving average in route points
+  int curvature_smoothing_window = 10;
+
+  // Trace records of the planning calls, drained by the caller or a TraceConsumer, "verbose" echoes them to stderr
+  TraceBuffer trace;
+
 
 private:
 
   std::optional<dynamics::VehicleStateDynamic> previous_state;
+  std::shared_ptr<LaneAttributeCache>          lane_cache = std::make_shared<LaneAttributeCache>();
+
+  // Working buffers of the pipeline, kept between calls
+  PathBuffer          path;
+  PathBuffer          path_scratch;
+  std::vector<double> curvature_scratch;
+  std::vector<double> spline_samples;
 
-  dynamics::Trajectory generate_trajectory_from_route( const dynamics::VehicleStateDynamic& current_state, const map::Map& local_map,
-                                                       const std::deque<map::MapPoint>& route_points, double initial_speed );
+  void generate_trajectory_from_route( dynamics::Trajectory& trajectory, const dynamics::VehicleStateDynamic& current_state,
+                                       const std::deque<map::MapPoint>& route_points, double initial_speed );
 
+  // The stages below fill the per point results of the path buffer in place
+  void compute_curvatures( PathBuffer& points );
 
-  std::vector<double> compute_curvatures( const std::deque<map::MapPoint>& points );
+  void resolve_lanes( PathBuffer& points );
 
-  std::vector<double> generate_speed_profile( const std::vector<double>& distances, const std::deque<map::MapPoint>& route_points,
-                                              const std::vector<double>& curvatures, const map::Map& local_map, double initial_speed );
+  void generate_speed_profile( PathBuffer& points, double initial_speed );
 
 
-  std::vector<double> compute_cumulative_times( const std::vector<double>& distances, const std::vector<double>& speeds );
+  void compute_cumulative_times( PathBuffer& points );
 
 
-  dynamics::Trajectory resample_trajectory( const dynamics::VehicleStateDynamic& current_state, const std::vector<double>& times,
-                                            const std::deque<map::MapPoint>& points, const std::vector<double>& speeds,
-                                            const std::vector<double>& curvatures );
+  void resample_trajectory( const dynamics::VehicleStateDynamic& current_state, const PathBuffer& points, dynamics::Trajectory& trajectory );
 
-  std::vector<double> compute_cumulative_distances( const std::deque<map::MapPoint>& points );
+  void compute_cumulative_distances( PathBuffer& points );
 
-  std::deque<map::MapPoint> filter_close_points( const std::deque<map::MapPoint>& points );
+  void filter_close_points( const std::deque<map::MapPoint>& route_points, PathBuffer& points );
 
   // Apply the spline_into_start to replace the first 2 seconds of trajectory points
-  void spline_into_start( const dynamics::VehicleStateDynamic& current_state, std::deque<map::MapPoint>& route_points );
+  void spline_into_start( const dynamics::VehicleStateDynamic& current_state, PathBuffer& points );
 };
 } // namespace planner
 } // namespace adore
@@ -16,9 +16,12 @@
 
 #include <cmath>
 
+#include <functional>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Dense>
 
@@ -27,6 +30,10 @@
 #include "dynamics/traffic_participant.hpp"
 #include "dynamics/trajectory.hpp"
 #include "dynamics/vehicle_state.hpp"
+#include "planning/agent_grid.hpp"
+#include "planning/batch_bicycle_integrator.hpp"
+#include "planning/route_projection.hpp"
+#include "planning/thread_pool.hpp"
 
 namespace adore
 {
@@ -65,23 +72,57 @@ public:
   double min_distance = 3.0;
   double time_headway = 3.0;
 
+  // Only participants within this distance are projected onto the route in the obstacle search. Off by default (0), as
+  // an obstacle farther away than the radius is then ignored; set it above the largest following distance to enable it
+  double obstacle_search_radius = 0.0;
+
   dynamics::VehicleCommandLimits limits;
 
+  // Parallel prediction: all agents advance from the states of the previous step (Jacobi update),
+  // so the result does not depend on the number of threads
+  bool parallel_prediction = false;
+  int  number_of_threads   = 1;
+
+  // Batch integration: all agents are kept in structure of arrays form and advanced together with the kinematic
+  // bicycle model. Uses the same update order as the parallel prediction.
+  bool batch_integration = false;
+
 
 private:
 
+  std::unique_ptr<ThreadPool> thread_pool;
+  AgentGrid                   agent_grid;
+  double                      agent_grid_padding = 0.0;
+
+  // Last projection of every agent onto its own route, entries are created before the integration starts
+  std::unordered_map<int, RouteProjectionHint> route_hints;
+
+  // Agent states of the running batch integration, nullptr otherwise
+  const BatchBicycleState*        batch_state = nullptr;
+  std::unordered_map<int, size_t> batch_index;
+  BatchBicycleState               batch;
+
+  void plan_trajectories_batch( dynamics::TrafficParticipantSet& traffic_participant_set );
+
+  void build_agent_grid( const dynamics::TrafficParticipantSet& traffic_participant_set );
+
+  dynamics::VehicleStateDynamic predict_next_state( const dynamics::TrafficParticipant&    participant,
+                                                    const dynamics::TrafficParticipantSet& traffic_participant_set, int id );
+
   dynamics::VehicleStateDynamic   get_current_state( const dynamics::TrafficParticipant& participant );
+  dynamics::VehicleStateDynamic   get_current_state( int id, const dynamics::TrafficParticipant& participant );
   adore::dynamics::VehicleCommand compute_vehicle_command( const adore::dynamics::VehicleStateDynamic&   current_state,
                                                            const adore::dynamics::TrafficParticipantSet& traffic_participant_set,
                                                            const int                                     id );
 
   std::pair<double, double> compute_lane_following_errors( const dynamics::VehicleStateDynamic& current_state,
-                                                           const dynamics::TrafficParticipant&  participant );
+                                                           const dynamics::TrafficParticipant& participant, double current_s );
   double compute_error_lateral_distance( const dynamics::VehicleStateDynamic& current_state, const math::Pose2d& target_pose );
   double compute_error_yaw( const double current_yaw, const double yaw_objective );
 
   std::tuple<double, double, double> compute_distance_speed_offset_nearest_obstacle(
-    const dynamics::TrafficParticipantSet& traffic_participant_set, int id_vehicle );
+    const dynamics::VehicleStateDynamic& current_state, double current_s, const dynamics::TrafficParticipantSet& traffic_participant_set,
+    int id_vehicle );
 
   double compute_idm_velocity( double dist_to_nearest_object, double distance_to_goal, double nearest_object_speed,
                                const dynamics::VehicleStateDynamic& current_state );
@@ -0,0 +1,152 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Sanath Himasekhar Konthala
+ ********************************************************************************/
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "OptiNLC_Data.h"
+#include "OptiNLC_OCP.h"
+#include "OptiNLC_Options.h"
+#include "OptiNLC_Solver.h"
+#include "planning/real_time_iteration.hpp"
+#include "planning/warm_start.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Solver side shared by the OptiNLC planners: options, OCP and solver, warm start and real time iteration settings.
+// OCP and solver are built on the first solve after a parameter change and reused every cycle, so the lambdas a
+// planner registers must only read members the planner updates per cycle.
+template<typename Scalar, int InputSize, int StateSize, int ConstraintsSize, int ControlPoints>
+class OCPSolver
+{
+public:
+
+  using OCP    = OptiNLC_OCP<Scalar, InputSize, StateSize, ConstraintsSize, ControlPoints>;
+  using Solver = OptiNLC_Solver<Scalar, InputSize, StateSize, ConstraintsSize, ControlPoints>;
+
+  OptiNLC_Options                                        options;
+  RealTimeIteration                                      real_time_iteration;
+  bool                                                   use_warm_start = false;
+  bool                                                   warm_started   = false; // the last solve was seeded from warm_start
+  WarmStart<StateSize, InputSize, ControlPoints, Scalar> warm_start;
+
+  // Handles the parameters common to the OptiNLC planners, false for a parameter of the planner itself
+  bool
+  set_parameter( const std::string& name, double value )
+  {
+    if( name == "warm_start" )
+      use_warm_start = value != 0.0;
+    else
+      return real_time_iteration.set_parameter( name, value );
+    return true;
+  }
+
+  // Ends set_parameters of a planner: bounded iterations and the deadline replace the full solve settings in real
+  // time iteration mode, and the OCP is rebuilt with the new options on the next solve
+  void
+  configure()
+  {
+    real_time_iteration.apply( options );
+    reset();
+  }
+
+  void
+  reset()
+  {
+    solver.reset();
+    ocp.reset();
+  }
+
+  // Solver of the current options, setup( ocp ) registers the planner lambdas when the OCP is rebuilt
+  template<typename Setup>
+  Solver&
+  get( Setup&& setup )
+  {
+    if( !solver )
+    {
+      ocp = std::make_unique<OCP>( &options );
+      setup( *ocp );
+      solver = std::make_unique<Solver>( *ocp );
+    }
+    return *solver;
+  }
+
+  // Seconds available per planning call, sets the solver deadline in real time iteration mode. The OCP reads the
+  // options through its pointer on every solve, so a new deadline applies to the next solve without a rebuild.
+  void
+  set_cycle_budget( double cycle_budget )
+  {
+    if( real_time_iteration.set_cycle_budget( cycle_budget ) )
+      options.OptiNLC_time_limit = real_time_iteration.deadline();
+  }
+
+  // Warm start or real time iteration requested
+  bool
+  seeding_enabled() const
+  {
+    return use_warm_start || real_time_iteration.enabled;
+  }
+
+  // Shifts the last accepted solution to current_time, false if warm starting is off or no solution is usable.
+  // solve_time is the start time passed to the solver, current_time in the OCP frame.
+  bool
+  seed( double current_time, double solve_time )
+  {
+    warm_started    = seeding_enabled() && warm_start.shift( current_time );
+    seed_solve_time = solve_time;
+    return warm_started;
+  }
+
+  // Result of the input update of the OCP. OptiNLC rolls the initial trajectory of a solve out from the initial state
+  // with the inputs returned by the input update, so a seeded solve starts from the whole shifted solution instead of
+  // holding the first input over the horizon. Unseeded solves keep the input unchanged.
+  VECTOR<Scalar, InputSize>
+  seeded_input( const VECTOR<Scalar, InputSize>& input, Scalar time ) const
+  {
+    if( !warm_started )
+      return input;
+    return warm_start.input_at( static_cast<double>( time ) - seed_solve_time );
+  }
+
+  // Keeps an accepted solution for the next seed
+  template<typename StateVector, typename InputVector>
+  void
+  store( const StateVector& opt_x, const InputVector& opt_u, double solution_start_time )
+  {
+    warm_start.store( opt_x, opt_u, solution_start_time, options.timeStep );
+  }
+
+  void
+  report( SolveReport& solve_report, double solve_time ) const
+  {
+    solve_report.iteration_budget = options.maxNumberOfIteration;
+    solve_report.solve_time       = solve_time;
+    solve_report.deadline         = options.OptiNLC_time_limit;
+    solve_report.deadline_met     = solve_time <= options.OptiNLC_time_limit;
+    solve_report.warm_started     = warm_started;
+  }
+
+private:
+
+  std::unique_ptr<OCP>    ocp;
+  std::unique_ptr<Solver> solver;
+  double                  seed_solve_time = 0.0;
+};
+
+} // namespace planner
+} // namespace adore
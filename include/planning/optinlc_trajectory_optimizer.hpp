@@ -15,9 +15,11 @@
 
 #include <cmath>
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <vector>
 
 #include "adore_math/angles.h"
@@ -28,16 +30,24 @@
 #include "OptiNLC_Options.h"
 #include "OptiNLC_Solver.h"
 #include "dynamics/trajectory.hpp"
+#include "planning/ocp_solver.hpp"
+#include "planning/planner_precision.hpp"
+#include "planning/planner_stats.hpp"
+#include "planning/trace_buffer.hpp"
 
 namespace adore
 {
 namespace planner
 {
 
-class OptiNLCTrajectoryOptimizer
+template<int ControlPoints, int HorizonMs, typename Precision = DoublePrecision>
+class OptiNLCTrajectoryOptimizerT
 {
 public:
 
+  using Scalar     = typename Precision::Scalar;
+  using Evaluation = typename Precision::Evaluation;
+
   enum STATES
   {
     X,
@@ -55,8 +65,8 @@ public:
 
   static constexpr int    state_size       = 5;
   static constexpr int    input_size       = 2;
-  static constexpr int    control_points   = 30;
-  static constexpr double sim_time         = 3.0; // Simulation time for the MPC
+  static constexpr int    control_points   = ControlPoints;
+  static constexpr double sim_time         = HorizonMs / 1000.0; // Simulation time for the MPC
   static constexpr int    constraints_size = 0;
 
 
@@ -75,38 +85,117 @@ private:
   double bad_counter         = 0;
   int    counter             = 0;
 
-  // Variables for MPC solver configuration
-  OptiNLC_Options options;
+  // Statistics of the last call
+  PlannerStats last_stats;
+
+  // OptiNLC options, OCP, solver and warm start
+  OCPSolver<Scalar, input_size, state_size, constraints_size, control_points> ocp_solver;
+
+  // Origin of the OCP frame, the current position and time for Precision::local_frame and zero otherwise
+  double origin_x    = 0.0;
+  double origin_y    = 0.0;
+  double origin_time = 0.0;
+
+  // Reference trajectory resampled once per solve onto the integration grid of the solver, in the OCP frame
+  struct SampledReference
+  {
+    double              start_time  = 0.0;
+    double              sample_time = 0.1;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> yaw;
+    std::vector<double> vx;
+    std::vector<double> cos_yaw;
+    std::vector<double> sin_yaw;
+  } sampled_reference;
+
+  struct ReferenceSample
+  {
+    double x;
+    double y;
+    double yaw;
+    double vx;
+    double cos_yaw;
+    double sin_yaw;
+  };
+
+  // Helper function to sample the reference trajectory for the current solve
+  void sample_reference( const dynamics::Trajectory& reference_trajectory, double start_time );
+
+  // Helper function to interpolate the sampled reference at a solver time
+  ReferenceSample get_reference_sample( double time ) const;
+
+  // Helper function to check a solution before it seeds the next solve, finite cost and inputs within the limits
+  template<typename InputVector>
+  bool is_solution_valid( const InputVector& opt_u, double final_cost ) const;
 
   // Helper function to define the dynamic model
-  void setup_dynamic_model( OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-                                        OptiNLCTrajectoryOptimizer::control_points>& ocp,
-                            const dynamics::Trajectory&                              trajectory );
+  void setup_dynamic_model( OptiNLC_OCP<Scalar, input_size, state_size, 0, control_points>& ocp );
 
   // Helper function to define the objective function
-  void setup_objective_function( OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-                                             OptiNLCTrajectoryOptimizer::control_points>& ocp );
+  void setup_objective_function( OptiNLC_OCP<Scalar, input_size, state_size, 0, control_points>& ocp );
 
   // Helper function to set constraints
-  void setup_constraints( OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-                                      OptiNLCTrajectoryOptimizer::control_points>& ocp );
+  void setup_constraints( OptiNLC_OCP<Scalar, input_size, state_size, 0, control_points>& ocp );
 
   // Helper function to set up the solver and solve the problem
-  bool solve_mpc( OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-                              OptiNLCTrajectoryOptimizer::control_points>& ocp,
-                  VECTOR<double, state_size>& initial_state, VECTOR<double, input_size>& initial_input, std::vector<double>& delta_output,
+  bool solve_mpc( OptiNLC_OCP<Scalar, input_size, state_size, 0, control_points>& ocp,
+                  VECTOR<Scalar, state_size>& initial_state, VECTOR<Scalar, input_size>& initial_input, std::vector<double>& delta_output,
                   std::vector<double>& acc_output, double current_time );
 
 public:
 
-  OptiNLCTrajectoryOptimizer();
+  OptiNLCTrajectoryOptimizerT();
+  OptiNLCTrajectoryOptimizerT( const OptiNLCTrajectoryOptimizerT& )            = delete;
+  OptiNLCTrajectoryOptimizerT& operator=( const OptiNLCTrajectoryOptimizerT& ) = delete;
+
   dynamics::VehicleCommandLimits limits;
 
   // Public method to get the next vehicle command based on OptiNLCTrajectoryOptimizer
   dynamics::Trajectory plan_trajectory( const dynamics::Trajectory&          reference_trajectory,
                                         const dynamics::VehicleStateDynamic& current_state );
 
+  // Same as plan_trajectory but fills trajectory in place, its storage is reused between calls
+  void plan_trajectory_into( dynamics::Trajectory& trajectory, const dynamics::Trajectory& reference_trajectory,
+                             const dynamics::VehicleStateDynamic& current_state );
+
   void set_parameters( const std::map<std::string, double>& params );
+
+  // True if the last solve was seeded from the shifted previous solution
+  bool
+  is_warm_started() const
+  {
+    return ocp_solver.warm_started;
+  }
+
+  // Seconds available per planning call, sets the solver deadline in real time iteration mode
+  void set_cycle_budget( double cycle_budget );
+
+  // Iteration budget, solve time and deadline of the last call
+  const SolveReport&
+  get_solve_report() const
+  {
+    return last_stats.solve;
+  }
+
+  // Stage timings, solver statistics and fallback flag of the last call
+  const PlannerStats&
+  get_stats() const
+  {
+    return last_stats;
+  }
+
+  // Trace records of the planning calls, drained by the caller or a TraceConsumer, "verbose" echoes them to stderr
+  TraceBuffer trace;
 };
+
+// Horizon variants instantiated in the translation unit, the default keeps the original 30 points over 3 s
+using OptiNLCTrajectoryOptimizer          = OptiNLCTrajectoryOptimizerT<30, 3000>;
+using LowSpeedOptiNLCTrajectoryOptimizer  = OptiNLCTrajectoryOptimizerT<20, 2000>;
+using HighSpeedOptiNLCTrajectoryOptimizer = OptiNLCTrajectoryOptimizerT<40, 4000>;
+
+// Float solver variants of the default horizon
+using FloatSolverOptiNLCTrajectoryOptimizer     = OptiNLCTrajectoryOptimizerT<30, 3000, FloatSolverPrecision>;
+using SinglePrecisionOptiNLCTrajectoryOptimizer = OptiNLCTrajectoryOptimizerT<30, 3000, SinglePrecision>;
 } // namespace planner
 } // namespace adore
@@ -18,6 +18,9 @@
 #include <chrono>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "adore_map/map.hpp"
@@ -33,6 +36,14 @@
 #include "OptiNLC_Solver.h"
 #include "dynamics/traffic_participant.hpp"
 #include "dynamics/trajectory.hpp"
+#include "planning/curvature_smoothing.hpp"
+#include "planning/lane_attribute_cache.hpp"
+#include "planning/ocp_solver.hpp"
+#include "planning/planner_precision.hpp"
+#include "planning/planner_stats.hpp"
+#include "planning/reference_path_evaluator.hpp"
+#include "planning/trace_buffer.hpp"
+#include "planning/route_projection.hpp"
 
 namespace adore
 {
@@ -45,10 +56,14 @@ struct route_to_piecewise_polynomial
   adore::math::PiecewisePolynomial::PiecewiseStruct heading;
 };
 
-class OptiNLCTrajectoryPlanner
+template<int ControlPoints, int HorizonMs, typename Precision = DoublePrecision>
+class OptiNLCTrajectoryPlannerT
 {
 public:
 
+  using Scalar     = typename Precision::Scalar;
+  using Evaluation = typename Precision::Evaluation;
+
   enum STATES
   {
     X,
@@ -67,8 +82,8 @@ public:
 
   static constexpr int    state_size       = 7;
   static constexpr int    input_size       = 1;
-  static constexpr int    control_points   = 30;
-  static constexpr double sim_time         = 3.0; // Simulation time for the Planner
+  static constexpr int    control_points   = ControlPoints;
+  static constexpr double sim_time         = HorizonMs / 1000.0; // Simulation time for the Planner
   static constexpr int    constraints_size = 0;
 
 
@@ -85,8 +100,32 @@ private:
     std::vector<double> width;
   } route_to_follow;
 
-  route_to_piecewise_polynomial setup_optimizer_parameters_using_route( const adore::map::Route&             latest_route,
-                                                                        const dynamics::VehicleStateDynamic& current_state );
+  // Fitted route window that is reused while the route is unchanged and the window still covers the horizon
+  struct RouteWindowCache
+  {
+    bool                          valid = false;
+    RouteFingerprint              fingerprint;
+    double                        start_s = 0.0;
+    double                        end_s   = 0.0;
+    route_to_piecewise_polynomial route; // fitted route window, also holds the fit of a cycle without reuse
+  } route_window_cache;
+
+  bool   use_incremental_route = false;
+  double route_window_margin   = 20.0; // additional route length fitted so that the window can be reused for a few cycles
+  double route_s_offset        = 0.0;  // progress of the ego vehicle inside the fitted route window
+  size_t route_start_index     = 0;    // first point of route_to_follow ahead of the ego vehicle
+
+  // Route projections of the ego vehicle and the traffic participants, started from the progress of the last cycle
+  double                                       ego_route_s = 0.0;
+  RouteProjection                              ego_route_projection;
+  bool                                         ego_route_valid = false;
+  RouteProjectionHint                          ego_route_hint;
+  std::unordered_map<int, RouteProjectionHint> participant_route_hints;
+
+  bool is_same_route( const RouteFingerprint& fingerprint ) const;
+
+  // Fits the route window ahead of the ego vehicle, the result is empty if the route is unusable
+  const route_to_piecewise_polynomial& setup_optimizer_parameters_using_route( const adore::map::Route& latest_route );
 
   double lateral_weight            = 0.01;
   double heading_weight            = 0.06;
@@ -115,6 +154,12 @@ private:
   double              lateral_acceleration      = 0.75; // max lateral acceleration 1.0 m/s²
   double              minimum_velocity_in_curve = 1.5; // min velocity in a curve 2 m/s²
 
+  // Half width of the curvature moving average in route points
+  int                 curvature_smoothing_window = 3;
+  std::vector<double> curvature_scratch;
+
+  std::shared_ptr<LaneAttributeCache> lane_cache = std::make_shared<LaneAttributeCache>();
+
   // IDM related members
   double min_distance_to_vehicle_ahead = 10.0; // 10 meters minimum gap to vehicle in front
   double desired_time_headway          = 1.5;  // 1.5 seconds time headway
@@ -124,6 +169,34 @@ private:
   double tau                           = 2.5;  // first order velocity profile
   double distance_to_goal              = 100.0;
   int    prediction_horizon            = 40; // 40 points for 4 seconds prediction horizon
+  bool   use_predicted_obstacles       = false; // constant velocity prediction of the participants over prediction_horizon
+  double obstacle_search_distance      = 0.0; // route length ahead searched for obstacles, 0 (default) checks every participant
+  double corridor_margin               = 5.0; // lateral margin of the route corridor box, covers half a lane width
+
+  // Participants searched for obstacles, see set_participant_filter
+  const std::vector<int>* participant_filter = nullptr;
+  std::optional<int>      ignored_participant;
+
+  // Axis aligned box around the route ahead of the ego vehicle, rebuilt once per cycle
+  struct CorridorBox
+  {
+    double min_x = 0.0;
+    double max_x = 0.0;
+    double min_y = 0.0;
+    double max_y = 0.0;
+
+    bool
+    contains( double x, double y, double margin ) const
+    {
+      return x >= min_x - margin && x <= max_x + margin && y >= min_y - margin && y <= max_y + margin;
+    }
+  } route_corridor;
+
+  // Predicted participant positions, step major per participant
+  std::vector<const dynamics::TrafficParticipant*> obstacle_candidates;
+  std::vector<int>                                 obstacle_candidate_ids;
+  std::vector<double>                              predicted_x;
+  std::vector<double>                              predicted_y;
 
   // Variables to store previous commands
   double               last_steering_angle = 0.0;
@@ -132,51 +205,136 @@ private:
   double steering_rate = 1.0;
   int iteration = 0;
   bool                 bad_condition       = false;
-  dynamics::Trajectory previous_trajectory;
+  dynamics::Trajectory previous_trajectory;  // last accepted solution, returned by plan_trajectory_ref
+  dynamics::Trajectory candidate_trajectory; // solution of the current call, swapped into previous_trajectory on acceptance
 
-  // Variables to convert route to piecewise polynomial function
-  adore::math::PiecewisePolynomial                  pp;
-  adore::math::PiecewisePolynomial::PiecewiseStruct route_x;
-  adore::math::PiecewisePolynomial::PiecewiseStruct route_y;
-  adore::math::PiecewisePolynomial::PiecewiseStruct route_heading;
+  // Statistics of the last call
+  PlannerStats last_stats;
 
-  // Variables for MPC solver configuration
-  OptiNLC_Options options;
+  // Variables to convert route to piecewise polynomial function, the splines are the ones of route_window_cache
+  adore::math::PiecewisePolynomial pp;
+  ReferencePathEvaluator           reference_path;
+
+  // Solver side of the planner, see ocp_solver.hpp
+  OCPSolver<Scalar, input_size, state_size, constraints_size, control_points> ocp_solver;
+
+  // Origin of the OCP frame, the current position and time for Precision::local_frame and zero otherwise
+  double origin_x    = 0.0;
+  double origin_y    = 0.0;
+  double origin_time = 0.0;
 
   // Helper function to define the dynamic model
-  void setup_dynamic_model( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp );
+  void setup_dynamic_model( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp );
 
   // Helper function to define the objective function
-  void setup_objective_function( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp );
+  void setup_objective_function( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp );
 
   // Helper function to set constraints
-  void setup_constraints( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp );
+  void setup_constraints( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp );
 
   // Helper function to set up route to follow to piecewise polynomial
-  void setup_reference_route( route_to_piecewise_polynomial& reference_route );
+  void setup_reference_route( const route_to_piecewise_polynomial& reference_route );
 
   // Helper function to get reference velocity
   std::vector<double> compute_curvatures( const dynamics::VehicleStateDynamic& current_state );
   void   setup_reference_velocity( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
                                    const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants );
+  void   update_route_corridor( const map::Route& latest_route, double state_s );
+  void   predict_obstacle_candidates();
   double calculate_idm_velocity( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
-                                 const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants );
+                                 const dynamics::TrafficParticipantSet& traffic_participants );
 
   // Helper function to set up the solver and solve the problem
-  bool solve_mpc( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp,
-                  VECTOR<double, state_size>& initial_state, VECTOR<double, input_size>& initial_input, std::vector<double>& delta_output,
+  bool solve_mpc( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp,
+                  VECTOR<Scalar, state_size>& initial_state, VECTOR<Scalar, input_size>& initial_input, std::vector<double>& delta_output,
                   std::vector<double>& acc_output, double current_time );
 
 public:
 
-  OptiNLCTrajectoryPlanner();
+  OptiNLCTrajectoryPlannerT();
+  OptiNLCTrajectoryPlannerT( const OptiNLCTrajectoryPlannerT& )            = delete;
+  OptiNLCTrajectoryPlannerT& operator=( const OptiNLCTrajectoryPlannerT& ) = delete;
+
   dynamics::VehicleCommandLimits limits;
 
   // Public method to get the next vehicle command based on OptiNLCTrajectoryPlanner
   dynamics::Trajectory plan_trajectory( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
                                         const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants );
 
+  // Same as plan_trajectory but fills trajectory in place, its storage is reused between calls
+  void plan_trajectory_into( dynamics::Trajectory& trajectory, const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                             const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants );
+
+  // Same as plan_trajectory without copying, the trajectory is owned by the planner and valid until the next call
+  const dynamics::Trajectory& plan_trajectory_ref( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                                                   const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants );
+
   void set_parameters( const std::map<std::string, double>& params );
+
+  // True if the last solve was seeded from the shifted previous solution
+  bool
+  is_warm_started() const
+  {
+    return ocp_solver.warm_started;
+  }
+
+  // Seconds available per planning call, sets the solver deadline in real time iteration mode
+  void set_cycle_budget( double cycle_budget );
+
+  // Forgets the previous solution and the warm start, the next solve is accepted as if it were the first one
+  void
+  reset_solution()
+  {
+    previous_trajectory.states.clear();
+    ocp_solver.warm_start.reset();
+    ocp_solver.warm_started = false;
+    bad_counter             = 0;
+    bad_condition           = false;
+    iteration               = 0;
+  }
+
+  // Shares the lane attributes with other planners running on the same thread
+  void
+  set_lane_attribute_cache( std::shared_ptr<LaneAttributeCache> cache )
+  {
+    lane_cache = std::move( cache );
+  }
+
+  // Restricts the obstacle search to the participants with these ids, null (default) searches all of them. The ids are
+  // owned by the caller and must outlive the planning calls. The ignored participant, e.g. the planned vehicle itself
+  // when it is part of the set, is never an obstacle.
+  void
+  set_participant_filter( const std::vector<int>* ids, std::optional<int> ignored_id = std::nullopt )
+  {
+    participant_filter  = ids;
+    ignored_participant = ignored_id;
+  }
+
+  // Iteration budget, solve time and deadline of the last call
+  const SolveReport&
+  get_solve_report() const
+  {
+    return last_stats.solve;
+  }
+
+  // Stage timings, solver statistics and fallback flag of the last call
+  const PlannerStats&
+  get_stats() const
+  {
+    return last_stats;
+  }
+
+  // Trace records of the planning calls, drained by the caller or a TraceConsumer, "verbose" echoes them to stderr
+  TraceBuffer trace;
 };
+
+// Horizon variants instantiated in the translation unit, the default keeps the original 30 points over 3 s
+using OptiNLCTrajectoryPlanner          = OptiNLCTrajectoryPlannerT<30, 3000>;
+using LowSpeedOptiNLCTrajectoryPlanner  = OptiNLCTrajectoryPlannerT<20, 2000>;
+using HighSpeedOptiNLCTrajectoryPlanner = OptiNLCTrajectoryPlannerT<40, 4000>;
+
+// Float solver variants of the default horizon
+using FloatSolverOptiNLCTrajectoryPlanner     = OptiNLCTrajectoryPlannerT<30, 3000, FloatSolverPrecision>;
+using SinglePrecisionOptiNLCTrajectoryPlanner = OptiNLCTrajectoryPlannerT<30, 3000, SinglePrecision>;
 } // namespace planner
 } // namespace adore
\ No newline at end of file
@@ -0,0 +1,129 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "adore_map/map.hpp"
+#include "adore_math/distance.h"
+#include "adore_math/point.h"
+#include "planning/lane_attribute_cache.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Route points in structure of arrays form with the per point results of the lane follow pipeline.
+// The buffer is kept between planning calls, so after the first calls the stages run without allocations.
+struct PathBuffer
+{
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<size_t> lane_id;
+  std::vector<double> speed_limit; // max speed of the route point, infinity if there is none
+
+  // Filled by the pipeline stages
+  std::vector<const LaneAttributes*> lane; // resolved lane_id
+  std::vector<double>                s;
+  std::vector<double>                curvature;
+  std::vector<double>                speed;
+  std::vector<double>                time;
+
+  size_t
+  size() const
+  {
+    return x.size();
+  }
+
+  bool
+  empty() const
+  {
+    return x.empty();
+  }
+
+  void
+  clear()
+  {
+    x.clear();
+    y.clear();
+    lane_id.clear();
+    speed_limit.clear();
+  }
+
+  void
+  push_back( double point_x, double point_y, size_t point_lane_id, double point_speed_limit )
+  {
+    x.push_back( point_x );
+    y.push_back( point_y );
+    lane_id.push_back( point_lane_id );
+    speed_limit.push_back( point_speed_limit );
+  }
+
+  void
+  push_back( const map::MapPoint& point )
+  {
+    push_back( point.x, point.y, point.parent_id, point.max_speed ? point.max_speed.value() : std::numeric_limits<double>::infinity() );
+  }
+
+  // Appends the points [first, last) of other
+  void
+  append( const PathBuffer& other, size_t first, size_t last )
+  {
+    x.insert( x.end(), other.x.begin() + first, other.x.begin() + last );
+    y.insert( y.end(), other.y.begin() + first, other.y.begin() + last );
+    lane_id.insert( lane_id.end(), other.lane_id.begin() + first, other.lane_id.begin() + last );
+    speed_limit.insert( speed_limit.end(), other.speed_limit.begin() + first, other.speed_limit.begin() + last );
+  }
+
+  void
+  erase_front( size_t count )
+  {
+    x.erase( x.begin(), x.begin() + count );
+    y.erase( y.begin(), y.begin() + count );
+    lane_id.erase( lane_id.begin(), lane_id.begin() + count );
+    speed_limit.erase( speed_limit.begin(), speed_limit.begin() + count );
+  }
+
+  math::Point2d
+  point( size_t i ) const
+  {
+    return math::Point2d( x[i], y[i] );
+  }
+
+  double
+  distance( size_t i, size_t j ) const
+  {
+    return adore::math::distance_2d( point( i ), point( j ) );
+  }
+
+  void
+  swap( PathBuffer& other )
+  {
+    x.swap( other.x );
+    y.swap( other.y );
+    lane_id.swap( other.lane_id );
+    speed_limit.swap( other.speed_limit );
+    lane.swap( other.lane );
+    s.swap( other.s );
+    curvature.swap( other.curvature );
+    speed.swap( other.speed );
+    time.swap( other.time );
+  }
+};
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,43 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <type_traits>
+
+namespace adore
+{
+namespace planner
+{
+
+// Numeric types of an OCP planner. Scalar is the type of the OCP, the solver and the dynamic model, Evaluation the
+// type in which the tracking errors and the cost rate are evaluated before they are handed to the solver. The solver
+// integrates the cost rate into the cost state in Scalar, so with a float Scalar the cost is accumulated in float.
+//
+// Planners with a Scalar other than double solve in a local frame centered at the vehicle, world coordinates such as
+// UTM positions cannot be resolved to centimeters in float. The map, route and splines always stay in double.
+template<typename ScalarType, typename EvaluationType = double>
+struct PlannerPrecision
+{
+  using Scalar     = ScalarType;
+  using Evaluation = EvaluationType;
+
+  static constexpr bool local_frame = !std::is_same_v<Scalar, double>;
+};
+
+using DoublePrecision      = PlannerPrecision<double, double>;
+using FloatSolverPrecision = PlannerPrecision<float, double>; // float solver and cost state, tracking errors and cost rate in double
+using SinglePrecision      = PlannerPrecision<float, float>;
+
+} // namespace planner
+} // namespace adore
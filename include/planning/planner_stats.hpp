@@ -0,0 +1,83 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Sanath Himasekhar Konthala
+ ********************************************************************************/
+#pragma once
+
+#include <chrono>
+
+#include "planning/real_time_iteration.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Statistics of the last plan_trajectory call, stage timings in seconds. Collecting them costs a few clock reads
+// and one counter increment per model evaluation, so they are always on.
+struct PlannerStats
+{
+  double route_preprocessing_time = 0.0; // route, border or reference preparation
+  double reference_velocity_time  = 0.0; // reference velocity and IDM
+  double ocp_setup_time           = 0.0; // warm start and solver rebuild
+  double solve_time               = 0.0;
+  double conversion_time          = 0.0; // solver output to trajectory
+  double total_time               = 0.0;
+
+  SolveReport solve;
+
+  // OptiNLC does not report the number of SQP iterations, the dynamic model evaluations of the solve are counted instead
+  long   model_evaluations = 0;
+  double final_cost        = 0.0;
+  bool   fallback          = false; // previous_trajectory was returned instead of the new solution
+
+  bool
+  time_limit_hit() const
+  {
+    return !solve.deadline_met;
+  }
+};
+
+// Time between consecutive laps, lap() returns the time since the last lap or the construction
+class StageClock
+{
+public:
+
+  StageClock() :
+    start( std::chrono::steady_clock::now() ),
+    last( start )
+  {}
+
+  double
+  lap()
+  {
+    auto                          now     = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = now - last;
+    last                                  = now;
+    return elapsed.count();
+  }
+
+  double
+  total() const
+  {
+    std::chrono::duration<double> elapsed = last - start;
+    return elapsed.count();
+  }
+
+private:
+
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point last;
+};
+
+} // namespace planner
+} // namespace adore
@@ -20,6 +20,7 @@
 #include <iostream>
 #include <limits>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "adore_math/spline.h"
@@ -27,12 +28,17 @@
 #include "dynamics/integration.hpp"
 #include "dynamics/physical_vehicle_model.hpp"
 #include "dynamics/vehicle_state.hpp"
+#include "planning/agent_grid.hpp"
 #include <eigen3/Eigen/Dense>
 
 namespace adore
 {
 namespace planner
 {
+// Coordinate type of a point, the geometric helpers below compute in it so that they also work on float points
+template<typename Point>
+using coordinate_t = std::decay_t<decltype( std::declval<const Point&>().x )>;
+
 // Checks if the point is to the right of the first segment in the line
 template<typename Point, typename Line>
 bool
@@ -48,15 +54,17 @@ is_point_to_right_of_line( const Point& point, const Line& line )
   const auto& p2 = line[1];
 
   // Calculate the direction vector of the first line segment
-  double line_dx = p2.x - p1.x;
-  double line_dy = p2.y - p1.y;
+  using Scalar = coordinate_t<Point>;
+
+  Scalar line_dx = p2.x - p1.x;
+  Scalar line_dy = p2.y - p1.y;
 
   // Calculate the vector from p1 to the point in question
-  double point_dx = point.x - p1.x;
-  double point_dy = point.y - p1.y;
+  Scalar point_dx = point.x - p1.x;
+  Scalar point_dy = point.y - p1.y;
 
   // Calculate the cross product of the line direction and point vector
-  double cross_product = line_dx * point_dy - line_dy * point_dx;
+  Scalar cross_product = line_dx * point_dy - line_dy * point_dx;
 
   // If cross_product is negative, the point is to the right of the first line segment
   return cross_product < 0;
@@ -66,20 +74,22 @@ template<typename Line, typename Pose>
 Line
 filter_points_in_front( const Line& line, const Pose& reference_pose )
 {
+  using Scalar = coordinate_t<typename Line::value_type>;
+
   Line filtered_points;
 
   // Calculate unit vector for the reference orientation
-  double ref_dx = std::cos( reference_pose.yaw_angle );
-  double ref_dy = std::sin( reference_pose.yaw_angle );
+  Scalar ref_dx = std::cos( reference_pose.yaw_angle );
+  Scalar ref_dy = std::sin( reference_pose.yaw_angle );
 
   for( const auto& point : line )
   {
     // Vector from reference position to the current point
-    double dx = point.x - reference_pose.x;
-    double dy = point.y - reference_pose.y;
+    Scalar dx = point.x - reference_pose.x;
+    Scalar dy = point.y - reference_pose.y;
 
     // Dot product to determine if the point is in front of the reference pose
-    double dot_product = dx * ref_dx + dy * ref_dy;
+    Scalar dot_product = dx * ref_dx + dy * ref_dy;
     if( dot_product > 0 )
     { // If dot product is positive, the point is in front
       filtered_points.push_back( point );
@@ -97,11 +107,13 @@ shift_points_right( const Line& points, double shift_distance )
   if( points.size() < 2 )
     return points;
 
+  using Scalar = coordinate_t<typename Line::value_type>;
+
   Line shifted_points;
 
   for( size_t i = 0; i < points.size(); ++i )
   {
-    double dx, dy;
+    Scalar dx, dy;
 
     if( i == points.size() - 1 )
     {
@@ -117,13 +129,13 @@ shift_points_right( const Line& points, double shift_distance )
     }
 
     // Normalize direction vector
-    double length  = std::sqrt( dx * dx + dy * dy );
+    Scalar length  = std::sqrt( dx * dx + dy * dy );
     dx            /= length;
     dy            /= length;
 
     // Calculate perpendicular direction to the right
-    double shift_dx = dy * shift_distance;
-    double shift_dy = -dx * shift_distance;
+    Scalar shift_dx = dy * shift_distance;
+    Scalar shift_dy = -dx * shift_distance;
 
     // Apply shift to the current point
     auto shifted_point  = points[i];
@@ -172,43 +184,72 @@ compute_idm_velocity( double obstacle_distance, double goal_distance, double obs
        + desired_acceleration * ( 1 - std::pow( current_state.vx / max_speed, 4 ) - std::pow( s_star / effective_distance, 2 ) );
 }
 
-// compute the distance to the nearest object, if within a certain radius from the center of the waypoint lane, considering obstacle fixed
+// Waypoint spline sampled at fixed arc length steps, the samples are bucketed in a uniform grid for radius queries
+struct WaypointSamples
+{
+  double                     ds = 0.1;
+  std::vector<math::Point2d> points;
+  AgentGrid                  grid;
+};
+
+static WaypointSamples
+sample_waypoints( const tk::spline& waypoint_spline_x, const tk::spline& waypoint_spline_y, const double waypoints_length,
+                  double ds = 0.1, double cell_size = 1.0 )
+{
+  WaypointSamples samples;
+  samples.ds          = ds;
+  int number_of_steps = (int) waypoints_length / ds;
+
+  samples.points.reserve( std::max( number_of_steps, 0 ) );
+  samples.grid.clear( cell_size );
+  for( int i = 0; i < number_of_steps; i++ )
+  {
+    math::Point2d waypoint_position;
+    waypoint_position.x = waypoint_spline_x( i * ds );
+    waypoint_position.y = waypoint_spline_y( i * ds );
+    samples.points.push_back( waypoint_position );
+    samples.grid.insert( i, waypoint_position.x, waypoint_position.y );
+  }
+  samples.grid.finalize();
+  return samples;
+}
+
+// compute the distance to the nearest object, if within a certain radius from the sampled waypoint lane, considering obstacle fixed
 static double
-get_distance_to_nearest_obstacle( const tk::spline& waypoint_spline_x, const tk::spline& waypoint_spline_y, const double waypoints_length,
-                                  const dynamics::TrafficParticipantSet& traffic_participants )
+get_distance_to_nearest_obstacle( const WaypointSamples& samples, const dynamics::TrafficParticipantSet& traffic_participants )
 {
-  double ds                     = 0.1; // check step size
-  int    number_of_steps        = (int) waypoints_length / ds;
-  double min_distance_to_object = std::numeric_limits<double>::max();
-  double treshold_within_lane   = 1.0;
+  double           min_distance_to_object = std::numeric_limits<double>::max();
+  double           treshold_within_lane   = 1.0;
+  std::vector<int> candidates;
 
   for( const auto& [id, participant] : traffic_participants.participants )
   {
     math::Point2d object_position;
     object_position.x = participant.state.x;
     object_position.y = participant.state.y;
-    double s          = 0.0;
 
-    for( int i = 0; i < number_of_steps; i++ )
+    // Candidates come sorted by index, the first one within the threshold is the closest along the lane
+    samples.grid.query( object_position.x, object_position.y, treshold_within_lane, candidates );
+    for( int i : candidates )
     {
-      math::Point2d waypoint_position;
-      waypoint_position.x = waypoint_spline_x( s );
-      waypoint_position.y = waypoint_spline_y( s );
-
-      double object_distance = adore::math::distance_2d( object_position, waypoint_position );
-
-      if( object_distance < treshold_within_lane && s < min_distance_to_object )
+      if( adore::math::distance_2d( object_position, samples.points[i] ) < treshold_within_lane )
       {
-        min_distance_to_object = s;
+        min_distance_to_object = std::min( min_distance_to_object, i * samples.ds );
         break;
       }
-
-      s = ( i + 1 ) * ds;
     }
   }
   return min_distance_to_object;
 }
 
+static double
+get_distance_to_nearest_obstacle( const tk::spline& waypoint_spline_x, const tk::spline& waypoint_spline_y, const double waypoints_length,
+                                  const dynamics::TrafficParticipantSet& traffic_participants )
+{
+  return get_distance_to_nearest_obstacle( sample_waypoints( waypoint_spline_x, waypoint_spline_y, waypoints_length ),
+                                           traffic_participants );
+}
+
 template<typename Line>
 dynamics::Trajectory
 waypoints_to_trajectory( const dynamics::VehicleStateDynamic& start_state, const Line& waypoints, double dt, double target_speed,
@@ -223,6 +264,9 @@ waypoints_to_trajectory( const dynamics::VehicleStateDynamic& start_state, const
   tk::spline          spline_x, spline_y;
   std::vector<double> s_vec, x_vec, y_vec;
   double              cumulative_dist = 0.0;
+  s_vec.reserve( waypoints.size() );
+  x_vec.reserve( waypoints.size() );
+  y_vec.reserve( waypoints.size() );
 
   for( size_t i = 0; i < waypoints.size(); ++i )
   {
@@ -245,10 +289,14 @@ waypoints_to_trajectory( const dynamics::VehicleStateDynamic& start_state, const
   dynamics::VehicleStateDynamic current_state = start_state;
   double                        s             = 0.0;
 
+  if( target_speed > 0.0 && dt > 0.0 )
+    trajectory.states.reserve( static_cast<size_t>( cumulative_dist / target_speed / dt ) + 2 );
+
+  // Obstacles are considered fixed, so the distance along the waypoints does not change during the loop
+  double closest_obstacle_distance = get_distance_to_nearest_obstacle( spline_x, spline_y, s_vec.back(), traffic_participants );
+
   for( double time = 0; time <= cumulative_dist / target_speed; time += dt )
   {
-    // calculate the distance to closest object
-    double closest_obstacle_distance = get_distance_to_nearest_obstacle( spline_x, spline_y, s_vec.back(), traffic_participants );
 
     // Calculate acceleration based on speed error
     double speed_error  = target_speed - current_state.vx;
@@ -0,0 +1,317 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "adore_map/map.hpp"
+#include "adore_map/route.hpp"
+#include "adore_math/point.h"
+#include "dynamics/traffic_participant.hpp"
+#include "dynamics/trajectory.hpp"
+#include "dynamics/vehicle_state.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Planner entry point of a recorded call
+enum class PlanningCycleType : uint32_t
+{
+  route,       // plan_trajectory( route, state, map, traffic participants ), e.g. OptiNLCTrajectoryPlanner
+  corridor,    // plan_trajectory( left border, right border, state ), SafetyCorridorPlanner
+  reference,   // plan_trajectory( reference trajectory, state ), OptiNLCTrajectoryOptimizer
+  lane_follow, // plan_trajectory( state, route points, map, limits ), LaneFollowPlanner
+  multi_agent  // plan_trajectories( traffic participants ), MultiAgentPID
+};
+
+const char* planning_cycle_type_name( PlanningCycleType type );
+
+// Inputs and output of one recorded call, only the members used by its type are filled.
+// The map is not part of the log, it is loaded once from the map file and does not change between calls.
+struct PlanningCycle
+{
+  PlanningCycleType type          = PlanningCycleType::route;
+  double            recorded_time = 0.0; // seconds the recorded call took
+
+  std::shared_ptr<const map::Route>    route;                        // shared by all cycles on the same route
+  const std::map<std::string, double>* parameters         = nullptr; // last recorded parameters, owned by the reader
+  bool                                 parameters_changed = false;   // parameters were recorded since the previous cycle
+
+  dynamics::VehicleStateDynamic   state;
+  dynamics::TrafficParticipantSet traffic_participants;
+  std::vector<math::Point2d>      left_border;
+  std::vector<math::Point2d>      right_border;
+  dynamics::Trajectory            reference_trajectory;
+  std::deque<map::MapPoint>       route_points;
+  dynamics::VehicleCommandLimits  limits;
+
+  dynamics::Trajectory            trajectory;           // output of plan_trajectory
+  dynamics::TrafficParticipantSet planned_participants; // output of plan_trajectories
+};
+
+// Append-only binary log of planning calls. Each record is a type, a payload size and the payload, so readers skip
+// records they do not know. Inputs are written field by field, logs of one build stay readable by the next one even
+// if the layout of the dynamics types changes. A route is written once when it changes and the cycles refer to it,
+// a long drive on one route mostly stores states and participants. Of the participants the fields read by the
+// planners are kept: id, state, wheelbase, prediction and route. Participant routes are written once per change of
+// the participant as well, the planned participants of a multi agent cycle are written without routes.
+//
+// Records are encoded on the calling thread and written to the file by a writer thread, so a planning cycle does not
+// wait for the disk. Records are queued while the writer thread is busy, none is dropped.
+class PlanningLogWriter
+{
+public:
+
+  // Appends to the log at path, a new log starts with a header. A cut off record at the end of an existing log is
+  // truncated first, so the appended records stay readable. Throws std::runtime_error if the file cannot be opened or
+  // is not a planning log of this version.
+  explicit PlanningLogWriter( const std::string& path );
+
+  // Writes the queued records and closes the log
+  ~PlanningLogWriter();
+
+  PlanningLogWriter( const PlanningLogWriter& )            = delete;
+  PlanningLogWriter& operator=( const PlanningLogWriter& ) = delete;
+
+  // Parameters passed to set_parameters, they apply to the following cycles
+  void write_parameters( const std::map<std::string, double>& parameters );
+
+  void write_route_cycle( const map::Route& route, const dynamics::VehicleStateDynamic& state,
+                          const dynamics::TrafficParticipantSet& traffic_participants, const dynamics::Trajectory& trajectory,
+                          double recorded_time );
+
+  void write_corridor_cycle( const std::vector<math::Point2d>& left_border, const std::vector<math::Point2d>& right_border,
+                             const dynamics::VehicleStateDynamic& state, const dynamics::Trajectory& trajectory, double recorded_time );
+
+  void write_reference_cycle( const dynamics::Trajectory& reference_trajectory, const dynamics::VehicleStateDynamic& state,
+                              const dynamics::Trajectory& trajectory, double recorded_time );
+
+  void write_lane_follow_cycle( const dynamics::VehicleStateDynamic& state, const std::deque<map::MapPoint>& route_points,
+                                const dynamics::VehicleCommandLimits& limits, const dynamics::Trajectory& trajectory,
+                                double recorded_time );
+
+  void write_multi_agent_cycle( const dynamics::TrafficParticipantSet& traffic_participants,
+                                const dynamics::TrafficParticipantSet& planned_participants, double recorded_time );
+
+  // Blocks until the records of the previous calls are written to the file. Throws std::runtime_error if the writer
+  // thread failed to write a record.
+  void flush();
+
+  // Size of the records of the previous calls, the writer thread may not have written all of them yet
+  size_t
+  bytes_written() const
+  {
+    return written;
+  }
+
+  // The writer thread flushes the file after each batch of records it writes, so a crash loses at most the records
+  // that were still queued
+  std::atomic<bool> flush_each_record{ true };
+
+private:
+
+  void begin_record( uint32_t type );
+  void end_record();
+  void begin_cycle( PlanningCycleType type, double recorded_time );
+  void write_route_if_changed( const map::Route& route );
+  void write_participant_routes_if_changed( const dynamics::TrafficParticipantSet& traffic_participants );
+
+  std::FILE*                                    file = nullptr;
+  std::vector<char>                             buffer; // record being encoded, reused between records
+  size_t                                        written = 0;
+  std::vector<std::pair<double, map::MapPoint>> last_route;
+  bool                                          has_route = false;
+
+  std::unordered_map<int64_t, std::vector<std::pair<double, map::MapPoint>>> participant_routes; // last written per participant
+
+  void writer_loop();
+
+  // Encoded records are appended to pending, the writer thread swaps it with writing and writes it without the lock
+  std::mutex              mutex;
+  std::condition_variable wake_up;
+  std::condition_variable drained;
+  std::vector<char>       pending;
+  std::vector<char>       writing;
+  bool                    writer_busy  = false;
+  bool                    write_failed = false;
+  bool                    stop         = false;
+  std::thread             writer;
+};
+
+// Memory mapped reader of a planning log, decodes one cycle at a time without reading the log into memory first
+class PlanningLogReader
+{
+public:
+
+  // Throws std::runtime_error if the file cannot be mapped or is not a planning log
+  explicit PlanningLogReader( const std::string& path );
+  ~PlanningLogReader();
+
+  PlanningLogReader( const PlanningLogReader& )            = delete;
+  PlanningLogReader& operator=( const PlanningLogReader& ) = delete;
+
+  // Decodes the next cycle, parameter and route records in between are applied on the way. False at the end of the log.
+  // Throws std::runtime_error for a record whose payload does not match its type.
+  bool next( PlanningCycle& cycle );
+
+  void rewind();
+
+  // The last record was cut off, e.g. the recording process was killed while writing it
+  bool
+  truncated() const
+  {
+    return truncated_tail;
+  }
+
+  size_t
+  size() const
+  {
+    return length;
+  }
+
+private:
+
+  const char*                             data               = nullptr;
+  size_t                                  length             = 0;
+  size_t                                  position           = 0;
+  bool                                    truncated_tail     = false;
+  std::shared_ptr<const map::Route>       route;
+  std::unordered_map<int64_t, map::Route> participant_routes; // by the recorded participant key
+  std::map<std::string, double>           parameters;
+  bool                                    parameters_changed = false;
+};
+
+// Calls a planner and records the call, e.g. recorder.plan_trajectory( planner, route, state, map, participants )
+// instead of planner.plan_trajectory( route, state, map, participants ). Only the planner call is timed.
+class PlanningRecorder
+{
+public:
+
+  explicit PlanningRecorder( const std::string& path ) :
+    log( path )
+  {}
+
+  template<typename Planner>
+  void
+  set_parameters( Planner& planner, const std::map<std::string, double>& parameters )
+  {
+    planner.set_parameters( parameters );
+    log.write_parameters( parameters );
+  }
+
+  template<typename Planner>
+  dynamics::Trajectory
+  plan_trajectory( Planner& planner, const map::Route& route, const dynamics::VehicleStateDynamic& state, const map::Map& map,
+                   const dynamics::TrafficParticipantSet& traffic_participants )
+  {
+    auto start      = std::chrono::steady_clock::now();
+    auto trajectory = planner.plan_trajectory( route, state, map, traffic_participants );
+    log.write_route_cycle( route, state, traffic_participants, trajectory, seconds_since( start ) );
+    return trajectory;
+  }
+
+  template<typename Planner>
+  dynamics::Trajectory
+  plan_trajectory( Planner& planner, const std::vector<math::Point2d>& left_border, const std::vector<math::Point2d>& right_border,
+                   const dynamics::VehicleStateDynamic& state )
+  {
+    auto start      = std::chrono::steady_clock::now();
+    auto trajectory = planner.plan_trajectory( left_border, right_border, state );
+    log.write_corridor_cycle( left_border, right_border, state, trajectory, seconds_since( start ) );
+    return trajectory;
+  }
+
+  template<typename Planner>
+  dynamics::Trajectory
+  plan_trajectory( Planner& planner, const dynamics::Trajectory& reference_trajectory, const dynamics::VehicleStateDynamic& state )
+  {
+    auto start      = std::chrono::steady_clock::now();
+    auto trajectory = planner.plan_trajectory( reference_trajectory, state );
+    log.write_reference_cycle( reference_trajectory, state, trajectory, seconds_since( start ) );
+    return trajectory;
+  }
+
+  template<typename Planner>
+  dynamics::Trajectory
+  plan_trajectory( Planner& planner, const dynamics::VehicleStateDynamic& state, const std::deque<map::MapPoint>& route_points,
+                   const map::Map& map, const dynamics::VehicleCommandLimits& limits )
+  {
+    auto start      = std::chrono::steady_clock::now();
+    auto trajectory = planner.plan_trajectory( state, route_points, map, limits );
+    log.write_lane_follow_cycle( state, route_points, limits, trajectory, seconds_since( start ) );
+    return trajectory;
+  }
+
+  // The participants are planned in place, their inputs are copied before the call
+  template<typename Planner>
+  void
+  plan_trajectories( Planner& planner, dynamics::TrafficParticipantSet& traffic_participants )
+  {
+    inputs     = traffic_participants;
+    auto start = std::chrono::steady_clock::now();
+    planner.plan_trajectories( traffic_participants );
+    log.write_multi_agent_cycle( inputs, traffic_participants, seconds_since( start ) );
+  }
+
+  PlanningLogWriter log;
+
+private:
+
+  static double
+  seconds_since( std::chrono::steady_clock::time_point start )
+  {
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  }
+
+  dynamics::TrafficParticipantSet inputs;
+};
+
+// Differences of a replayed trajectory to the recorded one, states are compared by index
+struct TrajectoryDifference
+{
+  size_t compared_states  = 0;
+  size_t missing_states   = 0; // states only one of the trajectories has
+  double max_position     = 0.0;
+  double max_speed        = 0.0;
+  double max_yaw          = 0.0;
+  double max_steering     = 0.0;
+  double max_acceleration = 0.0;
+
+  // Worst case of both differences
+  void merge( const TrajectoryDifference& other );
+};
+
+TrajectoryDifference compare_trajectories( const dynamics::Trajectory& replayed, const dynamics::Trajectory& recorded );
+
+// Trajectories of participants with the same id, participants missing in one of the sets count their recorded states
+TrajectoryDifference compare_participant_trajectories( const dynamics::TrafficParticipantSet& replayed,
+                                                       const dynamics::TrafficParticipantSet& recorded );
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,198 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "adore_map/map.hpp"
+#include "dynamics/traffic_participant.hpp"
+#include "dynamics/trajectory.hpp"
+#include "planning/lane_follow_planner.hpp"
+#include "planning/multi_agent_PID.hpp"
+#include "planning/optinlc_trajectory_optimizer.hpp"
+#include "planning/optinlc_trajectory_planner.hpp"
+#include "planning/planning_log.hpp"
+#include "planning/safety_corridor_planner.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Timing and output difference of one replayed cycle
+struct ReplayedCycle
+{
+  size_t               index         = 0; // position of the cycle in the log, counted from 0
+  PlanningCycleType    type          = PlanningCycleType::route;
+  double               recorded_time = 0.0;
+  double               replay_time   = 0.0;
+  bool                 failed        = false; // the planner threw, no difference is computed
+  TrajectoryDifference difference;
+};
+
+// Drives planners with the cycles of a planning log as fast as they run. Each cycle type has its own planner, created
+// on its first cycle, so a planner carries its state from cycle to cycle as in the recording. Recorded parameters are
+// passed to all planners. Route and lane follow cycles are planned on the map given here, their outputs only match the
+// recording on the map the log was recorded with. Only the planner call is timed, decoding the log is not.
+template<typename RoutePlanner = OptiNLCTrajectoryPlanner>
+class PlanningReplay
+{
+public:
+
+  explicit PlanningReplay( const map::Map& map ) :
+    map( map )
+  {}
+
+  // Replays the next cycle of the log, false at the end of the log
+  bool
+  step( PlanningLogReader& reader, ReplayedCycle& result )
+  {
+    if( !reader.next( cycle ) )
+      return false;
+    if( cycle.parameters_changed )
+      apply_parameters( *cycle.parameters );
+
+    result               = ReplayedCycle();
+    result.index         = cycles++;
+    result.type          = cycle.type;
+    result.recorded_time = cycle.recorded_time;
+
+    prepare_cycle();
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+      run_cycle();
+      result.replay_time = seconds_since( start );
+    }
+    catch( const std::exception& )
+    {
+      result.replay_time = seconds_since( start );
+      result.failed      = true;
+      return true;
+    }
+
+    if( cycle.type == PlanningCycleType::multi_agent )
+      result.difference = compare_participant_trajectories( participants, cycle.planned_participants );
+    else
+      result.difference = compare_trajectories( trajectory, cycle.trajectory );
+    return true;
+  }
+
+private:
+
+  template<typename Planner>
+  void
+  acquire( std::unique_ptr<Planner>& planner )
+  {
+    if( planner )
+      return;
+    planner = std::make_unique<Planner>();
+    planner->set_parameters( parameters );
+  }
+
+  template<typename Planner>
+  void
+  forward_parameters( std::unique_ptr<Planner>& planner )
+  {
+    if( planner )
+      planner->set_parameters( parameters );
+  }
+
+  void
+  apply_parameters( const std::map<std::string, double>& recorded_parameters )
+  {
+    parameters = recorded_parameters;
+    forward_parameters( route_planner );
+    forward_parameters( corridor_planner );
+    forward_parameters( optimizer );
+    forward_parameters( lane_follow_planner );
+    forward_parameters( multi_agent_planner );
+  }
+
+  // Untimed part of a cycle, planners are created and the in place inputs are set up
+  void
+  prepare_cycle()
+  {
+    switch( cycle.type )
+    {
+      case PlanningCycleType::route:
+        acquire( route_planner );
+        break;
+      case PlanningCycleType::corridor:
+        acquire( corridor_planner );
+        break;
+      case PlanningCycleType::reference:
+        acquire( optimizer );
+        break;
+      case PlanningCycleType::lane_follow:
+        acquire( lane_follow_planner );
+        break;
+      case PlanningCycleType::multi_agent:
+        acquire( multi_agent_planner );
+        std::swap( participants, cycle.traffic_participants ); // the cycle is decoded anew on the next step
+        break;
+    }
+  }
+
+  void
+  run_cycle()
+  {
+    switch( cycle.type )
+    {
+      case PlanningCycleType::route:
+        route_planner->plan_trajectory_into( trajectory, *cycle.route, cycle.state, map, cycle.traffic_participants );
+        break;
+      case PlanningCycleType::corridor:
+        corridor_planner->plan_trajectory_into( trajectory, cycle.left_border, cycle.right_border, cycle.state );
+        break;
+      case PlanningCycleType::reference:
+        optimizer->plan_trajectory_into( trajectory, cycle.reference_trajectory, cycle.state );
+        break;
+      case PlanningCycleType::lane_follow:
+        lane_follow_planner->plan_trajectory_into( trajectory, cycle.state, cycle.route_points, map, cycle.limits );
+        break;
+      case PlanningCycleType::multi_agent:
+        multi_agent_planner->plan_trajectories( participants );
+        break;
+    }
+  }
+
+  static double
+  seconds_since( std::chrono::steady_clock::time_point start )
+  {
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  }
+
+  const map::Map&               map;
+  std::map<std::string, double> parameters;
+  size_t                        cycles = 0;
+
+  std::unique_ptr<RoutePlanner>               route_planner;
+  std::unique_ptr<SafetyCorridorPlanner>      corridor_planner;
+  std::unique_ptr<OptiNLCTrajectoryOptimizer> optimizer;
+  std::unique_ptr<LaneFollowPlanner>          lane_follow_planner;
+  std::unique_ptr<MultiAgentPID>              multi_agent_planner;
+
+  PlanningCycle                   cycle;
+  dynamics::Trajectory            trajectory;
+  dynamics::TrafficParticipantSet participants;
+};
+
+} // namespace planner
+} // namespace adore
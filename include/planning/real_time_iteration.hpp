@@ -0,0 +1,91 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Sanath Himasekhar Konthala
+ ********************************************************************************/
+#pragma once
+
+#include <cmath>
+
+#include <algorithm>
+#include <string>
+
+#include "OptiNLC_Options.h"
+
+namespace adore
+{
+namespace planner
+{
+
+// Outcome of the last solver call of a planner. OptiNLC does not report the number of SQP iterations a solve used, so
+// only the budget is known, the iterations actually run are at most iteration_budget.
+struct SolveReport
+{
+  int    iteration_budget = 0;     // maximum number of SQP iterations the solver was allowed to run
+  double solve_time       = 0.0;   // wall time of the solve in seconds
+  double deadline         = 0.0;   // time limit given to the solver in seconds
+  bool   deadline_met     = false; // solve_time <= deadline
+  bool   warm_started     = false;
+};
+
+// Real time iteration: a small fixed number of SQP iterations per cycle on top of the warm start,
+// with the solver time limit taken as a share of the cycle budget of the caller
+struct RealTimeIteration
+{
+  bool   enabled           = false;
+  int    iterations        = 2;
+  double cycle_budget      = 0.1; // seconds between two planning calls
+  double deadline_fraction = 0.7; // share of the cycle budget available to the solver
+
+  double
+  deadline() const
+  {
+    return cycle_budget * deadline_fraction;
+  }
+
+  // Returns true if name is a real time iteration parameter
+  bool
+  set_parameter( const std::string& name, double value )
+  {
+    if( name == "rti" )
+      enabled = value != 0.0;
+    else if( name == "rti_iterations" )
+      iterations = std::max( static_cast<int>( value ), 1 );
+    else if( name == "cycle_budget" )
+      cycle_budget = value;
+    else if( name == "rti_deadline_fraction" )
+      deadline_fraction = value;
+    else
+      return false;
+    return true;
+  }
+
+  // Returns true if the solver deadline changed
+  bool
+  set_cycle_budget( double budget )
+  {
+    double previous_deadline = deadline();
+    cycle_budget             = budget;
+    return enabled && std::abs( deadline() - previous_deadline ) > 1e-4;
+  }
+
+  void
+  apply( OptiNLC_Options& options ) const
+  {
+    if( !enabled )
+      return;
+    options.maxNumberOfIteration = iterations;
+    options.OptiNLC_time_limit   = deadline();
+  }
+};
+
+} // namespace planner
+} // namespace adore
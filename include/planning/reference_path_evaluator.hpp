@@ -0,0 +1,101 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Sanath Himasekhar Konthala
+ ********************************************************************************/
+#pragma once
+
+#include "adore_math/PiecewisePolynomial.h"
+
+namespace adore
+{
+namespace planner
+{
+
+struct ReferencePoint
+{
+  double x       = 0.0;
+  double y       = 0.0;
+  double heading = 0.0;
+};
+
+// Evaluates the x, y and heading splines of a reference path at one progress value.
+// The segment of the last query is kept as a cursor, successive queries during a solve are close to each other
+// and are resolved without the binary search of PiecewisePolynomial::findIndex.
+class ReferencePathEvaluator
+{
+public:
+
+  // The splines are referenced, not copied, and have to outlive the evaluator or the next call to set_path
+  void
+  set_path( const adore::math::PiecewisePolynomial::PiecewiseStruct& path_x, const adore::math::PiecewisePolynomial::PiecewiseStruct& path_y,
+            const adore::math::PiecewisePolynomial::PiecewiseStruct& path_heading )
+  {
+    x       = &path_x;
+    y       = &path_y;
+    heading = &path_heading;
+    cursor  = 0;
+  }
+
+  bool
+  empty() const
+  {
+    return x == nullptr || x->breaks.size() < 2;
+  }
+
+  int
+  find_segment( double s )
+  {
+    const auto& breaks       = x->breaks;
+    const int   last_segment = static_cast<int>( breaks.size() ) - 2;
+
+    // Walk from the cursor to a neighbouring segment, this covers integration steps and perturbations
+    for( int step = 0; step <= max_cursor_steps; step++ )
+    {
+      if( cursor < 0 || cursor > last_segment )
+        break;
+      if( s < breaks[cursor] )
+        cursor--;
+      else if( s >= breaks[cursor + 1] )
+        cursor++;
+      else
+        return cursor;
+    }
+
+    // Outside of the path or far away from the last query
+    cursor = pp.findIndex( s, *x );
+    return cursor;
+  }
+
+  ReferencePoint
+  evaluate( double s )
+  {
+    int            index = find_segment( s );
+    ReferencePoint point;
+    point.x       = pp.splineEvaluation( index, s, *x );
+    point.y       = pp.splineEvaluation( index, s, *y );
+    point.heading = pp.splineEvaluation( index, s, *heading );
+    return point;
+  }
+
+private:
+
+  static constexpr int max_cursor_steps = 2;
+
+  adore::math::PiecewisePolynomial                         pp;
+  const adore::math::PiecewisePolynomial::PiecewiseStruct* x       = nullptr;
+  const adore::math::PiecewisePolynomial::PiecewiseStruct* y       = nullptr;
+  const adore::math::PiecewisePolynomial::PiecewiseStruct* heading = nullptr;
+  int                                                      cursor  = 0;
+};
+
+} // namespace planner
+} // namespace adore
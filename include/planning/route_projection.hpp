@@ -0,0 +1,220 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cmath>
+
+#include <array>
+#include <iterator>
+
+#include "adore_map/route.hpp"
+#include "adore_math/point.h"
+
+namespace adore
+{
+namespace planner
+{
+
+// Result of projecting a point onto the center lane of a route
+struct RouteProjection
+{
+  double       s = 0.0;
+  math::Pose2d pose;
+  double       offset = 0.0; // signed lateral offset, -dx * sin( yaw ) + dy * cos( yaw ) relative to pose
+};
+
+// Size and a few center lane points, evenly spaced in s from the front to the back, of a route together with the
+// lanes they belong to. Routes are rebuilt rather than edited, a rebuilt route with the same size and end points still
+// differs in the sampled points or their parent lanes.
+struct RouteFingerprint
+{
+  static constexpr int samples = 8;
+
+  struct Sample
+  {
+    double s         = 0.0;
+    double x         = 0.0;
+    double y         = 0.0;
+    size_t parent_id = 0;
+  };
+
+  size_t                      size = 0;
+  std::array<Sample, samples> points;
+
+  bool
+  operator==( const RouteFingerprint& other ) const
+  {
+    if( size != other.size )
+      return false;
+    for( int i = 0; i < samples; ++i )
+      if( points[i].s != other.points[i].s || points[i].x != other.points[i].x || points[i].y != other.points[i].y
+          || points[i].parent_id != other.points[i].parent_id )
+        return false;
+    return true;
+  }
+
+  bool
+  operator!=( const RouteFingerprint& other ) const
+  {
+    return !( *this == other );
+  }
+};
+
+inline RouteFingerprint
+route_fingerprint( const map::Route& route )
+{
+  RouteFingerprint fingerprint;
+  fingerprint.size = route.center_lane.size();
+  if( route.center_lane.empty() )
+    return fingerprint;
+
+  double front_s = route.center_lane.begin()->first;
+  double step    = ( route.center_lane.rbegin()->first - front_s ) / ( RouteFingerprint::samples - 1 );
+  for( int i = 0; i < RouteFingerprint::samples; ++i )
+  {
+    auto it = route.center_lane.lower_bound( front_s + i * step );
+    if( it == route.center_lane.end() )
+      it = std::prev( it );
+    fingerprint.points[i] = { it->first, it->second.x, it->second.y, it->second.parent_id };
+  }
+  return fingerprint;
+}
+
+// Progress of the last projection of one agent onto one route. The route is identified by its address, size and end
+// points, a route rebuilt at the same address with other geometry does not match.
+struct RouteProjectionHint
+{
+  const map::Route* route      = nullptr;
+  size_t            route_size = 0;
+  double            front_s    = 0.0;
+  double            back_s     = 0.0;
+  math::Point2d     front;
+  math::Point2d     back;
+  double            s     = 0.0;
+  bool              valid = false;
+
+  bool
+  matches( const map::Route& other ) const
+  {
+    if( !valid || route != &other || route_size != other.center_lane.size() )
+      return false;
+    const auto& [other_front_s, other_front] = *other.center_lane.begin();
+    const auto& [other_back_s, other_back]   = *other.center_lane.rbegin();
+    return front_s == other_front_s && back_s == other_back_s && front.x == other_front.x && front.y == other_front.y
+        && back.x == other_back.x && back.y == other_back.y;
+  }
+
+  void
+  update( const map::Route& other, double progress )
+  {
+    const auto& [other_front_s, other_front] = *other.center_lane.begin();
+    const auto& [other_back_s, other_back]   = *other.center_lane.rbegin();
+    route      = &other;
+    route_size = other.center_lane.size();
+    front_s    = other_front_s;
+    back_s     = other_back_s;
+    front      = math::Point2d( other_front.x, other_front.y );
+    back       = math::Point2d( other_back.x, other_back.y );
+    s          = progress;
+    valid      = true;
+  }
+
+  void
+  reset()
+  {
+    valid = false;
+  }
+};
+
+// Nearest center lane point within window of the hinted progress, in the same sense as Route::get_s.
+// Falls back to Route::get_s if there is no usable hint or the nearest point lies on the border of the window.
+template<typename Point>
+inline RouteProjection
+project_onto_route( const map::Route& route, const Point& point, RouteProjectionHint& hint, double window = 10.0 )
+{
+  RouteProjection projection;
+  if( route.center_lane.empty() )
+    return projection;
+
+  bool found = false;
+  if( hint.matches( route ) )
+  {
+    const auto& center_lane = route.center_lane;
+
+    auto squared_distance = [&]( const auto& route_point ) {
+      double dx = route_point.second.x - point.x;
+      double dy = route_point.second.y - point.y;
+      return dx * dx + dy * dy;
+    };
+
+    auto start = center_lane.lower_bound( hint.s );
+    if( start == center_lane.end() )
+      start = std::prev( start );
+
+    auto   best          = start;
+    double best_distance = squared_distance( *start );
+    bool   on_border     = false;
+
+    auto forward = std::next( start );
+    for( ; forward != center_lane.end() && forward->first - hint.s <= window; ++forward )
+    {
+      double distance = squared_distance( *forward );
+      if( distance < best_distance )
+      {
+        best_distance = distance;
+        best          = forward;
+      }
+    }
+    if( forward != center_lane.end() && best == std::prev( forward ) )
+      on_border = true;
+
+    if( start != center_lane.begin() )
+    {
+      auto backward = std::prev( start );
+      for( ; hint.s - backward->first <= window; --backward )
+      {
+        double distance = squared_distance( *backward );
+        if( distance < best_distance )
+        {
+          best_distance = distance;
+          best          = backward;
+        }
+        if( backward == center_lane.begin() )
+          break;
+      }
+      if( hint.s - backward->first > window && best == std::next( backward ) )
+        on_border = true;
+    }
+
+    if( !on_border )
+    {
+      projection.s = best->first;
+      found        = true;
+    }
+  }
+
+  if( !found )
+    projection.s = route.get_s( point );
+
+  projection.pose   = route.get_pose_at_s( projection.s );
+  projection.offset = -( point.x - projection.pose.x ) * std::sin( projection.pose.yaw )
+                    + ( point.y - projection.pose.y ) * std::cos( projection.pose.yaw );
+
+  hint.update( route, projection.s );
+  return projection;
+}
+
+} // namespace planner
+} // namespace adore
@@ -16,8 +16,12 @@
 #include <cmath>
 
 #include <chrono>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "adore_map/route.hpp"
@@ -31,6 +35,13 @@
 #include "OptiNLC_Options.h"
 #include "OptiNLC_Solver.h"
 #include "dynamics/trajectory.hpp"
+#include "planning/agent_grid.hpp"
+#include "planning/ocp_solver.hpp"
+#include "planning/planner_precision.hpp"
+#include "planning/planner_stats.hpp"
+#include "planning/reference_path_evaluator.hpp"
+#include "planning/thread_pool.hpp"
+#include "planning/trace_buffer.hpp"
 
 namespace adore
 {
@@ -44,10 +55,53 @@ enum safety_corridor_drive_direction
   automatic
 };
 
-class SafetyCorridorPlanner
+// Side of the border segment the vehicle is on
+enum class border_side
+{
+  left,
+  right,
+  on_the_line
+};
+
+// Closest intersection of the perpendicular through the vehicle with a border
+struct BorderQuery
+{
+  bool                 found    = false;
+  double               distance = std::numeric_limits<double>::max();
+  adore::math::Point2d intersection;
+  int                  closest_index = -1; // index of the border point after the intersection
+  border_side          side          = border_side::on_the_line;
+};
+
+// Segment of the last query on one border, successive queries search around it first
+struct BorderHint
+{
+  size_t fingerprint   = 0; // border_fingerprint of the border of the last query
+  int    closest_index = -1;
+  double distance      = 0.0;
+
+  // Segment midpoints of the border, bound the segments that can hold a nearer intersection than the windowed one
+  AgentGrid segments;
+  bool      segments_valid = false;
+  size_t    segments_of    = 0;   // fingerprint of the border the grid was built for
+  double    segment_reach  = 0.0; // half length of the longest segment
+};
+
+// Fingerprints of the borders of one planning call, each border is hashed once per call
+struct BorderFingerprints
+{
+  size_t left  = 0;
+  size_t right = 0;
+};
+
+template<int ControlPoints, int HorizonMs, typename Precision = DoublePrecision>
+class SafetyCorridorPlannerT
 {
 public:
 
+  using Scalar     = typename Precision::Scalar;
+  using Evaluation = typename Precision::Evaluation;
+
   enum STATES
   {
     X,
@@ -67,8 +121,8 @@ public:
 
   static constexpr int    state_size       = 8;
   static constexpr int    input_size       = 1;
-  static constexpr int    control_points   = 30;
-  static constexpr double sim_time         = 3.0; // Simulation time for the MPC
+  static constexpr int    control_points   = ControlPoints;
+  static constexpr double sim_time         = HorizonMs / 1000.0; // Simulation time for the MPC
   static constexpr int    constraints_size = 0;
 
 
@@ -91,52 +145,116 @@ private:
   safety_corridor_drive_direction drive_direction = safety_corridor_drive_direction::automatic;
 
   adore::math::Point2d              closest_intersection;
-  int                               closest_index = -1;
-  std::string                       relative_position;
-  std::vector<adore::math::Point2d> border_to_plan;
+  int                               closest_index     = -1;
+  border_side                       relative_position = border_side::on_the_line;
+  BorderHint                        left_border_hint;
+  BorderHint                        right_border_hint;
+  int                               border_search_window    = 10;   // segments searched on each side of the hinted segment
+  double                            border_grid_cell_size   = 10.0; // m, cells of the segment grid of a border
+  std::vector<int>                  border_segment_candidates;
   double                            lateral_distance_from_border = 1.5;
 
   double               bad_counter   = 0;
   bool                 bad_condition = false;
-  dynamics::Trajectory previous_trajectory;
+  dynamics::Trajectory previous_trajectory;  // last accepted solution
+  dynamics::Trajectory candidate_trajectory; // solution of the current call, swapped into previous_trajectory on acceptance
   double               bad_output = 40.0;
 
+  // Statistics of the last call
+  PlannerStats last_stats;
+
   // Variables to convert route to piecewise polynomial function
   adore::math::PiecewisePolynomial                  pp;
   adore::math::PiecewisePolynomial::PiecewiseStruct safety_corridor_x;
   adore::math::PiecewisePolynomial::PiecewiseStruct safety_corridor_y;
   adore::math::PiecewisePolynomial::PiecewiseStruct safety_corridor_heading;
+  ReferencePathEvaluator                            reference_path;
+
+  // Corridor fitted over the whole border, reused while the border is unchanged and re-anchored at the intersection
+  struct CorridorCache
+  {
+    bool                valid       = false;
+    size_t              fingerprint = 0;
+    std::vector<double> progress; // arc length of every border point
+  } corridor_cache;
+
+  bool   use_corridor_cache = false;
+  double border_s_offset    = 0.0; // progress of the intersection along the fitted corridor
+
+  static size_t border_fingerprint( const std::vector<adore::math::Point2d>& border );
+  void          fit_corridor( const std::vector<double>& progress, const std::vector<double>& border_x,
+                              const std::vector<double>& border_y );
 
   // Helper function to calculate position of car compared to border
   bool        find_intersection( const adore::math::Point2d& p1, const adore::math::Point2d& p2, const adore::math::Point2d& carPos,
                                  double heading, adore::math::Point2d& intersection );
-  std::string get_relative_position( const adore::math::Point2d& p1, const adore::math::Point2d& p2, const adore::math::Point2d& carPos );
+  border_side get_relative_position( const adore::math::Point2d& p1, const adore::math::Point2d& p2, const adore::math::Point2d& carPos );
 
-  double get_border_parameters( const std::vector<adore::math::Point2d>& border, const dynamics::VehicleStateDynamic& current_state );
+  // Searches the segments [first, last) of the border
+  void        search_border_segments( const std::vector<adore::math::Point2d>& border, const dynamics::VehicleStateDynamic& current_state,
+                                      size_t first, size_t last, BorderQuery& query );
+  void        update_segment_grid( const std::vector<adore::math::Point2d>& border, size_t fingerprint, BorderHint& hint );
+  BorderQuery get_border_parameters( const std::vector<adore::math::Point2d>& border, size_t fingerprint,
+                                     const dynamics::VehicleStateDynamic& current_state, BorderHint& hint );
+  void        apply_border_query( const BorderQuery& query );
 
-  void drive_left( const std::vector<adore::math::Point2d>& border, const double& lateral_distance );
-  void drive_right( const std::vector<adore::math::Point2d>& border, const double& lateral_distance );
+  void drive_left( const double& lateral_distance );
+  void drive_right( const double& lateral_distance );
 
-  // Variables for MPC solver configuration
-  OptiNLC_Options options;
+  // Speculative solves in automatic mode: one planner per side and initial guess solves in parallel,
+  // the feasible solution with the lowest final objective wins
+  bool                                                 use_speculative_solves      = false;
+  int                                                  speculative_initial_guesses = 1; // 2 adds a cold started solve per side
+  std::map<std::string, double>                        parameters; // accumulated parameters, passed on to the speculative planners
+  std::vector<std::unique_ptr<SafetyCorridorPlannerT>> speculative_planners;
+  std::vector<const dynamics::Trajectory*>             speculative_results; // owned by the speculative planners
+  std::unique_ptr<ThreadPool>                          speculative_pool;
+  safety_corridor_drive_direction                      speculative_winner = safety_corridor_drive_direction::automatic;
+  int                                                  speculative_best   = -1; // planner holding the last returned solution
+
+  // Body of plan_trajectory_ref, the speculative planners are called with the fingerprints of their caller
+  const dynamics::Trajectory& plan_on_borders( const std::vector<adore::math::Point2d>& left_border,
+                                               const std::vector<adore::math::Point2d>& right_border,
+                                               const dynamics::VehicleStateDynamic& current_state, const BorderFingerprints& fingerprints );
+
+  const dynamics::Trajectory& plan_speculative( const std::vector<adore::math::Point2d>& left_border,
+                                                const std::vector<adore::math::Point2d>& right_border,
+                                                const dynamics::VehicleStateDynamic&     current_state );
+
+  // Drops the speculative planners, the solution of the last winner is kept in previous_trajectory
+  void reset_speculative_planners();
+
+  // Last returned solution, the fallback of a cycle without an accepted solution
+  const dynamics::Trajectory& kept_trajectory() const;
+
+  // OCP, solver and warm start of the planned side, see ocp_solver.hpp
+  OCPSolver<Scalar, input_size, state_size, constraints_size, control_points> ocp_solver;
+
+  // Origin of the OCP frame, the current position and time for Precision::local_frame and zero otherwise
+  double origin_x    = 0.0;
+  double origin_y    = 0.0;
+  double origin_time = 0.0;
 
   // Helper function to define the dynamic model
-  void setup_dynamic_model( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp );
+  void setup_dynamic_model( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp );
 
   // Helper function to define the objective function
-  void setup_objective_function( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp );
+  void setup_objective_function( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp );
 
   // Helper function to set constraints
-  void setup_constraints( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp );
+  void setup_constraints( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp );
 
   // Helper function to set up the solver and solve the problem
-  bool solve_mpc( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp,
-                  VECTOR<double, state_size>& initial_state, VECTOR<double, input_size>& initial_input, std::vector<double>& delta_output,
+  bool solve_mpc( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp,
+                  VECTOR<Scalar, state_size>& initial_state, VECTOR<Scalar, input_size>& initial_input, std::vector<double>& delta_output,
                   std::vector<double>& acc_output, double current_time );
 
 public:
 
-  SafetyCorridorPlanner();
+  SafetyCorridorPlannerT();
+  SafetyCorridorPlannerT( const SafetyCorridorPlannerT& )            = delete;
+  SafetyCorridorPlannerT& operator=( const SafetyCorridorPlannerT& ) = delete;
+
   dynamics::VehicleCommandLimits limits;
 
   // Public method to get the next vehicle command based on SafetyCorridorPlanner
@@ -144,7 +262,59 @@ public:
                                         const std::vector<adore::math::Point2d>& right_border,
                                         const dynamics::VehicleStateDynamic&     current_state );
 
+  // Same as plan_trajectory but fills trajectory in place, its storage is reused between calls
+  void plan_trajectory_into( dynamics::Trajectory& trajectory, const std::vector<adore::math::Point2d>& left_border,
+                             const std::vector<adore::math::Point2d>& right_border, const dynamics::VehicleStateDynamic& current_state );
+
+  // Same as plan_trajectory without copying, the trajectory is owned by the planner and valid until the next call
+  const dynamics::Trajectory& plan_trajectory_ref( const std::vector<adore::math::Point2d>& left_border,
+                                                   const std::vector<adore::math::Point2d>& right_border,
+                                                   const dynamics::VehicleStateDynamic&     current_state );
+
   void set_parameters( const std::map<std::string, double>& params );
+
+  // True if the last solve was seeded from the shifted previous solution
+  bool
+  is_warm_started() const
+  {
+    return ocp_solver.warm_started;
+  }
+
+  // Seconds available per planning call, sets the solver deadline in real time iteration mode
+  void set_cycle_budget( double cycle_budget );
+
+  // Iteration budget, solve time and deadline of the last call
+  const SolveReport&
+  get_solve_report() const
+  {
+    return last_stats.solve;
+  }
+
+  // Stage timings, solver statistics and fallback flag of the last call
+  const PlannerStats&
+  get_stats() const
+  {
+    return last_stats;
+  }
+
+  // Side of the speculative solve that won the last call, automatic if none was feasible
+  safety_corridor_drive_direction
+  get_speculative_winner() const
+  {
+    return speculative_winner;
+  }
+
+  // Trace records of the planning calls, drained by the caller or a TraceConsumer, "verbose" echoes them to stderr
+  TraceBuffer trace;
 };
+
+// Horizon variants instantiated in the translation unit, the default keeps the original 30 points over 3 s
+using SafetyCorridorPlanner          = SafetyCorridorPlannerT<30, 3000>;
+using LowSpeedSafetyCorridorPlanner  = SafetyCorridorPlannerT<20, 2000>;
+using HighSpeedSafetyCorridorPlanner = SafetyCorridorPlannerT<40, 4000>;
+
+// Float solver variants of the default horizon
+using FloatSolverSafetyCorridorPlanner     = SafetyCorridorPlannerT<30, 3000, FloatSolverPrecision>;
+using SinglePrecisionSafetyCorridorPlanner = SafetyCorridorPlannerT<30, 3000, SinglePrecision>;
 } // namespace planner
 } // namespace adore
@@ -0,0 +1,88 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Sanath Himasekhar Konthala
+ ********************************************************************************/
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "planning/lane_attribute_cache.hpp"
+#include "planning/optinlc_trajectory_planner.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Picks one of the horizon variants of OptiNLCTrajectoryPlannerT by the current speed:
+// 20 points over 2 s at low speed, 30 over 3 s by default and 40 over 4 s at high speed
+class SpeedBandTrajectoryPlanner
+{
+public:
+
+  enum class SpeedBand
+  {
+    low,
+    medium,
+    high
+  };
+
+  // The variants plan on the same thread and share one lane attribute cache
+  SpeedBandTrajectoryPlanner();
+
+  // Forwarded to all variants, the band thresholds are read here
+  void set_parameters( const std::map<std::string, double>& params );
+
+  dynamics::Trajectory plan_trajectory( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                                        const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants );
+
+  void plan_trajectory_into( dynamics::Trajectory& trajectory, const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                             const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants );
+
+  void set_cycle_budget( double cycle_budget );
+
+  void set_lane_attribute_cache( const std::shared_ptr<LaneAttributeCache>& cache );
+
+  void set_participant_filter( const std::vector<int>* ids, std::optional<int> ignored_id = std::nullopt );
+
+  SpeedBand
+  get_speed_band() const
+  {
+    return speed_band;
+  }
+
+  const SolveReport& get_solve_report() const;
+
+  // Statistics of the variant that planned last
+  const PlannerStats& get_stats() const;
+
+private:
+
+  LowSpeedOptiNLCTrajectoryPlanner  low_speed_planner;
+  OptiNLCTrajectoryPlanner          medium_speed_planner;
+  HighSpeedOptiNLCTrajectoryPlanner high_speed_planner;
+
+  double low_speed_threshold   = 3.0;  // m/s, below the short horizon is used
+  double high_speed_threshold  = 15.0; // m/s, above the long horizon is used
+  double speed_band_hysteresis = 1.0;  // m/s, the speed has to pass a threshold by this much to switch back
+
+  SpeedBand speed_band = SpeedBand::medium;
+
+  void update_speed_band( double speed );
+};
+
+} // namespace planner
+} // namespace adore
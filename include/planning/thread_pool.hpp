@@ -0,0 +1,68 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace adore
+{
+namespace planner
+{
+
+// Fixed set of worker threads for fork-join loops that run many times per planning call.
+// The calling thread takes part in every loop, a pool of size 1 runs everything on the caller.
+class ThreadPool
+{
+public:
+
+  explicit ThreadPool( size_t number_of_threads );
+  ~ThreadPool();
+
+  ThreadPool( const ThreadPool& )            = delete;
+  ThreadPool& operator=( const ThreadPool& ) = delete;
+
+  // Number of threads taking part in a loop, including the caller
+  size_t size() const;
+
+  // Calls task( i ) for every i in [0, count) and returns when all calls have finished.
+  // Must not be called concurrently or from inside a task.
+  void parallel_for( size_t count, const std::function<void( size_t )>& task );
+
+private:
+
+  void worker_loop();
+  void run_tasks();
+
+  std::vector<std::thread> workers;
+
+  std::mutex              mutex;
+  std::condition_variable work_available;
+  std::condition_variable work_done;
+
+  const std::function<void( size_t )>* current_task     = nullptr;
+  size_t                               task_count       = 0;
+  size_t                               generation       = 0;
+  size_t                               finished_workers = 0;
+  bool                                 stop             = false;
+  std::atomic<size_t>                  next_index{ 0 };
+};
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,166 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace adore
+{
+namespace planner
+{
+
+enum class TraceEvent : uint16_t
+{
+  reference_velocity,
+  distance_to_object,
+  distance_to_goal,
+  distance_moved,
+  invalid_route,
+  no_border_intersection,
+  warm_start_unavailable,
+  empty_route_points,
+  insufficient_points_after_filtering,
+  insufficient_points_after_spline,
+  invalid_distances,
+  non_finite_curvature,
+  invalid_speeds,
+  non_finite_speed,
+  invalid_times,
+  empty_trajectory
+};
+
+// Fixed size binary trace record, value and detail depend on the event
+struct TraceRecord
+{
+  int64_t    timestamp_ns = 0; // steady clock
+  TraceEvent event        = TraceEvent::reference_velocity;
+  double     value        = 0.0;
+  double     detail       = 0.0;
+};
+
+const char* trace_event_name( TraceEvent event );
+
+// One line in the format of the former std::cerr output
+void write_trace_record( std::ostream& stream, const TraceRecord& record );
+
+// Single producer, single consumer ring buffer of trace records. The planner pushes without locks or allocation,
+// records are dropped and counted if the consumer falls behind. Copies start empty, so a copied planner does not
+// become a second producer of the same buffer.
+class TraceBuffer
+{
+public:
+
+  explicit TraceBuffer( size_t capacity = 1024 );
+
+  TraceBuffer( const TraceBuffer& other );
+  TraceBuffer& operator=( const TraceBuffer& other );
+
+  // Producer side
+  bool
+  push( TraceEvent event, double value = 0.0, double detail = 0.0 )
+  {
+    TraceRecord record;
+    record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    record.event        = event;
+    record.value        = value;
+    record.detail       = detail;
+    if( echo )
+      write_to_stderr( record );
+
+    size_t current_head = head.load( std::memory_order_relaxed );
+    if( current_head - tail.load( std::memory_order_acquire ) >= records.size() )
+    {
+      dropped.fetch_add( 1, std::memory_order_relaxed );
+      return false;
+    }
+    records[current_head & mask] = record;
+    head.store( current_head + 1, std::memory_order_release );
+    return true;
+  }
+
+  // Synchronous stderr output of every record, off by default
+  void
+  set_echo( bool enabled )
+  {
+    echo = enabled;
+  }
+
+  // Consumer side, calls sink for every pending record and returns their number.
+  // A buffer is drained either by one TraceConsumer or directly by the caller, not by both.
+  size_t drain( const std::function<void( const TraceRecord& )>& sink );
+
+  // Consumer side, writes all pending records to stream
+  size_t dump( std::ostream& stream );
+
+  size_t
+  dropped_records() const
+  {
+    return dropped.load( std::memory_order_relaxed );
+  }
+
+private:
+
+  void write_to_stderr( const TraceRecord& record ) const;
+
+  std::vector<TraceRecord> records;
+  size_t                   mask = 0;
+  bool                     echo = false;
+
+  alignas( 64 ) std::atomic<size_t> head{ 0 };
+  alignas( 64 ) std::atomic<size_t> tail{ 0 };
+  std::atomic<size_t> dropped{ 0 };
+};
+
+// Background thread draining a set of trace buffers into one sink, off the planning thread
+class TraceConsumer
+{
+public:
+
+  TraceConsumer( std::function<void( const TraceRecord& )> sink, std::chrono::milliseconds period = std::chrono::milliseconds( 100 ) );
+  ~TraceConsumer();
+
+  TraceConsumer( const TraceConsumer& )            = delete;
+  TraceConsumer& operator=( const TraceConsumer& ) = delete;
+
+  // The buffer has to outlive the consumer or be removed before it is destroyed
+  void add( TraceBuffer& buffer );
+  void remove( TraceBuffer& buffer );
+
+  // Drains all buffers on the calling thread
+  void flush();
+
+private:
+
+  void consumer_loop();
+
+  std::function<void( const TraceRecord& )> sink;
+  std::chrono::milliseconds                 period;
+
+  std::mutex                mutex;
+  std::condition_variable   wake_up;
+  std::vector<TraceBuffer*> buffers;
+  bool                      stop = false;
+  std::thread               worker;
+};
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,85 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace adore
+{
+namespace planner
+{
+
+// Lock-free single slot between one writer and one reader, the reader always sees the newest published value.
+// The writer fills back() and publishes it, the reader picks it up with update() and reads front(). The third slot
+// sits in the middle, so neither side ever waits for the other and no value is torn.
+template<typename T>
+class TripleBuffer
+{
+public:
+
+  // Writer side
+  T&
+  back()
+  {
+    return slots[back_index];
+  }
+
+  void
+  publish()
+  {
+    back_index = middle.exchange( back_index | fresh, std::memory_order_acq_rel ) & index_mask;
+  }
+
+  // Reader side, returns true if a newer value than the current front was published
+  bool
+  update()
+  {
+    if( !( middle.load( std::memory_order_relaxed ) & fresh ) )
+      return false;
+    front_index = middle.exchange( front_index, std::memory_order_acq_rel ) & index_mask;
+    return true;
+  }
+
+  bool
+  has_update() const
+  {
+    return middle.load( std::memory_order_acquire ) & fresh;
+  }
+
+  const T&
+  front() const
+  {
+    return slots[front_index];
+  }
+
+  T&
+  front()
+  {
+    return slots[front_index];
+  }
+
+private:
+
+  static constexpr unsigned fresh      = 4;
+  static constexpr unsigned index_mask = 3;
+
+  std::array<T, 3>      slots;
+  unsigned              back_index  = 0;
+  unsigned              front_index = 2;
+  std::atomic<unsigned> middle{ 1 };
+};
+
+} // namespace planner
+} // namespace adore
@@ -1,134 +1,205 @@
-// /********************************************************************************
-//  * Copyright (C) 2017-2025 German Aerospace Center (DLR).
-//  * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
-//  *
-//  * This program and the accompanying materials are made available under the
-//  * terms of the Eclipse Public License 2.0 which is available at
-//  * http://www.eclipse.org/legal/epl-2.0.
-//  *
-//  * SPDX-License-Identifier: EPL-2.0
-//  *
-//  * Contributors:
-//  *    Giovanni Lucente
-//  *    Marko Mizdrak
-//  ********************************************************************************/
-// #pragma once
-// #include <iostream>
-// #include <optional>
-
-// #include "adore_map/map.hpp"
-
-// #include "dynamics/integration.hpp"
-// #include "dynamics/trajectory.hpp"
-
-// namespace adore
-// {
-// namespace planner
-// {
-
-// class Agent
-// {
-// public:
-
-// dynamics::Trajectory                  trajectory;     // The agent's trajectory
-// std::vector<dynamics::VehicleCommand> controls;       // Control inputs at each time step
-// dynamics::VehicleCommandLimits        command_limits; // Limits for the control inputs
-// double                                cost;           // Total cost for the agent
-// size_t                                id = 0;
-
-// // Constructor
-// Agent( dynamics::Trajectory& initial_trajectory, const dynamics::VehicleCommandLimits& limits ) :
-//   trajectory( initial_trajectory ),
-//   command_limits( limits ),
-//   cost( 0.0 )
-// {
-//   initialize_controls_from_trajectory();
-// }
-
-// // Initialize controls from the trajectory
-// void
-// initialize_controls_from_trajectory()
-// {
-//   size_t num_states = trajectory.states.size();
-//   controls.resize( num_states ); // One control per state
-
-// for( size_t i = 0; i < num_states; ++i )
-// {
-//   controls[i].steering_angle = trajectory.states[i].steering_angle;
-//   controls[i].acceleration   = trajectory.states[i].ax; // Assuming ax is longitudinal acceleration
-// }
-// }
-
-// // Update trajectory based on current controls
-// void
-// update_trajectory_from_controls( double dt, double wheelbase )
-// {
-//   size_t num_states = trajectory.states.size();
-
-// for( size_t i = 1; i < num_states; ++i )
-// {
-//   dynamics::VehicleStateDynamic& prev_state = trajectory.states[i - 1];
-//   dynamics::VehicleStateDynamic& curr_state = trajectory.states[i];
-
-// dynamics::VehicleCommand& command = controls[i];
-
-// // Clamp the command within limits
-// command.clamp_within_limits( command_limits );
-
-// // Integrate vehicle dynamics using euler_step
-// curr_state = dynamics::euler_step( prev_state, command, dt, wheelbase );
-// }
-// }
-// };
-
-// class TrustRegionSolver
-// {
-// public:
-
-// TrustRegionSolver( std::vector<Agent>& agents, double dt, double wheelbase ) :
-//   agents( agents ),
-//   num_agents( agents.size() ),
-//   dt( dt ),
-//   wheelbase( wheelbase ),
-//   convergence_tolerance( 1e-6 ),
-//   max_iterations( 100 ),
-//   delta_initial( 1.0 ),
-//   eta( 0.1 ),
-//   gamma( 1.05 ),
-//   rho( 1e-3 )
-// {
-//   initialize();
-// }
-
-// void solve();
-
-// private:
-
-// std::vector<Agent>& agents;
-// size_t              num_agents;
-// double              dt;
-// double              wheelbase;
-
-// double convergence_tolerance;
-// int    max_iterations;
-// double delta_initial;
-// double eta;
-// double gamma;
-// double rho;
-
-// std::vector<Eigen::MatrixXd> hessians;      // Hessian approximations for each agent
-// std::vector<Eigen::VectorXd> gradients;     // Gradients for each agent
-// std::vector<Eigen::VectorXd> old_gradients; // Gradients for each agent
-// std::vector<double>          trust_deltas;  // Trust region deltas for each agent
-
-// std::optional<map::Map> local_map = std::nullopt;
-
-// void            initialize();
-// bool            convergence( const Eigen::VectorXd& gradient );
-// void            compute_cost_and_gradient( Agent& agent, size_t agent_index );
-// void            update_trust_region( Agent& agent, size_t agent_index, const Eigen::VectorXd& step, double cost_reduction_ratio );
-// Eigen::VectorXd solve_quadratic_subproblem( const Eigen::MatrixXd& hessian, const Eigen::VectorXd& gradient, double delta );
-// void            update_hessian( Agent& agent, size_t agent_index, const Eigen::VectorXd& s, const Eigen::VectorXd& y );
-// };
-// } // namespace planner
-// } // namespace adore
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "dynamics/traffic_participant.hpp"
+#include "dynamics/trajectory.hpp"
+#include "dynamics/vehicle_state.hpp"
+#include "planning/thread_pool.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+// Outcome of the last solve
+struct TrustRegionReport
+{
+  int    iterations       = 0;
+  bool   converged        = false;
+  double total_cost       = 0.0;
+  size_t optimized_agents = 0;
+  size_t skipped_agents   = 0; // predictions sampled at another step time, kept unchanged as static obstacles
+  size_t collision_pairs  = 0; // candidate pairs of the broad phase in the last iteration
+  size_t accepted_steps   = 0;
+};
+
+// Cooperative refinement of the predicted trajectories of a set of agents, e.g. the output of MultiAgentPID.
+// Every agent minimizes its control effort, the deviation from its predicted path and a smooth penalty for coming
+// closer than safe_distance to another agent. The controls ( steering angle, acceleration ) of each step drive an
+// explicit Euler kinematic bicycle model, gradients are computed with one adjoint pass per agent.
+//
+// Each iteration takes one trust region step per agent, solved with the dogleg method. The Hessian of an agent is dense,
+// the controls of one step move all later states through the dynamics, but it is approximated by one 2x2 BFGS block
+// per step that only sees the coupling of the steering and acceleration of that step. This is a crude approximation
+// that keeps a step linear in the horizon, the trust region makes up for the missing coupling with shorter steps.
+// All agents step against the positions of the other agents from the previous iteration (Jacobi update), so the
+// agents are updated in parallel and the result does not depend on the number of threads. Candidate collision pairs
+// are rebuilt once per iteration by a sort and sweep over the bounding boxes of short time windows of the trajectories.
+// Predictions are integrated with the step time of the first agent with a prediction, predictions sampled at another
+// step time are not optimized.
+class TrustRegionSolver
+{
+public:
+
+  TrustRegionSolver();
+
+  void set_parameters( const std::map<std::string, double>& params );
+
+  // Refines the trajectories of all participants with at least two predicted states in place,
+  // participants without a prediction are kept as static obstacles
+  void solve( dynamics::TrafficParticipantSet& traffic_participant_set );
+
+  const TrustRegionReport&
+  get_report() const
+  {
+    return report;
+  }
+
+  double effort_weight         = 0.1;
+  double tracking_weight       = 1.0;
+  double collision_weight      = 100.0;
+  double safe_distance         = 3.0;
+  double pair_margin           = 2.0; // added to the bounding boxes of the broad phase, covers the motion of one step
+  int    broad_phase_window    = 10;  // time steps per bounding box of the broad phase
+  double convergence_tolerance = 1e-4;
+  int    max_iterations        = 50;
+  double delta_initial         = 1.0;
+  double delta_max             = 4.0;
+  double eta                   = 0.1; // minimum ratio of actual to predicted reduction for a step to be accepted
+  double dt                    = 0.05; // used if the trajectories carry no time steps
+  int    number_of_threads     = 1;
+
+  dynamics::VehicleCommandLimits limits;
+
+private:
+
+  using HessianBlock = Eigen::Matrix2d;
+
+  // Flat storage, agent k owns the steps [offset[k], offset[k] + steps[k]). The control with index i of an agent
+  // moves it from step i to step i + 1, the slot of the last step is unused.
+  std::vector<dynamics::TrafficParticipant*> participants;
+  std::vector<size_t>                        offset;
+  std::vector<size_t>                        steps;
+  std::vector<double>                        wheelbase;
+  std::vector<char>                          optimized; // char instead of bool, the flags are written concurrently
+  std::vector<double>                        trust_radius;
+  std::vector<double>                        agent_cost;
+  std::vector<char>                          agent_converged;
+  std::vector<char>                          agent_accepted;
+  size_t                                     horizon   = 0;
+  double                                     step_time = 0.05;
+
+  std::vector<double> reference_x;
+  std::vector<double> reference_y;
+
+  // Positions of the last iteration, read by all agents, and of the running iteration, written by their owner
+  std::vector<double> position_x;
+  std::vector<double> position_y;
+  std::vector<double> next_position_x;
+  std::vector<double> next_position_y;
+
+  // Remaining states and controls, only accessed by their owner
+  std::vector<double> yaw;
+  std::vector<double> speed;
+  std::vector<double> steering;
+  std::vector<double> steering_command;
+  std::vector<double> acceleration;
+
+  std::vector<double> gradient_steering;
+  std::vector<double> gradient_acceleration;
+  std::vector<double> step_steering;
+  std::vector<double> step_acceleration;
+
+  // Per step 2x2 quasi-Newton approximation of the Hessian of every agent, one block per control
+  std::vector<HessianBlock, Eigen::aligned_allocator<HessianBlock>> hessian;
+
+  // Trial point of a step and adjoint inputs, also only accessed by their owner
+  std::vector<double> trial_x;
+  std::vector<double> trial_y;
+  std::vector<double> trial_yaw;
+  std::vector<double> trial_speed;
+  std::vector<double> trial_steering;
+  std::vector<double> trial_steering_command;
+  std::vector<double> trial_acceleration;
+  std::vector<double> trial_gradient_steering;
+  std::vector<double> trial_gradient_acceleration;
+  std::vector<double> cost_gradient_x;
+  std::vector<double> cost_gradient_y;
+
+  // Broad phase, steps [first_step, last_step] of agent other may come closer than safe_distance
+  struct Neighbor
+  {
+    uint32_t other;
+    uint32_t first_step;
+    uint32_t last_step;
+  };
+
+  struct BoundingBox
+  {
+    double   min_x;
+    double   max_x;
+    double   min_y;
+    double   max_y;
+    uint32_t agent;
+  };
+
+  std::vector<BoundingBox>                   boxes;
+  std::vector<std::pair<uint32_t, Neighbor>> pairs;
+  std::vector<size_t>                        neighbor_offset;
+  std::vector<size_t>                        neighbor_fill;
+  std::vector<Neighbor>                      neighbors;
+
+  std::unique_ptr<ThreadPool> thread_pool;
+  TrustRegionReport           report;
+
+  void load_agents( dynamics::TrafficParticipantSet& traffic_participant_set );
+  void store_agents() const;
+
+  void build_collision_pairs();
+
+  // One trust region iteration of agent k against the positions of the last iteration
+  void step_agent( size_t k );
+
+  // Euler integration of the controls from the fixed first state of agent k
+  void rollout( size_t k, const double* controls_steering, const double* controls_acceleration, double* x, double* y, double* yaws,
+                double* speeds, double* steerings ) const;
+
+  // Cost of agent k for its own states x, y and controls, writes d cost / d x and d cost / d y of every step
+  double evaluate_cost( size_t k, const double* x, const double* y, const double* controls_steering, const double* controls_acceleration,
+                        double* gradient_x, double* gradient_y ) const;
+
+  // Adjoint pass through the rollout, turns the position gradients of the cost into control gradients
+  void backpropagate( size_t k, const double* yaws, const double* speeds, const double* steerings, const double* controls_steering,
+                      const double* controls_acceleration, const double* gradient_x, const double* gradient_y, double* gradient_steering_out,
+                      double* gradient_acceleration_out ) const;
+
+  // Dogleg step for the block diagonal Hessian of agent k
+  void solve_subproblem( size_t k );
+
+  void update_hessian( size_t k );
+};
+
+} // namespace planner
+} // namespace adore
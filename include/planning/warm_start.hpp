@@ -0,0 +1,116 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Sanath Himasekhar Konthala
+ ********************************************************************************/
+#pragma once
+
+#include <cmath>
+
+#include <algorithm>
+#include <array>
+
+#include "OptiNLC_Data.h"
+
+namespace adore
+{
+namespace planner
+{
+
+// Stores the last accepted OptiNLC solution and shifts it forward in time to seed the next solve
+template<int StateSize, int InputSize, int ControlPoints, typename Scalar = double>
+struct WarmStart
+{
+  std::array<VECTOR<Scalar, StateSize>, ControlPoints> states;
+  std::array<VECTOR<Scalar, InputSize>, ControlPoints> inputs;
+
+  double start_time = 0.0;
+  double time_step  = 0.0;
+  bool   valid      = false;
+
+  // Copies the flat solver output (control point major) into the warm start buffers
+  template<typename StateVector, typename InputVector>
+  void
+  store( const StateVector& opt_x, const InputVector& opt_u, double solution_start_time, double solution_time_step )
+  {
+    for( int i = 0; i < ControlPoints; i++ )
+    {
+      for( int j = 0; j < StateSize; j++ )
+        states[i][j] = opt_x[i * StateSize + j];
+      for( int j = 0; j < InputSize; j++ )
+        inputs[i][j] = opt_u[i * InputSize + j];
+    }
+    start_time = solution_start_time;
+    time_step  = solution_time_step;
+    valid      = true;
+  }
+
+  // Shifts the stored solution so that the first control point lies at current_time, the tail is held constant.
+  // Returns false if there is no usable solution for current_time.
+  bool
+  shift( double current_time )
+  {
+    if( !valid || time_step <= 0.0 )
+      return false;
+
+    double elapsed = current_time - start_time;
+    if( elapsed < 0.0 || elapsed >= ( ControlPoints - 1 ) * time_step )
+    {
+      valid = false;
+      return false;
+    }
+
+    // Shift in place: the source index is always ahead of the destination index
+    for( int i = 0; i < ControlPoints; i++ )
+    {
+      double t      = elapsed / time_step + i;
+      int    k      = static_cast<int>( std::floor( t ) );
+      double factor = t - k;
+      if( k >= ControlPoints - 1 )
+      {
+        states[i] = states[ControlPoints - 1];
+        inputs[i] = inputs[ControlPoints - 1];
+        continue;
+      }
+      for( int j = 0; j < StateSize; j++ )
+        states[i][j] = states[k][j] + factor * ( states[k + 1][j] - states[k][j] );
+      for( int j = 0; j < InputSize; j++ )
+        inputs[i][j] = inputs[k][j] + factor * ( inputs[k + 1][j] - inputs[k][j] );
+    }
+    start_time = current_time;
+    return true;
+  }
+
+  // Input elapsed seconds after the first control point, linearly interpolated and held constant after the last one
+  VECTOR<Scalar, InputSize>
+  input_at( double elapsed ) const
+  {
+    double t = std::max( elapsed / time_step, 0.0 );
+    int    k = static_cast<int>( t );
+    if( k >= ControlPoints - 1 )
+      return inputs[ControlPoints - 1];
+
+    double                    factor = t - k;
+    VECTOR<Scalar, InputSize> input;
+    for( int j = 0; j < InputSize; j++ )
+      input[j] = static_cast<Scalar>( inputs[k][j] + factor * ( inputs[k + 1][j] - inputs[k][j] ) );
+    return input;
+  }
+
+  void
+  reset()
+  {
+    valid = false;
+  }
+};
+
+} // namespace planner
+} // namespace adore
@@ -0,0 +1,141 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace adore
+{
+namespace planner
+{
+
+// Lock-free work stealing over the indices [0, count). Every worker starts with one contiguous range and takes
+// indices from its front, a worker whose range is empty steals the back half of the range of another worker.
+// Each range is one atomic word ( begin << 32 | end ), so taking and stealing are single compare and swaps.
+class WorkStealingRanges
+{
+public:
+
+  // Splits [0, count) evenly over the workers, must not be called while workers take indices
+  void
+  reset( size_t count, size_t workers )
+  {
+    if( ranges.size() != workers )
+      ranges = std::vector<Range>( workers );
+    for( size_t w = 0; w < workers; ++w )
+      ranges[w].value.store( pack( count * w / workers, count * ( w + 1 ) / workers ) );
+  }
+
+  // Next index of the range of worker, false if the range is empty
+  bool
+  pop( size_t worker, size_t& index )
+  {
+    auto&    range   = ranges[worker].value;
+    uint64_t current = range.load();
+    while( true )
+    {
+      uint32_t begin = first( current );
+      uint32_t end   = last( current );
+      if( begin >= end )
+        return false;
+      if( range.compare_exchange_weak( current, pack( begin + 1, end ) ) )
+      {
+        index = begin;
+        return true;
+      }
+    }
+  }
+
+  // Moves the back half of the first non-empty range of another worker into the empty range of thief,
+  // false if all other ranges were empty
+  bool
+  steal( size_t thief )
+  {
+    for( size_t i = 1; i < ranges.size(); ++i )
+    {
+      auto&    victim  = ranges[( thief + i ) % ranges.size()].value;
+      uint64_t current = victim.load();
+      while( true )
+      {
+        uint32_t begin = first( current );
+        uint32_t end   = last( current );
+        if( begin >= end )
+          break;
+        uint32_t middle = begin + ( end - begin ) / 2;
+        if( victim.compare_exchange_weak( current, pack( begin, middle ) ) )
+        {
+          ranges[thief].value.store( pack( middle, end ) );
+          steals.fetch_add( 1, std::memory_order_relaxed );
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Next index for worker, from its own range or stolen, false once no work is left
+  bool
+  next( size_t worker, size_t& index )
+  {
+    while( true )
+    {
+      if( pop( worker, index ) )
+        return true;
+      if( !steal( worker ) )
+        return false;
+    }
+  }
+
+  // Successful steals since construction
+  size_t
+  steal_count() const
+  {
+    return steals.load( std::memory_order_relaxed );
+  }
+
+private:
+
+  // One cache line per range, the owner and the thieves of neighbouring ranges do not share lines
+  struct alignas( 64 ) Range
+  {
+    std::atomic<uint64_t> value{ 0 };
+  };
+
+  static uint64_t
+  pack( size_t begin, size_t end )
+  {
+    return ( static_cast<uint64_t>( begin ) << 32 ) | static_cast<uint32_t>( end );
+  }
+
+  static uint32_t
+  first( uint64_t range )
+  {
+    return static_cast<uint32_t>( range >> 32 );
+  }
+
+  static uint32_t
+  last( uint64_t range )
+  {
+    return static_cast<uint32_t>( range );
+  }
+
+  std::vector<Range>  ranges;
+  std::atomic<size_t> steals{ 0 };
+};
+
+} // namespace planner
+} // namespace adore
@@ -12,3 +12,10 @@ endif()
 find_package(OptiNLC REQUIRED)
 
 # this is to make the OptiNLC work... 
+
+# Benchmarks and the replay tool in benchmark/, linked against ${PROJECT}. Off by default, enable with
+# -DADORE_PLANNING_BENCHMARKS=ON. The Google Benchmark targets are skipped if the benchmark package is not found.
+option(ADORE_PLANNING_BENCHMARKS "Build the planning benchmarks and the replay tool" OFF)
+if(ADORE_PLANNING_BENCHMARKS AND EXISTS ${CMAKE_CURRENT_LIST_DIR}/benchmark/CMakeLists.txt)
+    add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/benchmark ${CMAKE_CURRENT_BINARY_DIR}/benchmark)
+endif()
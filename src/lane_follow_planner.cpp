@@ -13,10 +13,14 @@
  ********************************************************************************/
 #include "planning/lane_follow_planner.hpp"
 
-#include "adore_math/curvature.hpp"
+#include <cmath>
+#include <limits>
+
 #include "adore_math/point.h"
 #include "adore_math/spline.h"
 
+#include "planning/curvature_smoothing.hpp"
+
 namespace adore
 {
 namespace planner
@@ -40,6 +44,10 @@ LaneFollowPlanner::set_parameters( const std::map<std::string, double>& params )
       max_lateral_acceleration = value;
     if( name == "spline_length_time" )
       spline_length_time = value;
+    if( name == "curvature_smoothing_window" )
+      curvature_smoothing_window = static_cast<int>( value );
+    if( name == "verbose" )
+      trace.set_echo( value != 0.0 );
   }
 }
 
@@ -47,210 +55,178 @@ dynamics::Trajectory
 LaneFollowPlanner::plan_trajectory( const dynamics::VehicleStateDynamic& current_state, const std::deque<map::MapPoint>& route_points,
                                     const map::Map& local_map, const dynamics::VehicleCommandLimits& limits )
 {
-  desired_acceleration            = std::min( desired_acceleration, limits.max_acceleration );
-  desired_deceleration            = -std::min( -desired_deceleration, limits.min_acceleration );
-  dynamics::Trajectory trajectory = generate_trajectory_from_route( current_state, local_map, route_points, current_state.vx );
-  previous_state                  = current_state;
+  dynamics::Trajectory trajectory;
+  plan_trajectory_into( trajectory, current_state, route_points, local_map, limits );
   return trajectory;
 }
 
-dynamics::Trajectory
-LaneFollowPlanner::generate_trajectory_from_route( const dynamics::VehicleStateDynamic& current_state, const map::Map& local_map,
+void
+LaneFollowPlanner::plan_trajectory_into( dynamics::Trajectory& trajectory, const dynamics::VehicleStateDynamic& current_state,
+                                         const std::deque<map::MapPoint>& route_points, const map::Map& local_map,
+                                         const dynamics::VehicleCommandLimits& limits )
+{
+  desired_acceleration = std::min( desired_acceleration, limits.max_acceleration );
+  desired_deceleration = -std::min( -desired_deceleration, limits.min_acceleration );
+  lane_cache->update( local_map );
+  generate_trajectory_from_route( trajectory, current_state, route_points, current_state.vx );
+  previous_state = current_state;
+}
+
+void
+LaneFollowPlanner::generate_trajectory_from_route( dynamics::Trajectory& trajectory, const dynamics::VehicleStateDynamic& current_state,
                                                    const std::deque<map::MapPoint>& route_points, double initial_speed )
 {
+  trajectory.states.clear();
+
   // Check if route_points is empty
   if( route_points.empty() )
   {
-    std::cerr << "Error: route_points is empty." << std::endl;
-    return dynamics::Trajectory();
+    trace.push( TraceEvent::empty_route_points );
+    return;
   }
 
-  std::deque<map::MapPoint> filtered_points = filter_close_points( route_points );
+  filter_close_points( route_points, path );
 
   // Check if filtering results in too few points
-  if( filtered_points.size() < 2 )
+  if( path.size() < 2 )
   {
-    std::cerr << "Error: Insufficient points after filtering. Size: " << filtered_points.size() << std::endl;
-    return dynamics::Trajectory();
+    trace.push( TraceEvent::insufficient_points_after_filtering, static_cast<double>( path.size() ) );
+    return;
   }
 
   // Apply the spline into the start
-  spline_into_start( current_state, filtered_points );
+  spline_into_start( current_state, path );
 
-  if( filtered_points.size() < 2 )
+  if( path.size() < 2 )
   {
-    std::cerr << "Error: Insufficient points after spline_into_start. Size: " << filtered_points.size() << std::endl;
-    return dynamics::Trajectory();
+    trace.push( TraceEvent::insufficient_points_after_spline, static_cast<double>( path.size() ) );
+    return;
   }
 
   // Compute cumulative distances
-  std::vector<double> distances = compute_cumulative_distances( filtered_points );
+  compute_cumulative_distances( path );
 
   // Check if cumulative distances are valid
-  if( distances.empty() || distances.size() < 2 )
+  if( path.s.empty() || path.s.size() < 2 )
   {
-    std::cerr << "Error: Invalid distances computed. Size: " << distances.size() << std::endl;
-    return dynamics::Trajectory();
+    trace.push( TraceEvent::invalid_distances, static_cast<double>( path.s.size() ) );
+    return;
   }
 
   // Compute curvatures
-  std::vector<double> curvatures = compute_curvatures( filtered_points );
+  compute_curvatures( path );
 
   // Check for NaNs or Infs in curvatures
-  for( double curvature : curvatures )
+  for( double curvature : path.curvature )
   {
     if( !std::isfinite( curvature ) )
     {
-      std::cerr << "Error: Non-finite value in curvatures." << std::endl;
-      return dynamics::Trajectory();
+      trace.push( TraceEvent::non_finite_curvature );
+      return;
     }
   }
 
   // Generate speed profile
-  std::vector<double> speeds = generate_speed_profile( distances, filtered_points, curvatures, local_map, initial_speed );
+  resolve_lanes( path );
+  generate_speed_profile( path, initial_speed );
 
   // Check if speeds are valid
-  if( speeds.empty() || speeds.size() != distances.size() )
+  if( path.speed.empty() || path.speed.size() != path.s.size() )
   {
-    std::cerr << "Error: Invalid speeds computed. Speeds size: " << speeds.size() << ", Distances size: " << distances.size() << std::endl;
-    return dynamics::Trajectory();
+    trace.push( TraceEvent::invalid_speeds, static_cast<double>( path.speed.size() ), static_cast<double>( path.s.size() ) );
+    return;
   }
 
   // Check for NaNs or Infs in speeds
-  for( double speed : speeds )
+  for( double speed : path.speed )
   {
     if( !std::isfinite( speed ) )
     {
-      std::cerr << "Error: Non-finite value in speeds." << std::endl;
-      return dynamics::Trajectory();
+      trace.push( TraceEvent::non_finite_speed );
+      return;
     }
   }
 
   // Compute cumulative times
-  std::vector<double> times = compute_cumulative_times( distances, speeds );
+  compute_cumulative_times( path );
 
   // Check if times are valid
-  if( times.empty() || times.size() != distances.size() )
+  if( path.time.empty() || path.time.size() != path.s.size() )
   {
-    std::cerr << "Error: Invalid times computed. Times size: " << times.size() << ", Distances size: " << distances.size() << std::endl;
-    return dynamics::Trajectory();
+    trace.push( TraceEvent::invalid_times, static_cast<double>( path.time.size() ), static_cast<double>( path.s.size() ) );
+    return;
   }
 
   // Resample trajectory
-  dynamics::Trajectory trajectory = resample_trajectory( current_state, times, filtered_points, speeds, curvatures );
+  resample_trajectory( current_state, path, trajectory );
 
   // Check if trajectory is populated
   if( trajectory.states.empty() )
   {
-    std::cerr << "Error: Empty trajectory generated." << std::endl;
-    return trajectory;
+    trace.push( TraceEvent::empty_trajectory );
+    return;
   }
 
   trajectory.adjust_start_time( current_state.time );
-
-  return trajectory;
 }
 
-std::deque<map::MapPoint>
-LaneFollowPlanner::filter_close_points( const std::deque<map::MapPoint>& points )
+void
+LaneFollowPlanner::filter_close_points( const std::deque<map::MapPoint>& route_points, PathBuffer& points )
 {
-  std::deque<map::MapPoint> filtered_points;
-  if( points.empty() )
-    return filtered_points;
+  points.clear();
+  if( route_points.empty() )
+    return;
 
-  filtered_points.push_back( points.front() );
-  map::MapPoint last_point = points.front();
+  points.push_back( route_points.front() );
+  const map::MapPoint* last_point = &route_points.front();
 
-  for( const auto& point : points )
+  for( const auto& point : route_points )
   {
-    double distance = adore::math::distance_2d( last_point, point );
+    double distance = adore::math::distance_2d( *last_point, point );
     if( distance >= min_point_distance )
     {
-      filtered_points.push_back( point );
-      last_point = point;
+      points.push_back( point );
+      last_point = &point;
     }
   }
-
-  return filtered_points;
 }
 
-std::vector<double>
-LaneFollowPlanner::compute_cumulative_distances( const std::deque<map::MapPoint>& points )
+void
+LaneFollowPlanner::compute_cumulative_distances( PathBuffer& points )
 {
-  size_t              n = points.size();
-  std::vector<double> distances( n, 0.0 );
+  size_t n = points.size();
+  points.s.assign( n, 0.0 );
   for( size_t i = 1; i < n; ++i )
   {
-    double ds    = adore::math::distance_2d( points[i - 1], points[i] );
-    distances[i] = distances[i - 1] + ds;
+    double ds   = points.distance( i - 1, i );
+    points.s[i] = points.s[i - 1] + ds;
   }
-  return distances;
 }
 
-std::vector<double>
-LaneFollowPlanner::compute_curvatures( const std::deque<map::MapPoint>& points )
+void
+LaneFollowPlanner::compute_curvatures( PathBuffer& points )
 {
-  size_t              n = points.size();
-  std::vector<double> curvatures( n, 0.0 );
-
-  // Compute curvature using a larger window size for robustness against noise
-  for( size_t i = 2; i < n - 2; ++i ) // Adjust the window size here
-  {
-    // Average positions in a larger window to reduce noise sensitivity
-    double x1 = ( points[i - 2].x + points[i - 1].x ) / 2.0;
-    double y1 = ( points[i - 2].y + points[i - 1].y ) / 2.0;
-    double x2 = points[i].x;
-    double y2 = points[i].y;
-    double x3 = ( points[i + 1].x + points[i + 2].x ) / 2.0;
-    double y3 = ( points[i + 1].y + points[i + 2].y ) / 2.0;
-
-    double kappa  = adore::math::compute_curvature( x1, y1, x2, y2, x3, y3 );
-    curvatures[i] = kappa;
-  }
-
-  // Handle boundary points by copying neighboring values
-  if( n > 4 )
-  {
-    curvatures[0]     = curvatures[2];
-    curvatures[1]     = curvatures[2];
-    curvatures[n - 1] = curvatures[n - 3];
-    curvatures[n - 2] = curvatures[n - 3];
-  }
-  else
-  {
-    curvatures[0] = 0.0;
-    if( n > 1 )
-      curvatures[1] = 0.0;
-  }
+  compute_smoothed_curvatures( points.x.data(), points.y.data(), points.size(), curvature_smoothing_window, false, curvature_scratch,
+                               points.curvature );
+}
 
-  // Apply a simple moving average filter to smooth the computed curvatures
-  std::vector<double> smoothed_curvatures( n, 0.0 );
-  const int           smoothing_window = 10; // Adjust window size for desired smoothing level
+void
+LaneFollowPlanner::resolve_lanes( PathBuffer& points )
+{
+  size_t n = points.size();
+  points.lane.resize( n );
   for( size_t i = 0; i < n; ++i )
-  {
-    double sum   = 0.0;
-    int    count = 0;
-    for( int j = -smoothing_window; j <= smoothing_window; ++j )
-    {
-      int index = i + j;
-      if( index >= 0 && static_cast<size_t>( index ) < n )
-      {
-        sum += curvatures[index];
-        ++count;
-      }
-    }
-    smoothed_curvatures[i] = sum / count;
-  }
-
-  return smoothed_curvatures;
+    points.lane[i] = &lane_cache->resolve( points.lane_id[i] );
 }
 
-std::vector<double>
-LaneFollowPlanner::generate_speed_profile( const std::vector<double>& distances, const std::deque<map::MapPoint>& route_points,
-                                           const std::vector<double>& curvatures, const map::Map& local_map, double initial_speed )
+void
+LaneFollowPlanner::generate_speed_profile( PathBuffer& points, double initial_speed )
 {
-  size_t              n = distances.size();
-  std::vector<double> speeds( n, initial_speed );
+  size_t                     n          = points.s.size();
+  const std::vector<double>& distances  = points.s;
+  const std::vector<double>& curvatures = points.curvature;
+  std::vector<double>&       speeds     = points.speed;
+  speeds.assign( n, initial_speed );
 
 
   // Forward pass to set speed limits based on constraints
@@ -268,15 +244,9 @@ LaneFollowPlanner::generate_speed_profile( const std::vector<double>& distances,
       max_speed_allowed    = std::min( max_speed_allowed, speed_lateral );
     }
 
-    // Check speed limit of the lane at the current route point
-    size_t lane_id = route_points[i].parent_id;
-    if( local_map.lanes.find( lane_id ) != local_map.lanes.end() )
-    {
-      double lane_speed_limit = local_map.get_lane_speed_limit( lane_id );
-      max_speed_allowed       = std::min( max_speed_allowed, lane_speed_limit );
-    }
-    if( route_points[i].max_speed )
-      max_speed_allowed = std::min( max_speed_allowed, route_points[i].max_speed.value() );
+    // Check speed limit of the lane at the current route point, lanes outside of the map have no limit
+    max_speed_allowed = std::min( max_speed_allowed, points.lane[i]->speed_limit );
+    max_speed_allowed = std::min( max_speed_allowed, points.speed_limit[i] );
 
     speeds[i] = std::min( max_speed, max_speed_allowed );
     speeds[i] = std::max( speeds[i], std::sqrt( speeds[i - 1] * speeds[i - 1] - 2 * desired_deceleration * ds ) );
@@ -290,41 +260,48 @@ LaneFollowPlanner::generate_speed_profile( const std::vector<double>& distances,
     double max_speed_allowed = std::sqrt( speeds[i + 1] * speeds[i + 1] + 2 * desired_deceleration * ds );
     speeds[i]                = std::min( speeds[i], max_speed_allowed );
   }
-
-  return speeds;
 }
 
-std::vector<double>
-LaneFollowPlanner::compute_cumulative_times( const std::vector<double>& distances, const std::vector<double>& speeds )
+void
+LaneFollowPlanner::compute_cumulative_times( PathBuffer& points )
 {
-  size_t              n = distances.size();
-  std::vector<double> times( n, 0.0 );
+  size_t n = points.s.size();
+  points.time.assign( n, 0.0 );
   for( size_t i = 1; i < n; ++i )
   {
-    double ds        = distances[i] - distances[i - 1];
-    double avg_speed = ( speeds[i - 1] + speeds[i] ) / 2.0;
+    double ds        = points.s[i] - points.s[i - 1];
+    double avg_speed = ( points.speed[i - 1] + points.speed[i] ) / 2.0;
     double dt        = ds / avg_speed;
-    times[i]         = times[i - 1] + dt;
+    points.time[i]   = points.time[i - 1] + dt;
   }
-  return times;
 }
 
-dynamics::Trajectory
-LaneFollowPlanner::resample_trajectory( const dynamics::VehicleStateDynamic& current_state, const std::vector<double>& times,
-                                        const std::deque<map::MapPoint>& points, const std::vector<double>& speeds,
-                                        const std::vector<double>& curvatures )
+void
+LaneFollowPlanner::resample_trajectory( const dynamics::VehicleStateDynamic& current_state, const PathBuffer& points,
+                                        dynamics::Trajectory& trajectory )
 {
-  dynamics::Trajectory trajectory;
-  double               total_time = times.back();
-  size_t               n          = times.size();
+  const std::vector<double>& times      = points.time;
+  const std::vector<double>& speeds     = points.speed;
+  const std::vector<double>& curvatures = points.curvature;
+
+  trajectory.states.clear();
+  double total_time = times.back();
+  size_t n          = times.size();
 
   double prev_v              = speeds[0];
   double prev_steering_angle = current_state.steering_angle;
 
+  // One state per time step plus the states appended at standstill
+  if( std::isfinite( total_time ) && total_time > 0.0 )
+    trajectory.states.reserve( static_cast<size_t>( total_time / dt ) + 12 );
+
+  // The sample times increase, so the first point at or after t is found with a cursor that only moves forward
+  size_t cursor = 0;
   for( double t = 0.0; t <= total_time; t += dt )
   {
-    auto   it  = std::lower_bound( times.begin(), times.end(), t );
-    size_t idx = std::distance( times.begin(), it );
+    while( cursor < n && times[cursor] < t )
+      cursor++;
+    size_t idx = cursor;
 
     if( idx == 0 )
       idx = 1;
@@ -335,12 +312,14 @@ LaneFollowPlanner::resample_trajectory( const dynamics::VehicleStateDynamic& cur
     double t1     = times[idx];
     double factor = ( t - t0 ) / ( t1 - t0 );
 
-    const auto& p0  = points[idx - 1];
-    const auto& p1  = points[idx];
-    double      x   = p0.x + factor * ( p1.x - p0.x );
-    double      y   = p0.y + factor * ( p1.y - p0.y );
-    double      v   = speeds[idx - 1] + factor * ( speeds[idx] - speeds[idx - 1] );
-    double      yaw = std::atan2( p1.y - p0.y, p1.x - p0.x );
+    double x0  = points.x[idx - 1];
+    double y0  = points.y[idx - 1];
+    double x1  = points.x[idx];
+    double y1  = points.y[idx];
+    double x   = x0 + factor * ( x1 - x0 );
+    double y   = y0 + factor * ( y1 - y0 );
+    double v   = speeds[idx - 1] + factor * ( speeds[idx] - speeds[idx - 1] );
+    double yaw = std::atan2( y1 - y0, x1 - x0 );
 
     // Axial acceleration (ax)
     double ax = ( v - prev_v ) / dt;
@@ -374,7 +353,7 @@ LaneFollowPlanner::resample_trajectory( const dynamics::VehicleStateDynamic& cur
     trajectory.states.push_back( state );
   }
   if( trajectory.states.empty() )
-    return trajectory;
+    return;
 
   if( trajectory.states.back().vx < 0.01 )
   {
@@ -383,35 +362,34 @@ LaneFollowPlanner::resample_trajectory( const dynamics::VehicleStateDynamic& cur
       trajectory.states.push_back( trajectory.states.back() );
     }
   }
-  return trajectory;
 }
 
 void
-LaneFollowPlanner::spline_into_start( const dynamics::VehicleStateDynamic& current_state, std::deque<map::MapPoint>& route_points )
+LaneFollowPlanner::spline_into_start( const dynamics::VehicleStateDynamic& current_state, PathBuffer& points )
 {
   // If we don't have enough points, just return
-  if( route_points.size() < 2 )
+  if( points.size() < 2 )
   {
     return;
   }
 
   // Remove very close overlapping points from the front
-  double ds = 0.0;
-  while( ds < 0.01 && route_points.size() > 2 )
+  double ds    = 0.0;
+  size_t first = 0;
+  while( ds < 0.01 && points.size() - first > 2 )
   {
-    route_points.pop_front();
-    ds = adore::math::distance_2d( route_points[0], route_points[1] );
+    first++;
+    ds = points.distance( first, first + 1 );
   }
-  if( route_points.size() <= 2 )
+  points.erase_front( first );
+  if( points.size() <= 2 )
   {
     return;
   }
 
-  map::MapPoint ref_point = route_points.front();
-
-  double dx            = ref_point.x - current_state.x;
-  double dy            = ref_point.y - current_state.y;
-  double route_heading = std::atan2( route_points[1].y - route_points[0].y, route_points[1].x - route_points[0].x );
+  double dx            = points.x[0] - current_state.x;
+  double dy            = points.y[0] - current_state.y;
+  double route_heading = std::atan2( points.y[1] - points.y[0], points.x[1] - points.x[0] );
 
   // Yaw difference: how aligned we are with the route
   double yaw_error = adore::math::normalize_angle( route_heading - current_state.yaw_angle );
@@ -433,15 +411,11 @@ LaneFollowPlanner::spline_into_start( const dynamics::VehicleStateDynamic& curre
   if( previous_state )
     lookahead_dist -= adore::math::distance_2d( current_state, *previous_state );
 
-  // Now, figure out how many points to replace based on new lookahead distance
-  size_t              num_points = route_points.size();
-  std::vector<double> cumulative_d;
-  cumulative_d.resize( num_points, 0.0 );
-  for( size_t i = 1; i < num_points; ++i )
-  {
-    double dd       = adore::math::distance_2d( route_points[i - 1], route_points[i] );
-    cumulative_d[i] = cumulative_d[i - 1] + dd;
-  }
+  // Now, figure out how many points to replace based on new lookahead distance,
+  // s of the buffer is overwritten by compute_cumulative_distances afterwards
+  size_t num_points = points.size();
+  compute_cumulative_distances( points );
+  const std::vector<double>& cumulative_d = points.s;
 
   // Find how many route points lie within 'lookahead_dist'
   size_t num_point_to_replace = 0;
@@ -455,41 +429,25 @@ LaneFollowPlanner::spline_into_start( const dynamics::VehicleStateDynamic& curre
   }
 
   // If we didn't find a suitable cutoff (route too short), just return
-  if( num_point_to_replace == 0 || num_point_to_replace >= route_points.size() )
+  if( num_point_to_replace == 0 || num_point_to_replace >= num_points )
   {
     return;
   }
 
   // Extract the end points for the spline
-  map::MapPoint end_point = route_points[num_point_to_replace];
-  if( num_point_to_replace + 1 >= route_points.size() )
+  if( num_point_to_replace + 1 >= num_points )
   {
     return; // Not enough points to form spline
   }
-  map::MapPoint end_point2 = route_points[num_point_to_replace + 1];
-
-  // Remove replaced segment
-  route_points.erase( route_points.begin(), route_points.begin() + num_point_to_replace );
-
+  math::Point2d end_point         = points.point( num_point_to_replace );
+  math::Point2d end_point2        = points.point( num_point_to_replace + 1 );
+  size_t        end_point_lane_id = points.lane_id[num_point_to_replace];
 
   double virtual_point_distance = 0.01 * adaptive_scale; // Scale virtual point spacing as well
   double x0                     = current_state.x;
   double y0                     = current_state.y;
 
-  // Two virtual points ahead of current position to set initial heading
-  map::MapPoint start_virtual;
-  start_virtual.x         = x0 + virtual_point_distance * std::cos( current_state.yaw_angle );
-  start_virtual.y         = y0 + virtual_point_distance * std::sin( current_state.yaw_angle );
-  start_virtual.parent_id = end_point.parent_id;
-  start_virtual.max_speed = std::nullopt;
-
-  map::MapPoint start_virtual_2;
-  start_virtual_2.x         = x0 + 2 * virtual_point_distance * std::cos( current_state.yaw_angle );
-  start_virtual_2.y         = y0 + 2 * virtual_point_distance * std::sin( current_state.yaw_angle );
-  start_virtual_2.parent_id = end_point.parent_id;
-  start_virtual_2.max_speed = std::nullopt;
-
-  // Build spline points
+  // Build spline points, two virtual points ahead of current position set the initial heading
   std::vector<double> spline_s;
   std::vector<double> spline_x;
   std::vector<double> spline_y;
@@ -500,13 +458,13 @@ LaneFollowPlanner::spline_into_start( const dynamics::VehicleStateDynamic& curre
 
   double s1 = virtual_point_distance;
   spline_s.push_back( s1 );
-  spline_x.push_back( start_virtual.x );
-  spline_y.push_back( start_virtual.y );
+  spline_x.push_back( x0 + virtual_point_distance * std::cos( current_state.yaw_angle ) );
+  spline_y.push_back( y0 + virtual_point_distance * std::sin( current_state.yaw_angle ) );
 
   double s2 = 2 * virtual_point_distance;
   spline_s.push_back( s2 );
-  spline_x.push_back( start_virtual_2.x );
-  spline_y.push_back( start_virtual_2.y );
+  spline_x.push_back( x0 + 2 * virtual_point_distance * std::cos( current_state.yaw_angle ) );
+  spline_y.push_back( y0 + 2 * virtual_point_distance * std::sin( current_state.yaw_angle ) );
 
   // Distance from start_virtual_2 to end_point
   double dist_to_end = adore::math::distance_2d( adore::math::Point2d( spline_x.back(), spline_y.back() ), end_point );
@@ -526,34 +484,23 @@ LaneFollowPlanner::spline_into_start( const dynamics::VehicleStateDynamic& curre
   s_x.set_points( spline_s, spline_x, tk::spline::cspline );
   s_y.set_points( spline_s, spline_y, tk::spline::cspline );
 
-  // Fill route_points with spline samples at intervals ds (the original ds from filtering)
+  // Sample the spline at intervals ds (the original ds from filtering)
   // But we might want to use a slightly smaller ds here for a smoother curve.
+  // The samples are taken from the end backwards and inserted in ascending order.
   double sample_ds = ds * 0.5; // oversampling for smoother transitions
+  spline_samples.clear();
   for( double s = s4; s >= 0.0; s -= sample_ds )
-  {
-    double new_x = s_x( s );
-    double new_y = s_y( s );
-
-    map::MapPoint spline_point;
-    spline_point.x         = new_x;
-    spline_point.y         = new_y;
-    spline_point.parent_id = end_point.parent_id;
-    spline_point.max_speed = std::nullopt;
-
-    route_points.push_front( spline_point );
-  }
-
-  // Ensure start point at s=0.0
-  {
-    map::MapPoint start_point;
-    start_point.x         = s_x( 0.0 );
-    start_point.y         = s_y( 0.0 );
-    start_point.parent_id = end_point.parent_id;
-    start_point.max_speed = std::nullopt;
-    route_points.push_front( start_point );
-  }
+    spline_samples.push_back( s );
+
+  // Ensure start point at s=0.0, then the spline samples, then the remaining route without the replaced segment
+  const double no_speed_limit = std::numeric_limits<double>::infinity();
+  path_scratch.clear();
+  path_scratch.push_back( s_x( 0.0 ), s_y( 0.0 ), end_point_lane_id, no_speed_limit );
+  for( auto it = spline_samples.rbegin(); it != spline_samples.rend(); ++it )
+    path_scratch.push_back( s_x( *it ), s_y( *it ), end_point_lane_id, no_speed_limit );
+  path_scratch.append( points, num_point_to_replace, num_points );
+  points.swap( path_scratch );
 }
 
-
 } // namespace planner
 } // namespace adore
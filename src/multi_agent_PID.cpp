@@ -62,6 +62,14 @@ MultiAgentPID::set_parameters( const std::map<std::string, double>& params )
       min_distance = value;
     else if( name == "time_headway" )
       time_headway = value;
+    else if( name == "parallel_prediction" )
+      parallel_prediction = value != 0.0;
+    else if( name == "number_of_threads" )
+      number_of_threads = std::max( static_cast<int>( value ), 1 );
+    else if( name == "batch_integration" )
+      batch_integration = value != 0.0;
+    else if( name == "obstacle_search_radius" )
+      obstacle_search_radius = value;
   }
 }
 
@@ -75,52 +83,204 @@ MultiAgentPID::get_current_state( const dynamics::TrafficParticipant& participan
   return participant.state;
 }
 
+dynamics::VehicleStateDynamic
+MultiAgentPID::get_current_state( int id, const dynamics::TrafficParticipant& participant )
+{
+  if( batch_state )
+    return batch_state->get_state( batch_index.at( id ) );
+  return get_current_state( participant );
+}
+
 void
 MultiAgentPID::plan_trajectories( dynamics::TrafficParticipantSet& traffic_participant_set )
 {
   for( auto& [id, participant] : traffic_participant_set.participants )
   {
-    participant.trajectory = dynamics::Trajectory();
-    participant.state.vx   = 0.0;
+    // Reset the trajectory but keep the storage of the previous prediction
+    std::vector<dynamics::VehicleStateDynamic> states;
+    if( participant.trajectory )
+      states = std::move( participant.trajectory->states );
+    states.clear();
+    states.reserve( number_of_integration_steps );
+
+    participant.trajectory         = dynamics::Trajectory();
+    participant.trajectory->states = std::move( states );
+    participant.state.vx           = 0.0;
   }
-  // Precompute motion model lambdas for each participant.
-  std::map<int, MotionModel> motion_models;
-
   for( auto& [id, participant] : traffic_participant_set.participants )
   {
     if( participant.physical_parameters.wheelbase == 0 )
       participant.physical_parameters.wheelbase = 0.5;
 
-    motion_models[id] = [params = participant.physical_parameters]( const dynamics::VehicleStateDynamic& state,
-                                                                    const dynamics::VehicleCommand& cmd ) -> dynamics::VehicleStateDynamic {
-      return dynamics::kinematic_bicycle_model( state, params, cmd );
-    };
+    route_hints[id].reset();
   }
 
-  for( int i = 0; i < number_of_integration_steps; ++i )
+  // Hints of participants that left the set
+  for( auto it = route_hints.begin(); it != route_hints.end(); )
   {
-    for( auto& [id, participant] : traffic_participant_set.participants )
-    {
-      if( participant.physical_parameters.wheelbase == 0 )
-        participant.physical_parameters.wheelbase = 0.5;
-      dynamics::VehicleStateDynamic next_state;
-      dynamics::VehicleStateDynamic current_state = get_current_state( participant );
+    if( traffic_participant_set.participants.count( it->first ) == 0 )
+      it = route_hints.erase( it );
+    else
+      ++it;
+  }
 
-      dynamics::VehicleCommand vehicle_command = dynamics::VehicleCommand( 0.0, 0.0 );
+  if( batch_integration )
+  {
+    plan_trajectories_batch( traffic_participant_set );
+    return;
+  }
 
-      if( participant.route && !participant.route->center_lane.empty() )
+  if( !parallel_prediction )
+  {
+    for( int i = 0; i < number_of_integration_steps; ++i )
+    {
+      build_agent_grid( traffic_participant_set );
+      for( auto& [id, participant] : traffic_participant_set.participants )
       {
-        vehicle_command = compute_vehicle_command( current_state, traffic_participant_set, id );
+        dynamics::VehicleStateDynamic next_state = predict_next_state( participant, traffic_participant_set, id );
+        participant.trajectory->states.push_back( next_state );
       }
+    }
+    return;
+  }
+
+  if( !thread_pool || thread_pool->size() != static_cast<size_t>( number_of_threads ) )
+  {
+    thread_pool = std::make_unique<ThreadPool>( number_of_threads );
+  }
+
+  std::vector<int>                           agent_ids;
+  std::vector<dynamics::TrafficParticipant*> agents;
+  for( auto& [id, participant] : traffic_participant_set.participants )
+  {
+    agent_ids.push_back( id );
+    agents.push_back( &participant );
+  }
+  std::vector<dynamics::VehicleStateDynamic> next_states( agents.size() );
+
+  for( int i = 0; i < number_of_integration_steps; ++i )
+  {
+    build_agent_grid( traffic_participant_set );
+
+    // Every agent reads the states of the previous step, the new states are appended once all agents are done
+    thread_pool->parallel_for( agents.size(), [&]( size_t k ) {
+      next_states[k] = predict_next_state( *agents[k], traffic_participant_set, agent_ids[k] );
+    } );
+
+    for( size_t k = 0; k < agents.size(); ++k )
+    {
+      agents[k]->trajectory->states.push_back( next_states[k] );
+    }
+  }
+}
+
+void
+MultiAgentPID::plan_trajectories_batch( dynamics::TrafficParticipantSet& traffic_participant_set )
+{
+  if( parallel_prediction && ( !thread_pool || thread_pool->size() != static_cast<size_t>( number_of_threads ) ) )
+  {
+    thread_pool = std::make_unique<ThreadPool>( number_of_threads );
+  }
+
+  std::vector<int>                           agent_ids;
+  std::vector<dynamics::TrafficParticipant*> agents;
+  batch_index.clear();
+  for( auto& [id, participant] : traffic_participant_set.participants )
+  {
+    batch_index[id] = agents.size();
+    agent_ids.push_back( id );
+    agents.push_back( &participant );
+  }
 
-      next_state = dynamics::integrate_euler( current_state, vehicle_command, dt, motion_models[id] );
+  const size_t agent_count = agents.size();
+  batch.resize( agent_count );
+  for( size_t k = 0; k < agent_count; ++k )
+  {
+    batch.set_state( k, agents[k]->state );
+    batch.wheelbase[k] = agents[k]->physical_parameters.wheelbase;
+  }
+  batch_state = &batch;
 
-      next_state.ax             = vehicle_command.acceleration;
-      next_state.steering_angle = vehicle_command.steering_angle;
+  // Commands are collected separately, batch is read by all agents while they are computed
+  std::vector<double> accelerations( agent_count, 0.0 );
+  std::vector<double> steering_commands( agent_count, 0.0 );
 
-      participant.trajectory->states.push_back( next_state );
+  auto compute_command = [&]( size_t k ) {
+    const auto&              participant     = *agents[k];
+    dynamics::VehicleCommand vehicle_command = dynamics::VehicleCommand( 0.0, 0.0 );
+    if( participant.route && !participant.route->center_lane.empty() )
+    {
+      vehicle_command = compute_vehicle_command( batch.get_state( k ), traffic_participant_set, agent_ids[k] );
     }
+    accelerations[k]     = vehicle_command.acceleration;
+    steering_commands[k] = vehicle_command.steering_angle;
+  };
+
+  for( int i = 0; i < number_of_integration_steps; ++i )
+  {
+    build_agent_grid( traffic_participant_set );
+
+    // All commands are computed from the states of the previous step before any agent moves
+    if( parallel_prediction )
+      thread_pool->parallel_for( agent_count, compute_command );
+    else
+      for( size_t k = 0; k < agent_count; ++k )
+        compute_command( k );
+
+    batch.acceleration.swap( accelerations );
+    batch.steering_command.swap( steering_commands );
+    batch.integrate( dt );
+
+    for( size_t k = 0; k < agent_count; ++k )
+      agents[k]->trajectory->states.push_back( batch.get_state( k ) );
+  }
+  batch_state = nullptr;
+}
+
+void
+MultiAgentPID::build_agent_grid( const dynamics::TrafficParticipantSet& traffic_participant_set )
+{
+  agent_grid.clear( obstacle_search_radius );
+  if( obstacle_search_radius <= 0.0 )
+    return;
+
+  // In the sequential update agents move during the step, the padding covers one step of the fastest agent
+  double max_step_distance = 0.0;
+  for( const auto& [id, participant] : traffic_participant_set.participants )
+  {
+    dynamics::VehicleStateDynamic state = get_current_state( id, participant );
+    agent_grid.insert( id, state.x, state.y );
+    max_step_distance = std::max( max_step_distance, std::hypot( state.vx, state.vy ) * dt );
   }
+  agent_grid.finalize();
+  agent_grid_padding = 2.0 * max_step_distance;
+}
+
+dynamics::VehicleStateDynamic
+MultiAgentPID::predict_next_state( const dynamics::TrafficParticipant&    participant,
+                                   const dynamics::TrafficParticipantSet& traffic_participant_set, int id )
+{
+  dynamics::VehicleStateDynamic current_state = get_current_state( participant );
+
+  dynamics::VehicleCommand vehicle_command = dynamics::VehicleCommand( 0.0, 0.0 );
+
+  if( participant.route && !participant.route->center_lane.empty() )
+  {
+    vehicle_command = compute_vehicle_command( current_state, traffic_participant_set, id );
+  }
+
+  // Same step as the batch integration, see BatchBicycleState
+  double                        wheelbase  = participant.physical_parameters.wheelbase;
+  dynamics::VehicleStateDynamic next_state = current_state;
+  kinematic_bicycle_step( next_state.x, next_state.y, next_state.yaw_angle, next_state.vx, current_state.steering_angle, wheelbase,
+                          vehicle_command.acceleration, dt );
+  next_state.time += dt;
+
+  next_state.ax             = vehicle_command.acceleration;
+  next_state.steering_angle = vehicle_command.steering_angle;
+  next_state.yaw_rate       = next_state.vx * std::tan( next_state.steering_angle ) / wheelbase;
+
+  return next_state;
 }
 
 dynamics::VehicleCommand
@@ -129,15 +289,17 @@ MultiAgentPID::compute_vehicle_command( const dynamics::VehicleStateDynamic&   c
 {
   auto& participant = traffic_participant_set.participants.at( id );
 
-  double state_s = participant.route->get_s( current_state );
+  // Projected once per step, starting from the progress of the previous step
+  double state_s = project_onto_route( *participant.route, current_state, route_hints.at( id ) ).s;
 
   double goal_dist = participant.route->get_length() - state_s;
 
   // 1. Compute lane-following (center-line) errors
-  auto [error_lateral, error_yaw] = compute_lane_following_errors( current_state, participant );
+  auto [error_lateral, error_yaw] = compute_lane_following_errors( current_state, participant, state_s );
 
   // 2. Calculate the nearest obstacle distance & offset
-  auto [closest_obstacle_distance, obstacle_speed, offset] = compute_distance_speed_offset_nearest_obstacle( traffic_participant_set, id );
+  auto [closest_obstacle_distance, obstacle_speed, offset] = compute_distance_speed_offset_nearest_obstacle( current_state, state_s,
+                                                                                                             traffic_participant_set, id );
 
   // 3. Compute the “desired velocity” from IDM logic
   double idm_velocity = compute_idm_velocity( closest_obstacle_distance, goal_dist, obstacle_speed, current_state );
@@ -186,19 +348,19 @@ MultiAgentPID::compute_vehicle_command( const dynamics::VehicleStateDynamic&   c
   // vehicle_command.steering_angle += lane_center_gain * alpha_center * error_lateral;
 
   // 9. Finally, clamp commands (accelerations, steering, etc.) to your vehicle limits
-  limits.max_steering_angle = 0.5;
-  vehicle_command.clamp_within_limits( limits );
+  dynamics::VehicleCommandLimits command_limits = limits;
+  command_limits.max_steering_angle              = 0.5;
+  vehicle_command.clamp_within_limits( command_limits );
 
   return vehicle_command;
 }
 
 std::pair<double, double>
 MultiAgentPID::compute_lane_following_errors( const dynamics::VehicleStateDynamic& current_state,
-                                              const dynamics::TrafficParticipant&  participant )
+                                              const dynamics::TrafficParticipant& participant, double current_s )
 {
-  double       current_trajectory_s = participant.route->get_s( current_state );
-  double       target_distance      = current_trajectory_s + 0.5 + 0.1 * current_state.vx;
-  math::Pose2d target_pose          = participant.route->get_pose_at_s( target_distance );
+  double       target_distance = current_s + 0.5 + 0.1 * current_state.vx;
+  math::Pose2d target_pose     = participant.route->get_pose_at_s( target_distance );
 
   double error_lateral = compute_error_lateral_distance( current_state, target_pose );
   double error_yaw     = compute_error_yaw( current_state.yaw_angle, target_pose.yaw );
@@ -242,7 +404,8 @@ MultiAgentPID::compute_error_yaw( double current_yaw, double target_yaw )
 }
 
 std::tuple<double, double, double>
-MultiAgentPID::compute_distance_speed_offset_nearest_obstacle( const dynamics::TrafficParticipantSet& traffic_participant_set,
+MultiAgentPID::compute_distance_speed_offset_nearest_obstacle( const dynamics::VehicleStateDynamic& current_state, double current_s,
+                                                               const dynamics::TrafficParticipantSet& traffic_participant_set,
                                                                int                                    vehicle_id )
 {
   double closest_distance      = std::numeric_limits<double>::max();
@@ -255,20 +418,18 @@ MultiAgentPID::compute_distance_speed_offset_nearest_obstacle( const dynamics::T
     return { closest_distance, obstacle_speed, offset_closest_object };
   }
 
-  auto&  route         = ref_participant.route.value();
-  double ref_current_s = route.get_s( get_current_state( ref_participant ) );
+  auto& route = ref_participant.route.value();
 
-  for( const auto& [id, other_participant] : traffic_participant_set.participants )
-  {
+  auto check_obstacle = [&]( int id, const dynamics::TrafficParticipant& other_participant ) {
     if( id == vehicle_id )
-      continue;
+      return;
 
-    dynamics::VehicleStateDynamic object_state = get_current_state( other_participant );
+    dynamics::VehicleStateDynamic object_state = get_current_state( id, other_participant );
     double                        object_s     = route.get_s( object_state );
-    double                        distance     = object_s - ref_current_s;
+    double                        distance     = object_s - current_s;
 
     if( distance < 1.0 )
-      continue;
+      return;
 
     auto pose_at_distance = route.get_pose_at_s( object_s );
 
@@ -278,12 +439,12 @@ MultiAgentPID::compute_distance_speed_offset_nearest_obstacle( const dynamics::T
     double current_offset = -dx * std::sin( pose_at_distance.yaw ) + dy * std::cos( pose_at_distance.yaw );
 
     if( std::abs( current_offset ) > 0.5 * lane_width )
-      continue;
+      return;
 
     if( std::abs( current_offset ) > obstacle_avoidance_offset_threshold )
     {
       offset_closest_object = current_offset;
-      continue;
+      return;
     }
 
     if( distance < closest_distance )
@@ -292,6 +453,23 @@ MultiAgentPID::compute_distance_speed_offset_nearest_obstacle( const dynamics::T
       obstacle_speed        = object_state.vx;
       offset_closest_object = current_offset;
     }
+  };
+
+  if( agent_grid.empty() )
+  {
+    for( const auto& [id, other_participant] : traffic_participant_set.participants )
+      check_obstacle( id, other_participant );
+    return { closest_distance, obstacle_speed, offset_closest_object };
+  }
+
+  // Only nearby participants get the route projection, candidates are visited in id order
+  std::vector<int> candidates;
+  agent_grid.query( current_state.x, current_state.y, obstacle_search_radius + agent_grid_padding, candidates );
+  for( int id : candidates )
+  {
+    auto it = traffic_participant_set.participants.find( id );
+    if( it != traffic_participant_set.participants.end() )
+      check_obstacle( id, it->second );
   }
 
   return { closest_distance, obstacle_speed, offset_closest_object };
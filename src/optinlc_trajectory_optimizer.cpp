@@ -17,9 +17,11 @@ namespace adore
 {
 namespace planner
 {
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryOptimizer::set_parameters( const std::map<std::string, double>& params )
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::set_parameters( const std::map<std::string, double>& params )
 {
+  auto& options                   = ocp_solver.options;
   options.intermediateIntegration = 3;
   options.OptiNLC_ACC             = 1e-4;
   options.maxNumberOfIteration    = 500;
@@ -31,6 +33,8 @@ OptiNLCTrajectoryOptimizer::set_parameters( const std::map<std::string, double>&
 
   for( const auto& [name, value] : params )
   {
+    if( ocp_solver.set_parameter( name, value ) )
+      continue;
     if( name == "intermediate_integration" )
       options.intermediateIntegration = static_cast<int>( value );
     if( name == "max_iterations" )
@@ -41,186 +45,307 @@ OptiNLCTrajectoryOptimizer::set_parameters( const std::map<std::string, double>&
       options.OptiNLC_ACC = value;
     if( name == "time_limit" )
       options.OptiNLC_time_limit = value;
+    if( name == "verbose" )
+      trace.set_echo( value != 0.0 );
   }
   options.OSQP_verbose = false;
   options.timeStep     = sim_time / control_points;
+  ocp_solver.configure();
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryOptimizer::setup_constraints(
-  OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-              OptiNLCTrajectoryOptimizer::control_points>& ocp )
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::setup_constraints( OptiNLC_OCP<Scalar, input_size, state_size, 0, control_points>& ocp )
 {
 
-  // Define a simple input update method
-  ocp.setInputUpdate( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& input, double, void* ) {
-    VECTOR<double, input_size> update_input = { input[DELTA], input[ACC] };
-    return update_input;
+  // Input guess of the solve, the shifted previous steering angles and accelerations when warm started
+  ocp.setInputUpdate( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& input, Scalar time, void* ) {
+    return ocp_solver.seeded_input( input, time );
   } );
 
   // State Constraints
-  ocp.setUpdateStateLowerBounds( [&]( const VECTOR<double, OptiNLCTrajectoryOptimizer::state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, OptiNLCTrajectoryOptimizer::state_size> state_constraints;
-    state_constraints.setConstant( -std::numeric_limits<double>::infinity() );
+  ocp.setUpdateStateLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, state_size> state_constraints;
+    state_constraints.setConstant( -std::numeric_limits<Scalar>::infinity() );
     return state_constraints;
   } );
 
-  ocp.setUpdateStateUpperBounds( [&]( const VECTOR<double, OptiNLCTrajectoryOptimizer::state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, OptiNLCTrajectoryOptimizer::state_size> state_constraints;
-    state_constraints.setConstant( std::numeric_limits<double>::infinity() );
+  ocp.setUpdateStateUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, state_size> state_constraints;
+    state_constraints.setConstant( std::numeric_limits<Scalar>::infinity() );
     return state_constraints;
   } );
 
   // Input Constraints
-  ocp.setUpdateInputLowerBounds( [&]( const VECTOR<double, OptiNLCTrajectoryOptimizer::state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, input_size> input_constraints;
+  ocp.setUpdateInputLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, input_size> input_constraints;
     input_constraints[0] = -limits.max_steering_angle;
     input_constraints[1] = limits.min_acceleration;
     return input_constraints;
   } );
 
-  ocp.setUpdateInputUpperBounds( [&]( const VECTOR<double, OptiNLCTrajectoryOptimizer::state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, input_size> input_constraints;
+  ocp.setUpdateInputUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, input_size> input_constraints;
     input_constraints[0] = limits.max_steering_angle;
     input_constraints[1] = limits.max_acceleration;
     return input_constraints;
   } );
 
   // Define a functions constraints method
-  ocp.setUpdateFunctionConstraints( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
+  ocp.setUpdateFunctionConstraints( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
     functions_constraint.setConstant( 0.0 );
     return functions_constraint;
   } );
 
-  ocp.setUpdateFunctionConstraintsLowerBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
-    functions_constraint.setConstant( -std::numeric_limits<double>::infinity() );
+  ocp.setUpdateFunctionConstraintsLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
+    functions_constraint.setConstant( -std::numeric_limits<Scalar>::infinity() );
     return functions_constraint;
   } );
 
-  ocp.setUpdateFunctionConstraintsUpperBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
-    functions_constraint.setConstant( std::numeric_limits<double>::infinity() );
+  ocp.setUpdateFunctionConstraintsUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
+    functions_constraint.setConstant( std::numeric_limits<Scalar>::infinity() );
     return functions_constraint;
   } );
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryOptimizer::setup_objective_function(
-  OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-              OptiNLCTrajectoryOptimizer::control_points>& ocp )
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::setup_objective_function( OptiNLC_OCP<Scalar, input_size, state_size, 0, control_points>& ocp )
 {
-  ocp.setObjectiveFunction(
-    [&]( const VECTOR<double, OptiNLCTrajectoryOptimizer::state_size>& state, const VECTOR<double, input_size>&, double ) {
-      return state[L]; // Minimize the cost function `L`
-    } );
+  ocp.setObjectiveFunction( [&]( const VECTOR<Scalar, state_size>& state, const VECTOR<Scalar, input_size>&, Scalar ) {
+    return state[L]; // Minimize the cost function `L`
+  } );
 }
 
 // Public method to get the next vehicle command based onOptiNLCTrajectoryOptimizer::::Trajectory
+template<int ControlPoints, int HorizonMs, typename Precision>
 dynamics::Trajectory
-OptiNLCTrajectoryOptimizer::plan_trajectory( const dynamics::Trajectory&          reference_trajectory,
-                                             const dynamics::VehicleStateDynamic& current_state )
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::plan_trajectory( const dynamics::Trajectory&          reference_trajectory,
+                                                                                  const dynamics::VehicleStateDynamic& current_state )
 {
-  auto start_time = std::chrono::high_resolution_clock::now();
-
-  // Initial state and input
-  VECTOR<double, OptiNLCTrajectoryOptimizer::input_size> initial_input = { current_state.steering_angle, 0.25 };
-  VECTOR<double, OptiNLCTrajectoryOptimizer::state_size> initial_state = { current_state.x, current_state.y, current_state.yaw_angle,
-                                                                           current_state.vx, 0.0 };
-
-  // Create an MPC problem (OCP)
-  OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-              OptiNLCTrajectoryOptimizer::control_points>
-    ocp( &options );
-
-  // Set up dynamic model, objective, and constraints
-  setup_dynamic_model( ocp, reference_trajectory );
+  dynamics::Trajectory trajectory;
+  plan_trajectory_into( trajectory, reference_trajectory, current_state );
+  return trajectory;
+}
 
-  setup_objective_function( ocp );
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::plan_trajectory_into( dynamics::Trajectory&                trajectory,
+                                                                                       const dynamics::Trajectory&          reference_trajectory,
+                                                                                       const dynamics::VehicleStateDynamic& current_state )
+{
+  StageClock clock;
+  last_stats = PlannerStats();
 
-  setup_constraints( ocp );
+  // Initial state and input
+  origin_x    = Precision::local_frame ? current_state.x : 0.0;
+  origin_y    = Precision::local_frame ? current_state.y : 0.0;
+  origin_time = Precision::local_frame ? current_state.time : 0.0;
+
+  VECTOR<Scalar, input_size> initial_input = { static_cast<Scalar>( current_state.steering_angle ), static_cast<Scalar>( 0.25 ) };
+  VECTOR<Scalar, state_size> initial_state = { static_cast<Scalar>( current_state.x - origin_x ),
+                                               static_cast<Scalar>( current_state.y - origin_y ),
+                                               static_cast<Scalar>( current_state.yaw_angle ),
+                                               static_cast<Scalar>( current_state.vx ),
+                                               0 };
+
+  if( ocp_solver.seed( current_state.time, current_state.time - origin_time ) )
+    initial_input = ocp_solver.warm_start.inputs[0];
+  else if( ocp_solver.seeding_enabled() )
+    trace.push( TraceEvent::warm_start_unavailable );
 
   // Solve the MPC problem
-  OptiNLC_Solver<double, input_size, state_size, 0, control_points> solver( ocp );
+  auto& solver = ocp_solver.get( [&]( auto& ocp ) {
+    setup_dynamic_model( ocp );
+    setup_objective_function( ocp );
+    setup_constraints( ocp );
+  } );
+  last_stats.ocp_setup_time = clock.lap();
+
+  sample_reference( reference_trajectory, current_state.time );
+  last_stats.route_preprocessing_time = clock.lap();
 
-  solver.solve( current_state.time, initial_state, initial_input );
+  solver.solve( static_cast<Scalar>( current_state.time - origin_time ), initial_state, initial_input );
+  last_stats.solve_time = clock.lap();
+  ocp_solver.report( last_stats.solve, last_stats.solve_time );
 
-  auto opt_x = solver.get_optimal_states();
+  auto opt_x            = solver.get_optimal_states();
+  auto opt_u            = solver.get_optimal_inputs();
+  last_stats.final_cost = solver.get_final_objective_function();
+  if( ocp_solver.seeding_enabled() && is_solution_valid( opt_u, last_stats.final_cost ) )
+    ocp_solver.store( opt_x, opt_u, current_state.time );
 
-  dynamics::Trajectory planned_trajectory;
+  trajectory.states.clear();
+  trajectory.states.reserve( control_points );
   for( int i = 0; i < control_points; i++ )
   {
     dynamics::VehicleStateDynamic state;
-    state.x         = opt_x[i * state_size + X];
-    state.y         = opt_x[i * state_size + Y];
+    state.x         = origin_x + opt_x[i * state_size + X];
+    state.y         = origin_y + opt_x[i * state_size + Y];
     state.yaw_angle = opt_x[i * state_size + PSI];
     state.vx        = opt_x[i * state_size + V];
-    state.time      = current_state.time + i * options.timeStep;
-    planned_trajectory.states.push_back( state );
+    state.time      = current_state.time + i * ocp_solver.options.timeStep;
+    trajectory.states.push_back( state );
   }
 
-  // Calculate time taken
-  auto                          end_time        = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> elapsed_seconds = end_time - start_time;
+  last_stats.conversion_time = clock.lap();
+  last_stats.total_time      = clock.total();
+}
 
-  return planned_trajectory;
+template<int ControlPoints, int HorizonMs, typename Precision>
+template<typename InputVector>
+bool
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::is_solution_valid( const InputVector& opt_u, double final_cost ) const
+{
+  if( !std::isfinite( final_cost ) )
+    return false;
+  constexpr double tolerance = 1e-3;
+  for( size_t i = 0; i + input_size <= opt_u.size(); i += input_size )
+  {
+    double delta = opt_u[i + DELTA];
+    double acc   = opt_u[i + ACC];
+    if( !std::isfinite( delta ) || !std::isfinite( acc ) )
+      return false;
+    if( std::abs( delta ) > limits.max_steering_angle + tolerance )
+      return false;
+    if( acc < limits.min_acceleration - tolerance || acc > limits.max_acceleration + tolerance )
+      return false;
+  }
+  return true;
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryOptimizer::setup_dynamic_model(
-  OptiNLC_OCP<double, OptiNLCTrajectoryOptimizer::input_size, OptiNLCTrajectoryOptimizer::state_size, 0,
-              OptiNLCTrajectoryOptimizer::control_points>& ocp,
-  const dynamics::Trajectory&                              trajectory )
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::setup_dynamic_model( OptiNLC_OCP<Scalar, input_size, state_size, 0, control_points>& ocp )
 {
-  ocp.setDynamicModel( [&]( const VECTOR<double, OptiNLCTrajectoryOptimizer::state_size>& state,
-                            const VECTOR<double, OptiNLCTrajectoryOptimizer::input_size>& input,
-                            VECTOR<double, OptiNLCTrajectoryOptimizer::state_size>& derivative, double current_time, void* ) {
+  ocp.setDynamicModel( [&]( const VECTOR<Scalar, state_size>& state, const VECTOR<Scalar, input_size>& input,
+                            VECTOR<Scalar, state_size>& derivative, Scalar current_time, void* ) {
+    last_stats.model_evaluations++;
     const double wheelbase = 2.69; // wheelbase, can be tuned based on your vehicle
 
     // Dynamic model equations
-    derivative[X]   = state[V] * cos( state[PSI] );               // X derivative (velocity * cos(psi))
-    derivative[Y]   = state[V] * sin( state[PSI] );               // Y derivative (velocity * sin(psi))
-    derivative[PSI] = state[V] * tan( input[DELTA] ) / wheelbase; // PSI derivative (steering angle / wheelbase)
-    derivative[V]   = input[ACC];                                 // Velocity derivative (acceleration)
+    derivative[X]   = state[V] * std::cos( state[PSI] );                                      // X derivative (velocity * cos(psi))
+    derivative[Y]   = state[V] * std::sin( state[PSI] );                                      // Y derivative (velocity * sin(psi))
+    derivative[PSI] = state[V] * std::tan( input[DELTA] ) / static_cast<Scalar>( wheelbase ); // PSI derivative (steering angle / wheelbase)
+    derivative[V]   = input[ACC];                                                             // Velocity derivative (acceleration)
 
     // Reference trajectory point at current time
-    auto reference_point = trajectory.get_state_at_time( current_time );
+    ReferenceSample reference_point = get_reference_sample( current_time );
 
     // Position error terms
-    double dx = state[X] - reference_point.x;
-    double dy = state[Y] - reference_point.y;
-    double dv = state[V] - reference_point.vx;
+    Evaluation dx = state[X] - static_cast<Evaluation>( reference_point.x );
+    Evaluation dy = state[Y] - static_cast<Evaluation>( reference_point.y );
+    Evaluation dv = state[V] - static_cast<Evaluation>( reference_point.vx );
 
     // Calculate longitudinal and lateral errors relative to the vehicle's heading
-    double cos_yaw = cos( reference_point.yaw_angle );
-    double sin_yaw = sin( reference_point.yaw_angle );
+    Evaluation cos_yaw = reference_point.cos_yaw;
+    Evaluation sin_yaw = reference_point.sin_yaw;
 
-    double longitudinal_cost  = dx * cos_yaw + dy * sin_yaw;
-    longitudinal_cost        *= longitudinal_cost * longitudinal_weight;
+    Evaluation longitudinal_cost  = dx * cos_yaw + dy * sin_yaw;
+    longitudinal_cost            *= longitudinal_cost * longitudinal_weight;
 
-    double lateral_cost  = -dx * sin_yaw + dy * cos_yaw;
-    lateral_cost        *= lateral_cost * lateral_weight;
+    Evaluation lateral_cost  = -dx * sin_yaw + dy * cos_yaw;
+    lateral_cost            *= lateral_cost * lateral_weight;
 
 
-    double velocity_cost = dv * dv * velocity_weight;
+    Evaluation velocity_cost = dv * dv * velocity_weight;
 
     // Heading error term
-    double heading_cost  = adore::math::normalize_angle( reference_point.yaw_angle - state[PSI] );
-    heading_cost        *= heading_cost * heading_weight;
+    Evaluation heading_cost  = adore::math::normalize_angle( reference_point.yaw - state[PSI] );
+    heading_cost            *= heading_cost * heading_weight;
 
     // Steering input cost
-    double steering_cost = input[DELTA] * input[DELTA] * steering_weight;
+    Evaluation steering_cost = input[DELTA] * input[DELTA] * steering_weight;
 
     // Total cost derivative
-    derivative[L] = longitudinal_cost + lateral_cost + heading_cost + steering_cost + velocity_cost;
+    derivative[L] = static_cast<Scalar>( longitudinal_cost + lateral_cost + heading_cost + steering_cost + velocity_cost );
   } );
 }
 
-OptiNLCTrajectoryOptimizer::OptiNLCTrajectoryOptimizer()
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::sample_reference( const dynamics::Trajectory& reference_trajectory, double start_time )
+{
+  int    intermediate_steps = std::max( ocp_solver.options.intermediateIntegration, 1 );
+  size_t number_of_samples  = static_cast<size_t>( control_points * intermediate_steps + 1 );
+
+  sampled_reference.start_time  = start_time - origin_time;
+  sampled_reference.sample_time = ocp_solver.options.timeStep / intermediate_steps;
+  sampled_reference.x.resize( number_of_samples );
+  sampled_reference.y.resize( number_of_samples );
+  sampled_reference.yaw.resize( number_of_samples );
+  sampled_reference.vx.resize( number_of_samples );
+  sampled_reference.cos_yaw.resize( number_of_samples );
+  sampled_reference.sin_yaw.resize( number_of_samples );
+
+  for( size_t i = 0; i < number_of_samples; i++ )
+  {
+    auto reference_point         = reference_trajectory.get_state_at_time( start_time + i * sampled_reference.sample_time );
+    sampled_reference.x[i]       = reference_point.x - origin_x;
+    sampled_reference.y[i]       = reference_point.y - origin_y;
+    sampled_reference.yaw[i]     = reference_point.yaw_angle;
+    sampled_reference.vx[i]      = reference_point.vx;
+    sampled_reference.cos_yaw[i] = cos( reference_point.yaw_angle );
+    sampled_reference.sin_yaw[i] = sin( reference_point.yaw_angle );
+  }
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+typename OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::ReferenceSample
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::get_reference_sample( double time ) const
 {
-  options.setDefaults();
+  size_t last_index = sampled_reference.x.size() - 1;
+  double position   = std::max( ( time - sampled_reference.start_time ) / sampled_reference.sample_time, 0.0 );
+  size_t index      = std::min( static_cast<size_t>( position ), last_index );
+
+  ReferenceSample sample;
+  sample.x       = sampled_reference.x[index];
+  sample.y       = sampled_reference.y[index];
+  sample.yaw     = sampled_reference.yaw[index];
+  sample.vx      = sampled_reference.vx[index];
+  sample.cos_yaw = sampled_reference.cos_yaw[index];
+  sample.sin_yaw = sampled_reference.sin_yaw[index];
+  if( index == last_index )
+  {
+    return sample;
+  }
+
+  // Linear interpolation between the grid points, needed for intermediate integration stages
+  double factor   = position - index;
+  sample.x       += factor * ( sampled_reference.x[index + 1] - sample.x );
+  sample.y       += factor * ( sampled_reference.y[index + 1] - sample.y );
+  sample.yaw     += factor * adore::math::normalize_angle( sampled_reference.yaw[index + 1] - sample.yaw );
+  sample.vx      += factor * ( sampled_reference.vx[index + 1] - sample.vx );
+  sample.cos_yaw += factor * ( sampled_reference.cos_yaw[index + 1] - sample.cos_yaw );
+  sample.sin_yaw += factor * ( sampled_reference.sin_yaw[index + 1] - sample.sin_yaw );
+  return sample;
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::OptiNLCTrajectoryOptimizerT()
+{
+  ocp_solver.options.setDefaults();
   set_parameters( {} );
 }
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+OptiNLCTrajectoryOptimizerT<ControlPoints, HorizonMs, Precision>::set_cycle_budget( double cycle_budget )
+{
+  ocp_solver.set_cycle_budget( cycle_budget );
+}
+
+// Horizon variants, see the aliases in the header
+template class OptiNLCTrajectoryOptimizerT<20, 2000>;
+template class OptiNLCTrajectoryOptimizerT<30, 3000>;
+template class OptiNLCTrajectoryOptimizerT<40, 4000>;
+
+// Float solver variants, see planner_precision.hpp
+template class OptiNLCTrajectoryOptimizerT<30, 3000, FloatSolverPrecision>;
+template class OptiNLCTrajectoryOptimizerT<30, 3000, SinglePrecision>;
+
 } // namespace planner
 } // namespace adore
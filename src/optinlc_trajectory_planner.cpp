@@ -18,9 +18,11 @@ namespace adore
 namespace planner
 {
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryPlanner::set_parameters( const std::map<std::string, double>& params )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::set_parameters( const std::map<std::string, double>& params )
 {
+  auto& options                   = ocp_solver.options;
   options.intermediateIntegration = 3;
   options.OptiNLC_ACC             = 1e-3;
   options.maxNumberOfIteration    = 500;
@@ -33,6 +35,8 @@ OptiNLCTrajectoryPlanner::set_parameters( const std::map<std::string, double>& p
 
   for( const auto& [name, value] : params )
   {
+    if( ocp_solver.set_parameter( name, value ) )
+      continue;
     if( name == "wheel_base" )
       wheelbase = value;
     if( name == "lateral_weight" )
@@ -43,32 +47,49 @@ OptiNLCTrajectoryPlanner::set_parameters( const std::map<std::string, double>& p
       maximum_velocity = value;
     if( name == "min_distance_to_vehicle_ahead" )
       min_distance_to_vehicle_ahead = value;
+    if( name == "incremental_route" )
+      use_incremental_route = value != 0.0;
+    if( name == "route_window_margin" )
+      route_window_margin = value;
+    if( name == "curvature_smoothing_window" )
+      curvature_smoothing_window = static_cast<int>( value );
+    if( name == "predicted_obstacles" )
+      use_predicted_obstacles = value != 0.0;
+    if( name == "prediction_horizon" )
+      prediction_horizon = std::max( static_cast<int>( value ), 0 );
+    if( name == "obstacle_search_distance" )
+      obstacle_search_distance = value;
+    if( name == "corridor_margin" )
+      corridor_margin = value;
+    if( name == "verbose" )
+      trace.set_echo( value != 0.0 );
   }
+  ocp_solver.configure();
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryPlanner::setup_constraints( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::setup_constraints( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp )
 {
 
-  // Define a simple input update method
-  ocp.setInputUpdate( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& input, double, void* ) {
-    VECTOR<double, input_size> update_input = { input[dDELTA] };
-    return update_input;
+  // Input guess of the solve, the shifted previous steering rates when warm started
+  ocp.setInputUpdate( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& input, Scalar time, void* ) {
+    return ocp_solver.seeded_input( input, time );
   } );
 
   // State Constraints
-  ocp.setUpdateStateLowerBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, state_size> state_constraints;
-    state_constraints.setConstant( -std::numeric_limits<double>::infinity() );
+  ocp.setUpdateStateLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, state_size> state_constraints;
+    state_constraints.setConstant( -std::numeric_limits<Scalar>::infinity() );
     state_constraints[V]      = max_reverse_speed;
     state_constraints[DELTA]  = -limits.max_steering_angle;
     //state_constraints[dDELTA] = -max_steering_velocity;
     return state_constraints;
   } );
 
-  ocp.setUpdateStateUpperBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, state_size> state_constraints;
-    state_constraints.setConstant( std::numeric_limits<double>::infinity() );
+  ocp.setUpdateStateUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, state_size> state_constraints;
+    state_constraints.setConstant( std::numeric_limits<Scalar>::infinity() );
     state_constraints[V]      = max_forward_speed;
     state_constraints[DELTA]  = limits.max_steering_angle;
     //state_constraints[dDELTA] = max_steering_velocity;
@@ -76,95 +97,144 @@ OptiNLCTrajectoryPlanner::setup_constraints( OptiNLC_OCP<double, input_size, sta
   } );
 
   // Input Constraints
-  ocp.setUpdateInputLowerBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, input_size> input_constraints;
+  ocp.setUpdateInputLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, input_size> input_constraints;
     input_constraints[dDELTA] = -max_steering_velocity;
     return input_constraints;
   } );
 
-  ocp.setUpdateInputUpperBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, input_size> input_constraints;
+  ocp.setUpdateInputUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, input_size> input_constraints;
     input_constraints[dDELTA] = max_steering_velocity;
     return input_constraints;
   } );
 
   // Define a functions constraints method
-  ocp.setUpdateFunctionConstraints( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
+  ocp.setUpdateFunctionConstraints( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
     functions_constraint.setConstant( 0.0 );
     return functions_constraint;
   } );
 
-  ocp.setUpdateFunctionConstraintsLowerBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
-    functions_constraint.setConstant( -std::numeric_limits<double>::infinity() );
+  ocp.setUpdateFunctionConstraintsLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
+    functions_constraint.setConstant( -std::numeric_limits<Scalar>::infinity() );
     return functions_constraint;
   } );
 
-  ocp.setUpdateFunctionConstraintsUpperBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
-    functions_constraint.setConstant( std::numeric_limits<double>::infinity() );
+  ocp.setUpdateFunctionConstraintsUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
+    functions_constraint.setConstant( std::numeric_limits<Scalar>::infinity() );
     return functions_constraint;
   } );
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryPlanner::setup_objective_function( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::setup_objective_function( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp )
 {
-  ocp.setObjectiveFunction( [&]( const VECTOR<double, state_size>& state, const VECTOR<double, input_size>&, double ) {
+  ocp.setObjectiveFunction( [&]( const VECTOR<Scalar, state_size>& state, const VECTOR<Scalar, input_size>&, Scalar ) {
     return state[L]; // Minimize the cost function `L`
   } );
 }
 
 // Public method to get the next vehicle command based on OptiNLCTrajectoryPlanner
+template<int ControlPoints, int HorizonMs, typename Precision>
 dynamics::Trajectory
-OptiNLCTrajectoryPlanner::plan_trajectory( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
-                                           const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::plan_trajectory( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                                                                                const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants )
+{
+  return plan_trajectory_ref( latest_route, current_state, latest_map, traffic_participants );
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::plan_trajectory_into( dynamics::Trajectory& trajectory, const map::Route& latest_route,
+                                                                                     const dynamics::VehicleStateDynamic&   current_state,
+                                                                                     const map::Map&                        latest_map,
+                                                                                     const dynamics::TrafficParticipantSet& traffic_participants )
+{
+  trajectory = plan_trajectory_ref( latest_route, current_state, latest_map, traffic_participants );
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+const dynamics::Trajectory&
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::plan_trajectory_ref( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                                                                                    const map::Map&                        latest_map,
+                                                                                    const dynamics::TrafficParticipantSet& traffic_participants )
 {
-  route_to_piecewise_polynomial reference_route = setup_optimizer_parameters_using_route( latest_route, current_state );
-  auto                          start_time      = std::chrono::high_resolution_clock::now();
+  StageClock            clock;
+  dynamics::Trajectory& trajectory = candidate_trajectory;
+  last_stats = PlannerStats();
+
+  lane_cache->update( latest_map );
+
+  ego_route_valid = !latest_route.center_lane.empty();
+  if( ego_route_valid )
+  {
+    ego_route_projection = project_onto_route( latest_route, current_state, ego_route_hint );
+    ego_route_s          = ego_route_projection.s;
+  }
+
+  const route_to_piecewise_polynomial& reference_route = setup_optimizer_parameters_using_route( latest_route );
 
   // Initial state and input
   if (current_state.vx < 0.25)
   {
     steering_rate = 0.0;
   }
-  VECTOR<double, input_size> initial_input = { current_state.steering_rate };
-  VECTOR<double, state_size> initial_state = {
-    current_state.x, current_state.y, current_state.yaw_angle, current_state.vx, current_state.steering_angle, 0.0, 0.0
-  };
-
-  // Create an MPC problem (OCP)
-  OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points> ocp( &options );
+  origin_x    = Precision::local_frame ? current_state.x : 0.0;
+  origin_y    = Precision::local_frame ? current_state.y : 0.0;
+  origin_time = Precision::local_frame ? current_state.time : 0.0;
+
+  VECTOR<Scalar, input_size> initial_input = { static_cast<Scalar>( current_state.steering_rate ) };
+  VECTOR<Scalar, state_size> initial_state = { static_cast<Scalar>( current_state.x - origin_x ),
+                                               static_cast<Scalar>( current_state.y - origin_y ),
+                                               static_cast<Scalar>( current_state.yaw_angle ),
+                                               static_cast<Scalar>( current_state.vx ),
+                                               static_cast<Scalar>( current_state.steering_angle ),
+                                               0,
+                                               0 };
 
   // Set up reference route
   setup_reference_route( reference_route );
-  if( route_x.breaks.size() < 1 )
+  last_stats.route_preprocessing_time = clock.lap();
+  if( reference_route.x.breaks.size() < 1 )
   {
-    dynamics::Trajectory empty_trajectory;
-    std::cerr << "end of route or invalid route received" << std::endl;
-    return empty_trajectory;
+    trajectory.states.clear();
+    ocp_solver.warm_start.reset();
+    trace.push( TraceEvent::invalid_route );
+    last_stats.total_time = clock.total();
+    return trajectory;
   }
 
+  if( ocp_solver.seed( current_state.time, current_state.time - origin_time ) )
+    initial_input = ocp_solver.warm_start.inputs[0];
+  else if( ocp_solver.seeding_enabled() )
+    trace.push( TraceEvent::warm_start_unavailable );
+  last_stats.ocp_setup_time = clock.lap();
+
   // Set up reference velocity
   setup_reference_velocity( latest_route, current_state, latest_map, traffic_participants );
-
-  // Set up dynamic model, objective, and constraints
-  setup_dynamic_model( ocp );
-
-  setup_objective_function( ocp );
-
-  setup_constraints( ocp );
+  last_stats.reference_velocity_time = clock.lap();
 
   // Solve the MPC problem
-  OptiNLC_Solver<double, input_size, state_size, constraints_size, control_points> solver( ocp );
+  auto& solver = ocp_solver.get( [&]( auto& ocp ) {
+    setup_dynamic_model( ocp );
+    setup_objective_function( ocp );
+    setup_constraints( ocp );
+  } );
+  last_stats.ocp_setup_time += clock.lap();
 
-  solver.solve( current_state.time, initial_state, initial_input );
+  solver.solve( static_cast<Scalar>( current_state.time - origin_time ), initial_state, initial_input );
+  last_stats.solve_time = clock.lap();
+  ocp_solver.report( last_stats.solve, last_stats.solve_time );
 
   auto   opt_x                   = solver.get_optimal_states();
   auto   opt_u                   = solver.get_optimal_inputs();
   auto   time                    = solver.getTime();
   double last_objective_function = solver.get_final_objective_function();
+  last_stats.final_cost          = last_objective_function;
 
   bad_condition = false;
   if( bad_counter > 4 )
@@ -182,51 +252,56 @@ OptiNLCTrajectoryPlanner::plan_trajectory( const map::Route& latest_route, const
     }
   }
 
-  dynamics::Trajectory planned_trajectory;
+  trajectory.states.clear();
+  trajectory.states.reserve( control_points );
   for( size_t i = 0; i < control_points; i++ )
   {
     dynamics::VehicleStateDynamic state;
-    state.x              = opt_x[i * state_size + X];
-    state.y              = opt_x[i * state_size + Y];
+    state.x              = origin_x + opt_x[i * state_size + X];
+    state.y              = origin_y + opt_x[i * state_size + Y];
     state.yaw_angle      = opt_x[i * state_size + PSI];
     state.vx             = opt_x[i * state_size + V];
     state.steering_angle = opt_x[i * state_size + DELTA];
     state.steering_rate  = opt_u[i * input_size + dDELTA];
-    state.time           = time[i];
+    state.time           = origin_time + time[i];
     if( i < control_points - 1 )
     {
-      state.yaw_rate = ( opt_x[( i + 1 ) * state_size + PSI] - opt_x[i * state_size + PSI] ) / options.timeStep;
-      state.ax       = ( opt_x[( i + 1 ) * state_size + V] - opt_x[i * state_size + V] ) / options.timeStep;
+      state.yaw_rate = ( opt_x[( i + 1 ) * state_size + PSI] - opt_x[i * state_size + PSI] ) / ocp_solver.options.timeStep;
+      state.ax       = ( opt_x[( i + 1 ) * state_size + V] - opt_x[i * state_size + V] ) / ocp_solver.options.timeStep;
     }
-    planned_trajectory.states.push_back( state );
+    trajectory.states.push_back( state );
   }
-  planned_trajectory.states[control_points - 1].yaw_rate = planned_trajectory.states[control_points - 2].yaw_rate;
-  planned_trajectory.states[control_points - 1].ax       = planned_trajectory.states[control_points - 2].ax;
+  trajectory.states[control_points - 1].yaw_rate = trajectory.states[control_points - 2].yaw_rate;
+  trajectory.states[control_points - 1].ax       = trajectory.states[control_points - 2].ax;
+
+  last_stats.conversion_time = clock.lap();
+  last_stats.total_time      = clock.total();
 
-  // Calculate time taken
-  auto                          end_time        = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> elapsed_seconds = end_time - start_time;
   // Log cost, time taken, and convergence status
   if( bad_condition == false && bad_counter < 5 || iteration == 0 )
   {
-    previous_trajectory = planned_trajectory;
-    bad_counter         = 0;
+    // The solution is kept by swapping buffers, the old buffer is refilled by the next call
+    std::swap( previous_trajectory, trajectory );
+    bad_counter = 0;
     iteration = 1;
-    steering_rate = planned_trajectory.states[1].steering_rate;
-    return planned_trajectory;
+    ocp_solver.store( opt_x, opt_u, current_state.time );
+    steering_rate = previous_trajectory.states[1].steering_rate;
   }
   else
   {
-    steering_rate = previous_trajectory.states[1].steering_rate;
-    return previous_trajectory;
+    last_stats.fallback = true;
+    steering_rate       = previous_trajectory.states[1].steering_rate;
   }
+  return previous_trajectory;
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryPlanner::setup_dynamic_model( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::setup_dynamic_model( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp )
 {
-  ocp.setDynamicModel( [&]( const VECTOR<double, state_size>& state, const VECTOR<double, input_size>& input,
-                            VECTOR<double, state_size>& derivative, double, void* ) {
+  ocp.setDynamicModel( [&]( const VECTOR<Scalar, state_size>& state, const VECTOR<Scalar, input_size>& input,
+                            VECTOR<Scalar, state_size>& derivative, Scalar, void* ) {
+    last_stats.model_evaluations++;
     if( reference_velocity - state[V] > 0 )
     {
       tau = 2.5; // Higher value for smooth acceleration
@@ -235,69 +310,96 @@ OptiNLCTrajectoryPlanner::setup_dynamic_model( OptiNLC_OCP<double, input_size, s
     {
       tau = 1.25; // Lower value for quick braking
     }
-    // Reference trajectory point at current progress
-    int    index             = pp.findIndex( state[S], route_x );
-    double reference_x       = pp.splineEvaluation( index, state[S], route_x );
-    double reference_y       = pp.splineEvaluation( index, state[S], route_y );
-    double reference_heading = pp.splineEvaluation( index, state[S], route_heading );
+    // Reference trajectory point at current progress, the spline is evaluated in double and moved into the OCP frame
+    ReferencePoint reference         = reference_path.evaluate( route_s_offset + state[S] );
+    Evaluation     reference_x       = reference.x - origin_x;
+    Evaluation     reference_y       = reference.y - origin_y;
+    Evaluation     reference_heading = reference.heading;
 
     // Dynamic model equations
-    derivative[X]      = state[V] * cos( state[PSI] );                      // X derivative (velocity * cos(psi))
-    derivative[Y]      = state[V] * sin( state[PSI] );                      // Y derivative (velocity * sin(psi))
-    derivative[PSI]    = state[V] * tan( state[DELTA] ) / wheelbase;        // PSI derivative (steering angle / wheelbase)
-    derivative[V]      = ( 1.0 / tau ) * ( reference_velocity - state[V] ); // Velocity derivative (first order)
-    derivative[DELTA]  = input[dDELTA];                                     // Steering angle derivative
-    derivative[S]      = state[V];                                          // Progress derivate (velocity)
+    derivative[X]      = state[V] * std::cos( state[PSI] );                                        // X derivative (velocity * cos(psi))
+    derivative[Y]      = state[V] * std::sin( state[PSI] );                                        // Y derivative (velocity * sin(psi))
+    derivative[PSI]    = state[V] * std::tan( state[DELTA] ) / static_cast<Scalar>( wheelbase );   // PSI derivative (steering angle / wheelbase)
+    derivative[V]      = static_cast<Scalar>( ( 1.0 / tau ) * ( reference_velocity - state[V] ) ); // Velocity derivative (first order)
+    derivative[DELTA]  = input[dDELTA];                                                            // Steering angle derivative
+    derivative[S]      = state[V];                                                                 // Progress derivate (velocity)
 
 
     // Position error terms
-    double dx = state[X] - reference_x;
-    double dy = state[Y] - reference_y;
+    Evaluation dx = state[X] - reference_x;
+    Evaluation dy = state[Y] - reference_y;
 
     // Calculate longitudinal and lateral errors relative to the vehicle's heading
-    double cos_yaw = cos( reference_heading );
-    double sin_yaw = sin( reference_heading );
+    Evaluation psi     = state[PSI];
+    Evaluation cos_yaw = std::cos( reference_heading );
+    Evaluation sin_yaw = std::sin( reference_heading );
 
-    double lateral_cost  = -dx * sin_yaw + dy * cos_yaw;
-    lateral_cost        *= lateral_cost * lateral_weight;
+    Evaluation lateral_cost  = -dx * sin_yaw + dy * cos_yaw;
+    lateral_cost            *= lateral_cost * lateral_weight;
 
     // Heading error term
-    double heading_cost  = atan2( -sin_yaw * cos( state[PSI] ) + cos_yaw * sin( state[PSI] ),
-                                  cos_yaw * cos( state[PSI] ) + sin_yaw * sin( state[PSI] ) );
-    heading_cost        *= heading_cost * heading_weight;
+    Evaluation heading_cost  = std::atan2( -sin_yaw * std::cos( psi ) + cos_yaw * std::sin( psi ),
+                                           cos_yaw * std::cos( psi ) + sin_yaw * std::sin( psi ) );
+    heading_cost            *= heading_cost * heading_weight;
 
     // Steering input cost
     // double steering_cost = state[DELTA] * state[DELTA] * steering_weight;
 
     // Total cost derivative
-    derivative[L] = lateral_cost + heading_cost;
+    derivative[L] = static_cast<Scalar>( lateral_cost + heading_cost );
   } );
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryPlanner::setup_reference_route( route_to_piecewise_polynomial& reference_route )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::setup_reference_route( const route_to_piecewise_polynomial& reference_route )
 {
-  route_x       = reference_route.x;
-  route_y       = reference_route.y;
-  route_heading = reference_route.heading;
+  reference_path.set_path( reference_route.x, reference_route.y, reference_route.heading );
 }
 
-OptiNLCTrajectoryPlanner::OptiNLCTrajectoryPlanner()
+template<int ControlPoints, int HorizonMs, typename Precision>
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::OptiNLCTrajectoryPlannerT()
 {
-  options.setDefaults();
+  ocp_solver.options.setDefaults();
   set_parameters( {} );
 }
 
-route_to_piecewise_polynomial
-OptiNLCTrajectoryPlanner::setup_optimizer_parameters_using_route( const adore::map::Route&             latest_route,
-                                                                  const dynamics::VehicleStateDynamic& current_state )
+template<int ControlPoints, int HorizonMs, typename Precision>
+bool
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::is_same_route( const RouteFingerprint& fingerprint ) const
+{
+  return route_window_cache.valid && fingerprint == route_window_cache.fingerprint;
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+const route_to_piecewise_polynomial&
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::setup_optimizer_parameters_using_route( const adore::map::Route& latest_route )
 {
   auto start_time = std::chrono::high_resolution_clock::now();
 
-  route_to_piecewise_polynomial route;
+  route_to_piecewise_polynomial& route = route_window_cache.route;
+  route_s_offset    = 0.0;
+  route_start_index = 0;
 
   double maximum_required_road_length = sim_time * max_forward_speed;
 
+  RouteFingerprint fingerprint;
+  if( use_incremental_route )
+    fingerprint = route_fingerprint( latest_route );
+
+  double state_s = ego_route_s;
+
+  // Reuse the fitted window while the route is unchanged and the window still covers the horizon
+  if( use_incremental_route && is_same_route( fingerprint ) && state_s >= route_window_cache.start_s
+      && state_s + maximum_required_road_length <= route_window_cache.end_s )
+  {
+    route_s_offset    = state_s - route_window_cache.start_s;
+    route_start_index = std::lower_bound( route_to_follow.s.begin(), route_to_follow.s.end(), route_s_offset ) - route_to_follow.s.begin();
+    return route;
+  }
+  route_window_cache.valid = false;
+  route                    = route_to_piecewise_polynomial();
+
   if( maximum_required_road_length < min_distance_in_route )
   {
     return route;
@@ -308,7 +410,11 @@ OptiNLCTrajectoryPlanner::setup_optimizer_parameters_using_route( const adore::m
     return route;
   }
 
-  double state_s = latest_route.get_s( current_state );
+  double window_length = maximum_required_road_length;
+  if( use_incremental_route )
+  {
+    window_length += route_window_margin;
+  }
 
   route_to_follow.s.clear();
   route_to_follow.x.clear();
@@ -318,12 +424,15 @@ OptiNLCTrajectoryPlanner::setup_optimizer_parameters_using_route( const adore::m
   std::vector<double> w;
 
   double previous_s = 0.0;
-  for( const auto& [s, point] : latest_route.center_lane )
+  bool   route_end  = true;
+  for( auto it = latest_route.center_lane.lower_bound( state_s ); it != latest_route.center_lane.end(); ++it )
   {
-    if( s < state_s )
-      continue;
-    if( s - state_s > maximum_required_road_length )
+    const auto& [s, point] = *it;
+    if( s - state_s > window_length )
+    {
+      route_end = false;
       break;
+    }
     double local_progress = s - state_s;
     if( local_progress - previous_s > 0.1 ) // adding points every 75 cm
     {
@@ -355,9 +464,17 @@ OptiNLCTrajectoryPlanner::setup_optimizer_parameters_using_route( const adore::m
     }
     route_to_follow.psi.push_back( std::atan2( dy[i], dx[i] ) );
   }
-  route_to_follow.psi[route_to_follow.s.size() - 1] = route_to_follow.psi[route_to_follow.s.size() - 2];
+  route_to_follow.psi.push_back( route_to_follow.psi.back() );
   route.heading = pp.CubicSplineSmoother( route_to_follow.s, route_to_follow.psi, w, heading_smoothing_factor );
 
+  if( use_incremental_route )
+  {
+    route_window_cache.valid       = true;
+    route_window_cache.fingerprint = fingerprint;
+    route_window_cache.start_s     = state_s;
+    route_window_cache.end_s       = route_end ? std::numeric_limits<double>::max() : state_s + route_to_follow.s.back();
+  }
+
   // Calculate time taken
   auto                          end_time        = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> elapsed_seconds = end_time - start_time;
@@ -365,80 +482,36 @@ OptiNLCTrajectoryPlanner::setup_optimizer_parameters_using_route( const adore::m
   return route;
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 std::vector<double>
-OptiNLCTrajectoryPlanner::compute_curvatures( const dynamics::VehicleStateDynamic& current_state )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::compute_curvatures( const dynamics::VehicleStateDynamic& current_state )
 {
-  int n          = pp.findIndex( lookahead_time * 5.0, route_x );
+  int n          = pp.findIndex( route_s_offset + lookahead_time * 5.0, route_window_cache.route.x ) - static_cast<int>( route_start_index );
   n              = std::max( n, safe_index );
-  std::vector<double> curvatures( n, 0.0 );
-
-  // Compute curvature using a larger window size for robustness against noise
-  if( route_to_follow.s.size() > n )
-  {
-    for( size_t i = 2; i < n - 2; ++i ) // Adjust the window size here
-    {
-      // Average positions in a larger window to reduce noise sensitivity
-      double x1 = ( route_to_follow.x[i - 2] + route_to_follow.x[i - 1] ) / 2.0;
-      double y1 = ( route_to_follow.y[i - 2] + route_to_follow.y[i - 1] ) / 2.0;
-      double x2 = route_to_follow.x[i];
-      double y2 = route_to_follow.y[i];
-      double x3 = ( route_to_follow.x[i + 1] + route_to_follow.x[i + 2] ) / 2.0;
-      double y3 = ( route_to_follow.y[i + 1] + route_to_follow.y[i + 2] ) / 2.0;
-
-      double kappa  = adore::math::compute_curvature( x1, y1, x2, y2, x3, y3 );
-      curvatures[i] = std::abs( kappa );
-    }
-  }
-
-  // Handle boundary points by copying neighboring values
-  if( n > 4 )
-  {
-    curvatures[0]     = curvatures[2];
-    curvatures[1]     = curvatures[2];
-    curvatures[n - 1] = curvatures[n - 3];
-    curvatures[n - 2] = curvatures[n - 3];
-  }
-  else
-  {
-    curvatures[0] = 0.0;
-    if( n > 1 )
-      curvatures[1] = 0.0;
-  }
+  std::vector<double> curvatures;
 
-  // Apply a simple moving average filter to smooth the computed curvatures
-  std::vector<double> smoothed_curvatures( n, 0.0 );
-  const int           smoothing_window = 3; // Adjust window size for desired smoothing level
-  for( size_t i = 0; i < n; ++i )
-  {
-    double sum   = 0.0;
-    int    count = 0;
-    for( int j = -smoothing_window; j <= smoothing_window; ++j )
-    {
-      int index = i + j;
-      if( index >= 0 && static_cast<size_t>( index ) < n )
-      {
-        sum += curvatures[index];
-        ++count;
-      }
-    }
-    smoothed_curvatures[i] = sum / count;
-  }
+  // Points of the route window ahead of the ego vehicle, no curvature if the window does not cover the lookahead
+  if( route_to_follow.s.size() <= route_start_index + n )
+    return std::vector<double>( n, 0.0 );
 
-  return smoothed_curvatures;
+  compute_smoothed_curvatures( route_to_follow.x.data() + route_start_index, route_to_follow.y.data() + route_start_index, n,
+                               curvature_smoothing_window, true, curvature_scratch, curvatures );
+  return curvatures;
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-OptiNLCTrajectoryPlanner::setup_reference_velocity( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
-                                                    const map::Map&                        latest_map,
-                                                    const dynamics::TrafficParticipantSet& traffic_participants )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::setup_reference_velocity( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                                                                                         const map::Map&                        latest_map,
+                                                                                         const dynamics::TrafficParticipantSet& traffic_participants )
 {
   reference_velocity = maximum_velocity;
-  int index          = pp.findIndex( lookahead_time * current_state.vx, route_x );
+  int index          = pp.findIndex( route_s_offset + lookahead_time * current_state.vx, route_window_cache.route.x ) - static_cast<int>( route_start_index );
   index              = std::max( index, safe_index );
 
   // Curvature calculation
   std::vector<double> curvature;
-  if( route_to_follow.s.size() > index + 2 )
+  if( route_to_follow.s.size() > route_start_index + index + 2 )
   {
     // for( int i = 0; i < index; i++ )
     // {
@@ -469,69 +542,184 @@ OptiNLCTrajectoryPlanner::setup_reference_velocity( const map::Route& latest_rou
     reference_velocity        = std::min( reference_velocity, curvature_velocity );
   }
 
-  double idm_velocity = calculate_idm_velocity( latest_route, current_state, latest_map, traffic_participants );
+  double idm_velocity = calculate_idm_velocity( latest_route, current_state, traffic_participants );
   reference_velocity  = std::min( reference_velocity, idm_velocity );
 
-  double min_dist = std::numeric_limits<double>::max();
-  auto   nearest  = latest_map.quadtree.get_nearest_point( current_state, min_dist );
+  // While the ego vehicle is within the route lane that lane is the one it drives on, the map is only searched off the route
+  std::optional<size_t> ego_lane_id;
+  if( ego_route_valid )
+  {
+    auto                  map_point = latest_route.get_map_point_at_s( ego_route_s );
+    const LaneAttributes& ego_lane  = lane_cache->resolve( map_point.parent_id );
+    double                offset    = math::distance_2d( current_state, ego_route_projection.pose );
+    if( ego_lane.lane && offset < ego_lane.lane->get_width( map_point.s ) / 2 )
+      ego_lane_id = map_point.parent_id;
+  }
+  if( !ego_lane_id )
+  {
+    double min_dist = std::numeric_limits<double>::max();
+    auto   nearest  = latest_map.quadtree.get_nearest_point( current_state, min_dist );
+    if( nearest )
+      ego_lane_id = nearest.value().parent_id;
+  }
 
-  if( nearest )
+  if( ego_lane_id )
   {
-    double current_route_point_max_speed = latest_map.get_lane_speed_limit( nearest.value().parent_id );
+    double current_route_point_max_speed = lane_cache->speed_limit( ego_lane_id.value() );
     reference_velocity                   = std::min( reference_velocity, current_route_point_max_speed );
   }
-  std::cerr << "reference velocity: " << reference_velocity << std::endl;
+  trace.push( TraceEvent::reference_velocity, reference_velocity );
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::update_route_corridor( const map::Route& latest_route, double state_s )
+{
+  route_corridor.min_x = std::numeric_limits<double>::max();
+  route_corridor.min_y = std::numeric_limits<double>::max();
+  route_corridor.max_x = std::numeric_limits<double>::lowest();
+  route_corridor.max_y = std::numeric_limits<double>::lowest();
+
+  auto it = latest_route.center_lane.lower_bound( state_s );
+  if( it != latest_route.center_lane.begin() )
+    --it;
+  for( ; it != latest_route.center_lane.end() && it->first <= state_s + obstacle_search_distance; ++it )
+  {
+    route_corridor.min_x = std::min( route_corridor.min_x, it->second.x );
+    route_corridor.max_x = std::max( route_corridor.max_x, it->second.x );
+    route_corridor.min_y = std::min( route_corridor.min_y, it->second.y );
+    route_corridor.max_y = std::max( route_corridor.max_y, it->second.y );
+  }
+  // Include the first point beyond the search distance so that the last segment is covered
+  if( it != latest_route.center_lane.end() )
+  {
+    route_corridor.min_x = std::min( route_corridor.min_x, it->second.x );
+    route_corridor.max_x = std::max( route_corridor.max_x, it->second.x );
+    route_corridor.min_y = std::min( route_corridor.min_y, it->second.y );
+    route_corridor.max_y = std::max( route_corridor.max_y, it->second.y );
+  }
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::predict_obstacle_candidates()
+{
+  const size_t candidate_count = obstacle_candidates.size();
+  const size_t horizon         = static_cast<size_t>( prediction_horizon );
+  predicted_x.resize( candidate_count * horizon );
+  predicted_y.resize( candidate_count * horizon );
+
+  for( size_t k = 0; k < candidate_count; k++ )
+  {
+    const auto& state  = obstacle_candidates[k]->state;
+    double      step_x = state.vx * dt * std::cos( state.yaw_angle );
+    double      step_y = state.vx * dt * std::sin( state.yaw_angle );
+    double*     out_x  = predicted_x.data() + k * horizon;
+    double*     out_y  = predicted_y.data() + k * horizon;
+    for( size_t i = 0; i < horizon; i++ )
+    {
+      out_x[i] = state.x + ( i + 1 ) * step_x;
+      out_y[i] = state.y + ( i + 1 ) * step_y;
+    }
+  }
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
 double
-OptiNLCTrajectoryPlanner::calculate_idm_velocity( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
-                                                  const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants )
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::calculate_idm_velocity( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                                                                                       const dynamics::TrafficParticipantSet& traffic_participants )
 {
   double distance_to_object_min     = std::numeric_limits<double>::max();
   double distance_to_maintain_ahead = min_distance_to_vehicle_ahead + wheelbase / 2;
   double idm_velocity               = maximum_velocity;
-  double state_s                    = latest_route.get_s( current_state );
+  double state_s                    = ego_route_s;
+
+  // Cheap box test first, only participants near the route ahead are projected onto it
+  bool use_corridor = obstacle_search_distance > 0.0;
+  if( use_corridor )
+    update_route_corridor( latest_route, state_s );
+
+  obstacle_candidates.clear();
+  obstacle_candidate_ids.clear();
+  auto add_candidate = [&]( int id, const dynamics::TrafficParticipant& participant ) {
+    if( ignored_participant && id == *ignored_participant )
+      return;
+    double reach = use_predicted_obstacles ? std::abs( participant.state.vx ) * dt * prediction_horizon : 0.0;
+    if( use_corridor && !route_corridor.contains( participant.state.x, participant.state.y, corridor_margin + reach ) )
+      return;
+    obstacle_candidates.push_back( &participant );
+    obstacle_candidate_ids.push_back( id );
+  };
+  if( participant_filter )
+  {
+    for( int id : *participant_filter )
+    {
+      auto it = traffic_participants.participants.find( id );
+      if( it != traffic_participants.participants.end() )
+        add_candidate( id, it->second );
+    }
+  }
+  else
+  {
+    for( const auto& [id, participant] : traffic_participants.participants )
+      add_candidate( id, participant );
+  }
+  if( use_predicted_obstacles )
+    predict_obstacle_candidates();
+
+  auto distance_along_route = [&]( const math::Point2d& position, RouteProjectionHint& hint ) {
+    auto   projection  = project_onto_route( latest_route, position, hint );
+    double offset      = math::distance_2d( position, projection.pose );
+    auto   map_point   = latest_route.get_map_point_at_s( projection.s );
+    bool   within_lane = offset < ( lane_cache->lane( map_point.parent_id ).get_width( map_point.s ) / 2 );
+    return within_lane ? projection.s - state_s : std::numeric_limits<double>::max();
+  };
 
-  for( const auto& [id, participant] : traffic_participants.participants )
+  for( size_t k = 0; k < obstacle_candidates.size(); k++ )
   {
+    const auto&   participant = *obstacle_candidates[k];
+    auto&         hint        = participant_route_hints[obstacle_candidate_ids[k]];
     math::Point2d object_position;
-    object_position.x                        = participant.state.x;
-    object_position.y                        = participant.state.y;
-    math::Point2d object_position_predicted  = object_position;
-    double        distance_to_object         = latest_route.get_s( object_position );
-    double        offset                     = math::distance_2d( object_position, latest_route.get_pose_at_s( distance_to_object ) );
-    auto          map_point                  = latest_route.get_map_point_at_s( distance_to_object );
-    bool          within_lane                = offset < (latest_map.lanes.at( map_point.parent_id )->get_width( map_point.s ) / 2);
-    distance_to_object                      -= state_s;
-    if( !within_lane )
+    object_position.x         = participant.state.x;
+    object_position.y         = participant.state.y;
+    double distance_to_object = distance_along_route( object_position, hint );
+
+    // Participants predicted to enter the lane ahead count with the distance of their predicted position
+    if( use_predicted_obstacles )
     {
-      distance_to_object = std::numeric_limits<double>::max();
+      RouteProjectionHint prediction_hint = hint;
+      for( int i = 0; i < prediction_horizon; i++ )
+      {
+        math::Point2d object_position_predicted;
+        object_position_predicted.x = predicted_x[k * prediction_horizon + i];
+        object_position_predicted.y = predicted_y[k * prediction_horizon + i];
+        if( use_corridor && !route_corridor.contains( object_position_predicted.x, object_position_predicted.y, corridor_margin ) )
+          continue;
+
+        double distance_to_object_predicted = distance_along_route( object_position_predicted, prediction_hint );
+        if( distance_to_object_predicted > 0 && distance_to_object_predicted < distance_to_object )
+          distance_to_object = distance_to_object_predicted;
+      }
     }
-    // for( int i = 0; i < prediction_horizon; i++ )
-    // {
-    //   object_position_predicted.x          = object_position_predicted.x + participant.state.vx * dt * cos( participant.state.yaw_angle );
-    //   object_position_predicted.y          = object_position_predicted.y + participant.state.vx * dt * sin( participant.state.yaw_angle );
-    //   double distance_to_object_predicted  = latest_route.get_s( object_position_predicted );
-    //   double offset    = math::distance_2d( object_position_predicted, latest_route.get_pose_at_s( distance_to_object_predicted ) );
-    //   auto   map_point = latest_route.get_map_point_at_s( distance_to_object_predicted );
-    //   bool   within_lane_predicted = offset < (latest_map.lanes.at( map_point.parent_id )->get_width( map_point.s ) / 2);
-    //   distance_to_object_predicted        -= state_s;
-    //   if( within_lane_predicted && distance_to_object_predicted < distance_to_object )
-    //   {
-    //     //distance_to_object = distance_to_object_predicted;
-    //     within_lane        = true;
-    //   }
-    // }
-    if( within_lane && distance_to_object < distance_to_object_min && distance_to_object > 0 )
+
+    if( distance_to_object < distance_to_object_min && distance_to_object > 0 )
     {
       front_vehicle_velocity = participant.state.vx;
       distance_to_object_min = distance_to_object;
     }
   }
-  std::cerr << "distance to object: " << distance_to_object_min << std::endl;
+  // Forget the projection hints of participants that left the scene
+  for( auto it = participant_route_hints.begin(); it != participant_route_hints.end(); )
+  {
+    if( traffic_participants.participants.count( it->first ) == 0 )
+      it = participant_route_hints.erase( it );
+    else
+      ++it;
+  }
+  trace.push( TraceEvent::distance_to_object, distance_to_object_min );
 
   distance_to_goal = latest_route.get_length() - state_s;
-  std::cerr << "distance to goal: " << distance_to_goal << std::endl;
+  trace.push( TraceEvent::distance_to_goal, distance_to_goal );
 
   double distance_for_idm = std::min( distance_to_object_min, distance_to_goal );
 
@@ -553,5 +741,21 @@ OptiNLCTrajectoryPlanner::calculate_idm_velocity( const map::Route& latest_route
   return idm_velocity;
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+OptiNLCTrajectoryPlannerT<ControlPoints, HorizonMs, Precision>::set_cycle_budget( double cycle_budget )
+{
+  ocp_solver.set_cycle_budget( cycle_budget );
+}
+
+// Horizon variants, see the aliases in the header
+template class OptiNLCTrajectoryPlannerT<20, 2000>;
+template class OptiNLCTrajectoryPlannerT<30, 3000>;
+template class OptiNLCTrajectoryPlannerT<40, 4000>;
+
+// Float solver variants, see planner_precision.hpp
+template class OptiNLCTrajectoryPlannerT<30, 3000, FloatSolverPrecision>;
+template class OptiNLCTrajectoryPlannerT<30, 3000, SinglePrecision>;
+
 } // namespace planner
 } // namespace adore
@@ -0,0 +1,824 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include "planning/planning_log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include "adore_math/angles.h"
+
+namespace adore
+{
+namespace planner
+{
+
+namespace
+{
+
+// File header, followed by the records
+constexpr uint32_t log_magic   = 0x474c5041; // "APLG"
+constexpr uint32_t log_version = 2; // 2: participant routes are written as participant route records
+
+enum RecordType : uint32_t
+{
+  parameters_record        = 1,
+  route_record             = 2,
+  cycle_record             = 3,
+  participant_route_record = 4
+};
+
+// Route flag of a participant
+enum ParticipantRoute : uint8_t
+{
+  no_route       = 0,
+  inline_route   = 1, // the route follows, version 1 logs
+  recorded_route = 2  // the route of the last participant route record of the participant
+};
+
+constexpr size_t record_header_size = 2 * sizeof( uint32_t ); // type, payload size
+
+// Little helpers for the native byte order, logs are replayed on the architecture they were recorded on
+template<typename T>
+void
+put( std::vector<char>& buffer, T value )
+{
+  static_assert( std::is_trivially_copyable_v<T> );
+  size_t offset = buffer.size();
+  buffer.resize( offset + sizeof( T ) );
+  std::memcpy( buffer.data() + offset, &value, sizeof( T ) );
+}
+
+void
+put_count( std::vector<char>& buffer, size_t count )
+{
+  put( buffer, static_cast<uint32_t>( count ) );
+}
+
+void
+put_state( std::vector<char>& buffer, const dynamics::VehicleStateDynamic& state )
+{
+  for( double value : { state.x, state.y, state.z, state.vx, state.vy, state.yaw_angle, state.yaw_rate, state.ax, state.ay,
+                        state.steering_angle, state.steering_rate, state.time } )
+    put( buffer, value );
+}
+
+void
+put_trajectory( std::vector<char>& buffer, const dynamics::Trajectory& trajectory )
+{
+  put_count( buffer, trajectory.states.size() );
+  for( const auto& state : trajectory.states )
+    put_state( buffer, state );
+}
+
+void
+put_map_point( std::vector<char>& buffer, const map::MapPoint& point )
+{
+  put( buffer, point.x );
+  put( buffer, point.y );
+  put( buffer, point.s );
+  put( buffer, static_cast<uint64_t>( point.parent_id ) );
+  put( buffer, static_cast<uint8_t>( point.max_speed.has_value() ) );
+  if( point.max_speed )
+    put( buffer, point.max_speed.value() );
+}
+
+void
+put_route( std::vector<char>& buffer, const map::Route& route )
+{
+  put_count( buffer, route.center_lane.size() );
+  for( const auto& [s, point] : route.center_lane )
+  {
+    put( buffer, s );
+    put_map_point( buffer, point );
+  }
+}
+
+void
+put_points( std::vector<char>& buffer, const std::vector<math::Point2d>& points )
+{
+  put_count( buffer, points.size() );
+  for( const auto& point : points )
+  {
+    put( buffer, point.x );
+    put( buffer, point.y );
+  }
+}
+
+// Participant routes are written as participant route records before the cycle, with_routes marks them as recorded
+void
+put_participants( std::vector<char>& buffer, const dynamics::TrafficParticipantSet& traffic_participants, bool with_routes )
+{
+  put_count( buffer, traffic_participants.participants.size() );
+  for( const auto& [key, participant] : traffic_participants.participants )
+  {
+    put( buffer, static_cast<int64_t>( key ) );
+    put( buffer, static_cast<uint64_t>( participant.id ) );
+    put_state( buffer, participant.state );
+    put( buffer, participant.physical_parameters.wheelbase );
+    put( buffer, static_cast<uint8_t>( participant.trajectory.has_value() ) );
+    if( participant.trajectory )
+      put_trajectory( buffer, participant.trajectory.value() );
+    put( buffer, static_cast<uint8_t>( with_routes && participant.route ? recorded_route : no_route ) );
+  }
+}
+
+// Smallest encoded sizes, element counts are checked against them so a corrupt count does not allocate
+constexpr size_t state_size       = 12 * sizeof( double );
+constexpr size_t map_point_size   = 3 * sizeof( double ) + sizeof( uint64_t ) + sizeof( uint8_t );
+constexpr size_t route_point_size = sizeof( double ) + map_point_size;
+constexpr size_t participant_size = sizeof( int64_t ) + sizeof( uint64_t ) + state_size + sizeof( double ) + 2 * sizeof( uint8_t );
+constexpr size_t parameter_size   = sizeof( uint32_t ) + sizeof( double );
+
+// Bounds checked decoding of one record payload
+class Decoder
+{
+public:
+
+  Decoder( const char* data, size_t size ) :
+    data( data ),
+    size( size )
+  {}
+
+  template<typename T>
+  T
+  get()
+  {
+    static_assert( std::is_trivially_copyable_v<T> );
+    if( size - position < sizeof( T ) )
+      throw std::runtime_error( "planning log record is shorter than its contents" );
+    T value;
+    std::memcpy( &value, data + position, sizeof( T ) );
+    position += sizeof( T );
+    return value;
+  }
+
+  size_t
+  get_count( size_t element_size )
+  {
+    size_t count = get<uint32_t>();
+    if( count > ( size - position ) / element_size )
+      throw std::runtime_error( "planning log record is shorter than its contents" );
+    return count;
+  }
+
+  void
+  get_state( dynamics::VehicleStateDynamic& state )
+  {
+    for( double* value : { &state.x, &state.y, &state.z, &state.vx, &state.vy, &state.yaw_angle, &state.yaw_rate, &state.ax, &state.ay,
+                           &state.steering_angle, &state.steering_rate, &state.time } )
+      *value = get<double>();
+  }
+
+  void
+  get_trajectory( dynamics::Trajectory& trajectory )
+  {
+    trajectory.states.resize( get_count( state_size ) );
+    for( auto& state : trajectory.states )
+      get_state( state );
+  }
+
+  void
+  get_map_point( map::MapPoint& point )
+  {
+    point.x         = get<double>();
+    point.y         = get<double>();
+    point.s         = get<double>();
+    point.parent_id = static_cast<decltype( point.parent_id )>( get<uint64_t>() );
+    point.max_speed.reset();
+    if( get<uint8_t>() )
+      point.max_speed = get<double>();
+  }
+
+  void
+  get_route( map::Route& route )
+  {
+    route.center_lane.clear();
+    size_t count = get_count( route_point_size );
+    for( size_t i = 0; i < count; ++i )
+    {
+      double        s = get<double>();
+      map::MapPoint point;
+      get_map_point( point );
+      route.center_lane.emplace_hint( route.center_lane.end(), s, point );
+    }
+  }
+
+  void
+  get_points( std::vector<math::Point2d>& points )
+  {
+    points.resize( get_count( 2 * sizeof( double ) ) );
+    for( auto& point : points )
+    {
+      point.x = get<double>();
+      point.y = get<double>();
+    }
+  }
+
+  // routes holds the participant routes recorded so far
+  void
+  get_participants( dynamics::TrafficParticipantSet& traffic_participants, const std::unordered_map<int64_t, map::Route>& routes )
+  {
+    using Key = typename std::decay_t<decltype( traffic_participants.participants )>::key_type;
+
+    traffic_participants.participants.clear();
+    size_t count = get_count( participant_size );
+    for( size_t i = 0; i < count; ++i )
+    {
+      auto  recorded_key = get<int64_t>();
+      auto  key          = static_cast<Key>( recorded_key );
+      auto& participant  = traffic_participants.participants[key];
+      participant.id    = static_cast<decltype( participant.id )>( get<uint64_t>() );
+      get_state( participant.state );
+      participant.physical_parameters.wheelbase = get<double>();
+      if( get<uint8_t>() )
+      {
+        participant.trajectory.emplace();
+        get_trajectory( participant.trajectory.value() );
+      }
+      uint8_t route_flag = get<uint8_t>();
+      if( route_flag == inline_route )
+      {
+        participant.route.emplace();
+        get_route( participant.route.value() );
+      }
+      else if( route_flag == recorded_route )
+      {
+        auto route = routes.find( recorded_key );
+        if( route == routes.end() )
+          throw std::runtime_error( "planning log participant refers to a route that was not recorded" );
+        participant.route = route->second;
+      }
+    }
+  }
+
+  std::string
+  get_string()
+  {
+    size_t      length = get_count( 1 );
+    std::string value( data + position, length );
+    position += length;
+    return value;
+  }
+
+private:
+
+  const char* data;
+  size_t      size;
+  size_t      position = 0;
+};
+
+// Size of the header and the complete records of an existing log, 0 for an empty log or a cut off header. Only the
+// record headers are read. Throws std::runtime_error if the file is not a planning log of this version.
+size_t
+complete_log_size( int descriptor, const std::string& path )
+{
+  struct stat status;
+  if( ::fstat( descriptor, &status ) != 0 )
+    throw std::runtime_error( "cannot read the size of planning log " + path );
+  size_t length = static_cast<size_t>( status.st_size );
+
+  char header[record_header_size]; // the log header has the size of a record header
+  if( length < sizeof( header ) )
+    return 0;
+  if( ::pread( descriptor, header, sizeof( header ), 0 ) != static_cast<ssize_t>( sizeof( header ) ) )
+    throw std::runtime_error( "cannot read planning log " + path );
+  Decoder  log_header( header, sizeof( header ) );
+  uint32_t magic   = log_header.get<uint32_t>();
+  uint32_t version = log_header.get<uint32_t>();
+  if( magic != log_magic || version != log_version )
+    throw std::runtime_error( path + " is not a planning log of this version, records are not appended to it" );
+
+  size_t position = 2 * sizeof( uint32_t );
+  while( length - position >= record_header_size )
+  {
+    if( ::pread( descriptor, header, record_header_size, static_cast<off_t>( position ) ) != static_cast<ssize_t>( record_header_size ) )
+      throw std::runtime_error( "cannot read planning log " + path );
+    Decoder record_header( header, record_header_size );
+    record_header.get<uint32_t>(); // type
+    uint32_t payload_size = record_header.get<uint32_t>();
+    if( length - position - record_header_size < payload_size )
+      break;
+    position += record_header_size + payload_size;
+  }
+  return position;
+}
+
+bool
+same_map_point( const map::MapPoint& a, const map::MapPoint& b )
+{
+  return a.x == b.x && a.y == b.y && a.s == b.s && a.parent_id == b.parent_id && a.max_speed == b.max_speed;
+}
+
+bool
+same_route( const std::vector<std::pair<double, map::MapPoint>>& last, const map::Route& route )
+{
+  if( last.size() != route.center_lane.size() )
+    return false;
+  auto it = route.center_lane.begin();
+  for( const auto& [s, point] : last )
+  {
+    if( it->first != s || !same_map_point( it->second, point ) )
+      return false;
+    ++it;
+  }
+  return true;
+}
+
+} // namespace
+
+const char*
+planning_cycle_type_name( PlanningCycleType type )
+{
+  switch( type )
+  {
+    case PlanningCycleType::route:
+      return "route";
+    case PlanningCycleType::corridor:
+      return "corridor";
+    case PlanningCycleType::reference:
+      return "reference";
+    case PlanningCycleType::lane_follow:
+      return "lane follow";
+    case PlanningCycleType::multi_agent:
+      return "multi agent";
+  }
+  return "unknown";
+}
+
+PlanningLogWriter::PlanningLogWriter( const std::string& path )
+{
+  int descriptor = ::open( path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644 );
+  if( descriptor < 0 )
+    throw std::runtime_error( "cannot open planning log " + path + ": " + std::strerror( errno ) );
+
+  size_t complete = 0;
+  try
+  {
+    complete = complete_log_size( descriptor, path );
+  }
+  catch( ... )
+  {
+    ::close( descriptor );
+    throw;
+  }
+  // A recording that was killed while writing leaves a cut off record, the new records start after the last complete one
+  struct stat status;
+  if( ::fstat( descriptor, &status ) == 0 && static_cast<size_t>( status.st_size ) > complete
+      && ::ftruncate( descriptor, static_cast<off_t>( complete ) ) != 0 )
+  {
+    ::close( descriptor );
+    throw std::runtime_error( "cannot truncate the cut off record of planning log " + path + ": " + std::strerror( errno ) );
+  }
+
+  file = ::fdopen( descriptor, "ab" );
+  if( !file )
+  {
+    ::close( descriptor );
+    throw std::runtime_error( "cannot open planning log " + path + ": " + std::strerror( errno ) );
+  }
+
+  if( complete == 0 )
+  {
+    buffer.clear();
+    put( buffer, log_magic );
+    put( buffer, log_version );
+    if( std::fwrite( buffer.data(), 1, buffer.size(), file ) != buffer.size() )
+    {
+      std::fclose( file );
+      throw std::runtime_error( "cannot write planning log header" );
+    }
+    written += buffer.size();
+  }
+  writer = std::thread( [this]() { writer_loop(); } );
+}
+
+PlanningLogWriter::~PlanningLogWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    stop = true;
+  }
+  wake_up.notify_one();
+  writer.join();
+  std::fclose( file );
+}
+
+void
+PlanningLogWriter::writer_loop()
+{
+  std::unique_lock<std::mutex> lock( mutex );
+  while( true )
+  {
+    wake_up.wait( lock, [this]() { return stop || !pending.empty(); } );
+    if( pending.empty() ) // stopped, everything is written
+      return;
+
+    std::swap( pending, writing );
+    writer_busy = true;
+    lock.unlock();
+    bool ok = std::fwrite( writing.data(), 1, writing.size(), file ) == writing.size();
+    if( ok && flush_each_record )
+      ok = std::fflush( file ) == 0;
+    writing.clear();
+    lock.lock();
+
+    writer_busy  = false;
+    write_failed = write_failed || !ok;
+    drained.notify_all();
+  }
+}
+
+void
+PlanningLogWriter::flush()
+{
+  std::unique_lock<std::mutex> lock( mutex );
+  drained.wait( lock, [this]() { return pending.empty() && !writer_busy; } );
+  // The writer thread waits for new records and does not touch the file while the lock is held
+  if( write_failed || std::fflush( file ) != 0 )
+    throw std::runtime_error( "cannot write planning log record" );
+}
+
+void
+PlanningLogWriter::begin_record( uint32_t type )
+{
+  buffer.clear();
+  put( buffer, type );
+  put( buffer, uint32_t{ 0 } ); // payload size, set by end_record
+}
+
+void
+PlanningLogWriter::end_record()
+{
+  uint32_t payload_size = static_cast<uint32_t>( buffer.size() - record_header_size );
+  std::memcpy( buffer.data() + sizeof( uint32_t ), &payload_size, sizeof( payload_size ) );
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    if( write_failed )
+      throw std::runtime_error( "cannot write planning log record" );
+    pending.insert( pending.end(), buffer.begin(), buffer.end() );
+  }
+  wake_up.notify_one();
+  written += buffer.size();
+}
+
+void
+PlanningLogWriter::begin_cycle( PlanningCycleType type, double recorded_time )
+{
+  begin_record( cycle_record );
+  put( buffer, static_cast<uint32_t>( type ) );
+  put( buffer, recorded_time );
+}
+
+// A route cycle refers to the last route record before it, a writer that appends to a log writes its first route again
+void
+PlanningLogWriter::write_route_if_changed( const map::Route& route )
+{
+  if( has_route && same_route( last_route, route ) )
+    return;
+
+  last_route.assign( route.center_lane.begin(), route.center_lane.end() );
+  has_route = true;
+  begin_record( route_record );
+  put_route( buffer, route );
+  end_record();
+}
+
+// Same for the participants, a participant route is written when it changes and the participants refer to it
+void
+PlanningLogWriter::write_participant_routes_if_changed( const dynamics::TrafficParticipantSet& traffic_participants )
+{
+  for( const auto& [key, participant] : traffic_participants.participants )
+  {
+    if( !participant.route )
+      continue;
+    auto& last = participant_routes[static_cast<int64_t>( key )];
+    if( !last.empty() && same_route( last, participant.route.value() ) )
+      continue;
+
+    last.assign( participant.route->center_lane.begin(), participant.route->center_lane.end() );
+    begin_record( participant_route_record );
+    put( buffer, static_cast<int64_t>( key ) );
+    put_route( buffer, participant.route.value() );
+    end_record();
+  }
+  // Participants that left are forgotten, a participant that comes back writes its route again
+  using Key = typename std::decay_t<decltype( traffic_participants.participants )>::key_type;
+  for( auto it = participant_routes.begin(); it != participant_routes.end(); )
+  {
+    auto participant = traffic_participants.participants.find( static_cast<Key>( it->first ) );
+    if( participant == traffic_participants.participants.end() || !participant->second.route )
+      it = participant_routes.erase( it );
+    else
+      ++it;
+  }
+}
+
+void
+PlanningLogWriter::write_parameters( const std::map<std::string, double>& parameters )
+{
+  begin_record( parameters_record );
+  put_count( buffer, parameters.size() );
+  for( const auto& [name, value] : parameters )
+  {
+    put_count( buffer, name.size() );
+    buffer.insert( buffer.end(), name.begin(), name.end() );
+    put( buffer, value );
+  }
+  end_record();
+}
+
+void
+PlanningLogWriter::write_route_cycle( const map::Route& route, const dynamics::VehicleStateDynamic& state,
+                                      const dynamics::TrafficParticipantSet& traffic_participants, const dynamics::Trajectory& trajectory,
+                                      double recorded_time )
+{
+  write_route_if_changed( route );
+  write_participant_routes_if_changed( traffic_participants );
+  begin_cycle( PlanningCycleType::route, recorded_time );
+  put_state( buffer, state );
+  put_participants( buffer, traffic_participants, true );
+  put_trajectory( buffer, trajectory );
+  end_record();
+}
+
+void
+PlanningLogWriter::write_corridor_cycle( const std::vector<math::Point2d>& left_border, const std::vector<math::Point2d>& right_border,
+                                         const dynamics::VehicleStateDynamic& state, const dynamics::Trajectory& trajectory,
+                                         double recorded_time )
+{
+  begin_cycle( PlanningCycleType::corridor, recorded_time );
+  put_points( buffer, left_border );
+  put_points( buffer, right_border );
+  put_state( buffer, state );
+  put_trajectory( buffer, trajectory );
+  end_record();
+}
+
+void
+PlanningLogWriter::write_reference_cycle( const dynamics::Trajectory& reference_trajectory, const dynamics::VehicleStateDynamic& state,
+                                          const dynamics::Trajectory& trajectory, double recorded_time )
+{
+  begin_cycle( PlanningCycleType::reference, recorded_time );
+  put_trajectory( buffer, reference_trajectory );
+  put_state( buffer, state );
+  put_trajectory( buffer, trajectory );
+  end_record();
+}
+
+void
+PlanningLogWriter::write_lane_follow_cycle( const dynamics::VehicleStateDynamic& state, const std::deque<map::MapPoint>& route_points,
+                                            const dynamics::VehicleCommandLimits& limits, const dynamics::Trajectory& trajectory,
+                                            double recorded_time )
+{
+  begin_cycle( PlanningCycleType::lane_follow, recorded_time );
+  put_state( buffer, state );
+  put_count( buffer, route_points.size() );
+  for( const auto& point : route_points )
+    put_map_point( buffer, point );
+  put( buffer, limits.max_acceleration );
+  put( buffer, limits.min_acceleration );
+  put( buffer, limits.max_steering_angle );
+  put_trajectory( buffer, trajectory );
+  end_record();
+}
+
+void
+PlanningLogWriter::write_multi_agent_cycle( const dynamics::TrafficParticipantSet& traffic_participants,
+                                            const dynamics::TrafficParticipantSet& planned_participants, double recorded_time )
+{
+  write_participant_routes_if_changed( traffic_participants );
+  begin_cycle( PlanningCycleType::multi_agent, recorded_time );
+  put_participants( buffer, traffic_participants, true );
+  put_participants( buffer, planned_participants, false );
+  end_record();
+}
+
+PlanningLogReader::PlanningLogReader( const std::string& path )
+{
+  int descriptor = ::open( path.c_str(), O_RDONLY );
+  if( descriptor < 0 )
+    throw std::runtime_error( "cannot open planning log " + path + ": " + std::strerror( errno ) );
+
+  struct stat status;
+  if( ::fstat( descriptor, &status ) != 0 )
+  {
+    ::close( descriptor );
+    throw std::runtime_error( "cannot read the size of planning log " + path );
+  }
+  length = static_cast<size_t>( status.st_size );
+  if( length < 2 * sizeof( uint32_t ) )
+  {
+    ::close( descriptor );
+    throw std::runtime_error( path + " is not a planning log" );
+  }
+
+  void* mapping = ::mmap( nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+  ::close( descriptor );
+  if( mapping == MAP_FAILED )
+    throw std::runtime_error( "cannot map planning log " + path + ": " + std::strerror( errno ) );
+  data = static_cast<const char*>( mapping );
+  ::madvise( mapping, length, MADV_SEQUENTIAL );
+
+  Decoder header( data, 2 * sizeof( uint32_t ) );
+  uint32_t magic   = header.get<uint32_t>();
+  uint32_t version = header.get<uint32_t>();
+  if( magic != log_magic || version > log_version )
+  {
+    ::munmap( mapping, length );
+    throw std::runtime_error( path + " is not a planning log of a supported version" );
+  }
+  rewind();
+}
+
+PlanningLogReader::~PlanningLogReader()
+{
+  if( data )
+    ::munmap( const_cast<char*>( data ), length );
+}
+
+void
+PlanningLogReader::rewind()
+{
+  position           = 2 * sizeof( uint32_t );
+  truncated_tail     = false;
+  parameters_changed = false;
+  route.reset();
+  participant_routes.clear();
+  parameters.clear();
+}
+
+bool
+PlanningLogReader::next( PlanningCycle& cycle )
+{
+  while( position < length )
+  {
+    if( length - position < record_header_size )
+    {
+      truncated_tail = true;
+      return false;
+    }
+    Decoder  record_header( data + position, record_header_size );
+    uint32_t type         = record_header.get<uint32_t>();
+    uint32_t payload_size = record_header.get<uint32_t>();
+    if( length - position - record_header_size < payload_size )
+    {
+      truncated_tail = true;
+      return false;
+    }
+    Decoder payload( data + position + record_header_size, payload_size );
+    position += record_header_size + payload_size;
+
+    if( type == parameters_record )
+    {
+      parameters.clear();
+      size_t count = payload.get_count( parameter_size );
+      for( size_t i = 0; i < count; ++i )
+      {
+        std::string name = payload.get_string();
+        parameters[name] = payload.get<double>();
+      }
+      parameters_changed = true;
+    }
+    else if( type == route_record )
+    {
+      auto decoded = std::make_shared<map::Route>();
+      payload.get_route( *decoded );
+      route = std::move( decoded );
+    }
+    else if( type == participant_route_record )
+    {
+      int64_t key = payload.get<int64_t>();
+      payload.get_route( participant_routes[key] );
+    }
+    else if( type == cycle_record )
+    {
+      uint32_t cycle_type = payload.get<uint32_t>();
+      if( cycle_type > static_cast<uint32_t>( PlanningCycleType::multi_agent ) )
+        continue; // written by a newer version
+
+      cycle.type               = static_cast<PlanningCycleType>( cycle_type );
+      cycle.recorded_time      = payload.get<double>();
+      cycle.parameters         = &parameters;
+      cycle.parameters_changed = parameters_changed;
+      parameters_changed       = false;
+      switch( cycle.type )
+      {
+        case PlanningCycleType::route:
+          if( !route )
+            throw std::runtime_error( "planning log cycle without a preceding route" );
+          cycle.route = route;
+          payload.get_state( cycle.state );
+          payload.get_participants( cycle.traffic_participants, participant_routes );
+          payload.get_trajectory( cycle.trajectory );
+          break;
+        case PlanningCycleType::corridor:
+          payload.get_points( cycle.left_border );
+          payload.get_points( cycle.right_border );
+          payload.get_state( cycle.state );
+          payload.get_trajectory( cycle.trajectory );
+          break;
+        case PlanningCycleType::reference:
+          payload.get_trajectory( cycle.reference_trajectory );
+          payload.get_state( cycle.state );
+          payload.get_trajectory( cycle.trajectory );
+          break;
+        case PlanningCycleType::lane_follow:
+        {
+          payload.get_state( cycle.state );
+          cycle.route_points.resize( payload.get_count( map_point_size ) );
+          for( auto& point : cycle.route_points )
+            payload.get_map_point( point );
+          cycle.limits.max_acceleration   = payload.get<double>();
+          cycle.limits.min_acceleration   = payload.get<double>();
+          cycle.limits.max_steering_angle = payload.get<double>();
+          payload.get_trajectory( cycle.trajectory );
+          break;
+        }
+        case PlanningCycleType::multi_agent:
+          payload.get_participants( cycle.traffic_participants, participant_routes );
+          payload.get_participants( cycle.planned_participants, participant_routes );
+          break;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+TrajectoryDifference::merge( const TrajectoryDifference& other )
+{
+  compared_states  += other.compared_states;
+  missing_states   += other.missing_states;
+  max_position      = std::max( max_position, other.max_position );
+  max_speed         = std::max( max_speed, other.max_speed );
+  max_yaw           = std::max( max_yaw, other.max_yaw );
+  max_steering      = std::max( max_steering, other.max_steering );
+  max_acceleration  = std::max( max_acceleration, other.max_acceleration );
+}
+
+TrajectoryDifference
+compare_trajectories( const dynamics::Trajectory& replayed, const dynamics::Trajectory& recorded )
+{
+  size_t states = std::min( replayed.states.size(), recorded.states.size() );
+
+  TrajectoryDifference difference;
+  difference.compared_states = states;
+  difference.missing_states  = std::max( replayed.states.size(), recorded.states.size() ) - states;
+  for( size_t i = 0; i < states; ++i )
+  {
+    const auto& a = replayed.states[i];
+    const auto& b = recorded.states[i];
+    difference.max_position     = std::max( difference.max_position, std::hypot( a.x - b.x, a.y - b.y ) );
+    difference.max_speed        = std::max( difference.max_speed, std::abs( a.vx - b.vx ) );
+    difference.max_yaw          = std::max( difference.max_yaw, std::abs( math::normalize_angle( a.yaw_angle - b.yaw_angle ) ) );
+    difference.max_steering     = std::max( difference.max_steering, std::abs( a.steering_angle - b.steering_angle ) );
+    difference.max_acceleration = std::max( difference.max_acceleration, std::abs( a.ax - b.ax ) );
+  }
+  return difference;
+}
+
+TrajectoryDifference
+compare_participant_trajectories( const dynamics::TrafficParticipantSet& replayed, const dynamics::TrafficParticipantSet& recorded )
+{
+  static const dynamics::Trajectory no_trajectory;
+
+  TrajectoryDifference difference;
+  for( const auto& [id, participant] : recorded.participants )
+  {
+    const auto& recorded_trajectory = participant.trajectory ? participant.trajectory.value() : no_trajectory;
+    auto        other               = replayed.participants.find( id );
+    if( other == replayed.participants.end() || !other->second.trajectory )
+      difference.missing_states += recorded_trajectory.states.size();
+    else
+      difference.merge( compare_trajectories( other->second.trajectory.value(), recorded_trajectory ) );
+  }
+  for( const auto& [id, participant] : replayed.participants )
+    if( participant.trajectory && !recorded.participants.count( id ) )
+      difference.missing_states += participant.trajectory->states.size();
+  return difference;
+}
+
+} // namespace planner
+} // namespace adore
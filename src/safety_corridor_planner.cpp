@@ -18,9 +18,11 @@ namespace adore
 namespace planner
 {
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-SafetyCorridorPlanner::set_parameters( const std::map<std::string, double>& params )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::set_parameters( const std::map<std::string, double>& params )
 {
+  auto& options                   = ocp_solver.options;
   options.intermediateIntegration = 3;
   options.OptiNLC_ACC             = 1e-4;
   options.maxNumberOfIteration    = 500;
@@ -30,9 +32,13 @@ SafetyCorridorPlanner::set_parameters( const std::map<std::string, double>& para
   options.perturbation            = 1e-6;
   options.timeStep                = sim_time / control_points;
   options.debugPrint              = false;
+  reset_speculative_planners();
 
   for( const auto& [name, value] : params )
   {
+    parameters[name] = value;
+    if( ocp_solver.set_parameter( name, value ) )
+      continue;
     if( name == "wheel_base" )
       wheelbase = value;
     if( name == "intermediate_integration" )
@@ -47,32 +53,41 @@ SafetyCorridorPlanner::set_parameters( const std::map<std::string, double>& para
       options.OptiNLC_time_limit = value;
     if( name == "drive_direction_safety_corridor" )
       drive_direction = static_cast<safety_corridor_drive_direction>( static_cast<int>( value ) );
+    if( name == "corridor_cache" )
+      use_corridor_cache = value != 0.0;
+    if( name == "verbose" )
+      trace.set_echo( value != 0.0 );
+    if( name == "speculative_solves" )
+      use_speculative_solves = value != 0.0;
+    if( name == "speculative_initial_guesses" )
+      speculative_initial_guesses = std::clamp( static_cast<int>( value ), 1, 2 );
   }
+  ocp_solver.configure();
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-SafetyCorridorPlanner::setup_constraints( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::setup_constraints( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp )
 {
 
-  // Define a simple input update method
-  ocp.setInputUpdate( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& input, double, void* ) {
-    VECTOR<double, input_size> update_input = { input[ddDELTA] };
-    return update_input;
+  // Input guess of the solve, the shifted previous steering accelerations when warm started
+  ocp.setInputUpdate( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& input, Scalar time, void* ) {
+    return ocp_solver.seeded_input( input, time );
   } );
 
   // State Constraints
-  ocp.setUpdateStateLowerBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, state_size> state_constraints;
-    state_constraints.setConstant( -std::numeric_limits<double>::infinity() );
+  ocp.setUpdateStateLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, state_size> state_constraints;
+    state_constraints.setConstant( -std::numeric_limits<Scalar>::infinity() );
     state_constraints[V]      = max_reverse_speed;
     state_constraints[DELTA]  = -limits.max_steering_angle;
     state_constraints[dDELTA] = -max_steering_velocity;
     return state_constraints;
   } );
 
-  ocp.setUpdateStateUpperBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, state_size> state_constraints;
-    state_constraints.setConstant( std::numeric_limits<double>::infinity() );
+  ocp.setUpdateStateUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, state_size> state_constraints;
+    state_constraints.setConstant( std::numeric_limits<Scalar>::infinity() );
     state_constraints[V]      = max_forward_speed;
     state_constraints[DELTA]  = limits.max_steering_angle;
     state_constraints[dDELTA] = max_steering_velocity;
@@ -80,84 +95,131 @@ SafetyCorridorPlanner::setup_constraints( OptiNLC_OCP<double, input_size, state_
   } );
 
   // Input Constraints
-  ocp.setUpdateInputLowerBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, input_size> input_constraints;
+  ocp.setUpdateInputLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, input_size> input_constraints;
     input_constraints[ddDELTA] = -max_steering_acceleration;
     return input_constraints;
   } );
 
-  ocp.setUpdateInputUpperBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, input_size> input_constraints;
+  ocp.setUpdateInputUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, input_size> input_constraints;
     input_constraints[ddDELTA] = max_steering_acceleration;
     return input_constraints;
   } );
 
   // Define a functions constraints method
-  ocp.setUpdateFunctionConstraints( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
+  ocp.setUpdateFunctionConstraints( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
     functions_constraint.setConstant( 0.0 );
     return functions_constraint;
   } );
 
-  ocp.setUpdateFunctionConstraintsLowerBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
-    functions_constraint.setConstant( -std::numeric_limits<double>::infinity() );
+  ocp.setUpdateFunctionConstraintsLowerBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
+    functions_constraint.setConstant( -std::numeric_limits<Scalar>::infinity() );
     return functions_constraint;
   } );
 
-  ocp.setUpdateFunctionConstraintsUpperBounds( [&]( const VECTOR<double, state_size>&, const VECTOR<double, input_size>& ) {
-    VECTOR<double, constraints_size> functions_constraint;
-    functions_constraint.setConstant( std::numeric_limits<double>::infinity() );
+  ocp.setUpdateFunctionConstraintsUpperBounds( [&]( const VECTOR<Scalar, state_size>&, const VECTOR<Scalar, input_size>& ) {
+    VECTOR<Scalar, constraints_size> functions_constraint;
+    functions_constraint.setConstant( std::numeric_limits<Scalar>::infinity() );
     return functions_constraint;
   } );
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-SafetyCorridorPlanner::setup_objective_function( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::setup_objective_function( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp )
 {
-  ocp.setObjectiveFunction( [&]( const VECTOR<double, state_size>& state, const VECTOR<double, input_size>&, double ) {
+  ocp.setObjectiveFunction( [&]( const VECTOR<Scalar, state_size>& state, const VECTOR<Scalar, input_size>&, Scalar ) {
     return state[L]; // Minimize the cost function `L`
   } );
 }
 
 // Public method to get the next vehicle command based on SafetyCorridorPlanner
+template<int ControlPoints, int HorizonMs, typename Precision>
 dynamics::Trajectory
-SafetyCorridorPlanner::plan_trajectory( const std::vector<adore::math::Point2d>& left_border,
-                                        const std::vector<adore::math::Point2d>& right_border,
-                                        const dynamics::VehicleStateDynamic&     current_state )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::plan_trajectory( const std::vector<adore::math::Point2d>& left_border,
+                                                                             const std::vector<adore::math::Point2d>& right_border,
+                                                                             const dynamics::VehicleStateDynamic&     current_state )
 {
+  return plan_trajectory_ref( left_border, right_border, current_state );
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::plan_trajectory_into( dynamics::Trajectory&                    trajectory,
+                                                                                  const std::vector<adore::math::Point2d>& left_border,
+                                                                                  const std::vector<adore::math::Point2d>& right_border,
+                                                                                  const dynamics::VehicleStateDynamic&     current_state )
+{
+  trajectory = plan_trajectory_ref( left_border, right_border, current_state );
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+const dynamics::Trajectory&
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::plan_trajectory_ref( const std::vector<adore::math::Point2d>& left_border,
+                                                                                 const std::vector<adore::math::Point2d>& right_border,
+                                                                                 const dynamics::VehicleStateDynamic&     current_state )
+{
+  if( use_speculative_solves && drive_direction == safety_corridor_drive_direction::automatic )
+    return plan_speculative( left_border, right_border, current_state );
+
+  // Only the borders queried in the drive direction are hashed
+  BorderFingerprints fingerprints;
+  if( drive_direction != safety_corridor_drive_direction::right )
+    fingerprints.left = border_fingerprint( left_border );
+  if( drive_direction != safety_corridor_drive_direction::left )
+    fingerprints.right = border_fingerprint( right_border );
+  return plan_on_borders( left_border, right_border, current_state, fingerprints );
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+const dynamics::Trajectory&
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::plan_on_borders( const std::vector<adore::math::Point2d>& left_border,
+                                                                             const std::vector<adore::math::Point2d>& right_border,
+                                                                             const dynamics::VehicleStateDynamic&     current_state,
+                                                                             const BorderFingerprints&                fingerprints )
+{
+  StageClock            clock;
+  dynamics::Trajectory& trajectory = candidate_trajectory;
+  last_stats = PlannerStats();
+
   switch( drive_direction )
   {
     case safety_corridor_drive_direction::right:
     {
-      double right_distance = get_border_parameters( right_border, current_state );
-      drive_right( right_border, right_distance );
+      BorderQuery right_query = get_border_parameters( right_border, fingerprints.right, current_state, right_border_hint );
+      apply_border_query( right_query );
+      drive_right( right_query.distance );
       break;
     }
 
 
     case safety_corridor_drive_direction::left:
     {
-      double left_distance = get_border_parameters( left_border, current_state );
-      drive_left( left_border, left_distance );
+      BorderQuery left_query = get_border_parameters( left_border, fingerprints.left, current_state, left_border_hint );
+      apply_border_query( left_query );
+      drive_left( left_query.distance );
       break;
     }
 
 
     case safety_corridor_drive_direction::automatic:
     {
-      double left_distance  = get_border_parameters( left_border, current_state );
-      double right_distance = get_border_parameters( right_border, current_state );
-      if( left_distance < right_distance )
+      // Both borders are queried once, the closer one is planned on
+      BorderQuery left_query  = get_border_parameters( left_border, fingerprints.left, current_state, left_border_hint );
+      BorderQuery right_query = get_border_parameters( right_border, fingerprints.right, current_state, right_border_hint );
+      if( left_query.distance < right_query.distance )
       {
-        double left_distance = get_border_parameters( left_border, current_state );
-        drive_left( left_border, left_distance );
+        apply_border_query( left_query );
+        drive_left( left_query.distance );
         drive_direction = safety_corridor_drive_direction::left;
       }
       else
       {
-        double right_distance = get_border_parameters( right_border, current_state );
-        drive_right( right_border, right_distance );
+        apply_border_query( right_query );
+        drive_right( right_query.distance );
         drive_direction = safety_corridor_drive_direction::right;
       }
     }
@@ -172,81 +234,116 @@ SafetyCorridorPlanner::plan_trajectory( const std::vector<adore::math::Point2d>&
   }
   distance_moved += std::sqrt( ( current_state.x - car_previous_x ) * ( current_state.x - car_previous_x )
                                + ( current_state.y - car_previous_y ) * ( current_state.y - car_previous_y ) );
-  std::cerr << "distance moved: " << distance_moved << std::endl;
+  trace.push( TraceEvent::distance_moved, distance_moved );
   car_previous_x = current_state.x;
   car_previous_y = current_state.y;
   /////////////// Temporary for tuning ///////////////
 
-  std::vector<double> border_x;
-  std::vector<double> border_y;
-  std::vector<double> border_heading;
-  for( size_t i = 0; i < border_to_plan.size() - closest_index; i++ )
+  // Border chosen above, the hint of its query holds its fingerprint
+  const bool  plan_left   = drive_direction == safety_corridor_drive_direction::left;
+  const auto& border      = plan_left ? left_border : right_border;
+  const auto& border_hint = plan_left ? left_border_hint : right_border_hint;
+
+  if( closest_index < 1 || static_cast<size_t>( closest_index ) >= border.size() )
   {
-    border_x.push_back( border_to_plan[i + closest_index].x );
-    border_y.push_back( border_to_plan[i + closest_index].y );
+    trace.push( TraceEvent::no_border_intersection );
+    last_stats.fallback   = true;
+    last_stats.total_time = clock.total();
+    return kept_trajectory();
   }
-  border_x.insert( border_x.begin(), closest_intersection.x );
-  border_y.insert( border_y.begin(), closest_intersection.y );
-
-  std::vector<double> w;
-  std::vector<double> progress;
-  double              N = border_x.size();
-  w.resize( N );
-  progress.resize( N );
-  for( int i = 0; i < N; i++ )
+
+  if( use_corridor_cache )
   {
-    w[i] = 1.0;
-    if( i == 0 )
-    {
-      progress[i] = 0.0;
-    }
-    else
+    // Refit only if the border changed, otherwise move the start of the corridor to the new intersection
+    size_t fingerprint = border_hint.fingerprint;
+    if( !corridor_cache.valid || corridor_cache.fingerprint != fingerprint )
     {
-      progress[i] = progress[i - 1]
-                  + sqrt( ( border_x[i] - border_x[i - 1] ) * ( border_x[i] - border_x[i - 1] )
-                          + ( border_y[i] - border_y[i - 1] ) * ( border_y[i] - border_y[i - 1] ) );
+      auto& progress = corridor_cache.progress;
+      progress.resize( border.size() );
+      std::vector<double> border_x( border.size() );
+      std::vector<double> border_y( border.size() );
+      for( size_t i = 0; i < border.size(); i++ )
+      {
+        border_x[i] = border[i].x;
+        border_y[i] = border[i].y;
+        progress[i] = i == 0 ? 0.0 : progress[i - 1] + std::hypot( border_x[i] - border_x[i - 1], border_y[i] - border_y[i - 1] );
+      }
+      fit_corridor( progress, border_x, border_y );
+      corridor_cache.fingerprint = fingerprint;
+      corridor_cache.valid       = true;
     }
+    const auto& segment_start = border[closest_index - 1];
+    border_s_offset           = corridor_cache.progress[closest_index - 1]
+                    + std::hypot( closest_intersection.x - segment_start.x, closest_intersection.y - segment_start.y );
   }
-  safety_corridor_x = pp.CubicSplineSmoother( progress, border_x, w, 0.9 );
-  safety_corridor_y = pp.CubicSplineSmoother( progress, border_y, w, 0.9 );
-  std::vector<double> x, dx;
-  std::vector<double> y, dy;
-  pp.CubicSplineEvaluation( x, dx, progress, safety_corridor_x );
-  pp.CubicSplineEvaluation( y, dy, progress, safety_corridor_y );
-  border_heading.resize( N );
-  for( int i = 0; i < N - 1; i++ )
+  else
   {
-    border_heading[i] = std::atan2( dy[i], dx[i] );
+    // Corridor from the intersection to the end of the border
+    size_t              N = border.size() - closest_index + 1;
+    std::vector<double> border_x;
+    std::vector<double> border_y;
+    std::vector<double> progress( N, 0.0 );
+    border_x.reserve( N );
+    border_y.reserve( N );
+    border_x.push_back( closest_intersection.x );
+    border_y.push_back( closest_intersection.y );
+    for( size_t i = closest_index; i < border.size(); i++ )
+    {
+      border_x.push_back( border[i].x );
+      border_y.push_back( border[i].y );
+    }
+    for( size_t i = 1; i < N; i++ )
+    {
+      progress[i] = progress[i - 1] + std::hypot( border_x[i] - border_x[i - 1], border_y[i] - border_y[i - 1] );
+    }
+    fit_corridor( progress, border_x, border_y );
+    corridor_cache.valid = false;
+    border_s_offset      = 0.0;
   }
-  border_heading[N - 1]   = border_heading[N - 2];
-  safety_corridor_heading = pp.CubicSplineSmoother( progress, border_heading, w, 0.75 );
-
-  auto start_time = std::chrono::high_resolution_clock::now();
+  last_stats.route_preprocessing_time = clock.lap();
 
   // Initial state and input
-  VECTOR<double, input_size> initial_input = { 0.0 };
-  VECTOR<double, state_size> initial_state = {
-    current_state.x, current_state.y, current_state.yaw_angle, current_state.vx, current_state.steering_angle, 0.0, 0.0, 0.0
-  };
-
-  // Create an MPC problem (OCP)
-  OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points> ocp( &options );
-
-  // Set up dynamic model, objective, and constraints
-  setup_dynamic_model( ocp );
-
-  setup_objective_function( ocp );
-
-  setup_constraints( ocp );
+  origin_x    = Precision::local_frame ? current_state.x : 0.0;
+  origin_y    = Precision::local_frame ? current_state.y : 0.0;
+  origin_time = Precision::local_frame ? current_state.time : 0.0;
+
+  VECTOR<Scalar, input_size> initial_input = { static_cast<Scalar>( 0 ) };
+  VECTOR<Scalar, state_size> initial_state = { static_cast<Scalar>( current_state.x - origin_x ),
+                                               static_cast<Scalar>( current_state.y - origin_y ),
+                                               static_cast<Scalar>( current_state.yaw_angle ),
+                                               static_cast<Scalar>( current_state.vx ),
+                                               static_cast<Scalar>( current_state.steering_angle ),
+                                               0,
+                                               0,
+                                               0 };
+
+  if( ocp_solver.seed( current_state.time, current_state.time - origin_time ) )
+  {
+    initial_input         = ocp_solver.warm_start.inputs[0];
+    initial_state[dDELTA] = ocp_solver.warm_start.states[0][dDELTA];
+  }
+  else if( ocp_solver.seeding_enabled() )
+  {
+    trace.push( TraceEvent::warm_start_unavailable );
+  }
 
   // Solve the MPC problem
-  OptiNLC_Solver<double, input_size, state_size, constraints_size, control_points> solver( ocp );
+  auto& solver = ocp_solver.get( [&]( auto& ocp ) {
+    setup_dynamic_model( ocp );
+    setup_objective_function( ocp );
+    setup_constraints( ocp );
+  } );
+  last_stats.ocp_setup_time = clock.lap();
 
-  solver.solve( current_state.time, initial_state, initial_input );
+  solver.solve( static_cast<Scalar>( current_state.time - origin_time ), initial_state, initial_input );
+  last_stats.solve_time = clock.lap();
+  ocp_solver.report( last_stats.solve, last_stats.solve_time );
 
   auto   opt_x                   = solver.get_optimal_states();
+  auto   opt_u                   = solver.get_optimal_inputs();
   auto   time                    = solver.getTime();
   double last_objective_function = solver.get_final_objective_function();
+  last_stats.final_cost          = last_objective_function;
 
   bad_condition = false;
   if( bad_counter > 4 )
@@ -264,49 +361,52 @@ SafetyCorridorPlanner::plan_trajectory( const std::vector<adore::math::Point2d>&
     }
   }
 
-  dynamics::Trajectory planned_trajectory;
+  trajectory.states.clear();
+  trajectory.states.reserve( control_points );
   for( size_t i = 0; i < control_points; i++ )
   {
     dynamics::VehicleStateDynamic state;
-    state.x              = opt_x[i * state_size + X];
-    state.y              = opt_x[i * state_size + Y];
+    state.x              = origin_x + opt_x[i * state_size + X];
+    state.y              = origin_y + opt_x[i * state_size + Y];
     state.yaw_angle      = opt_x[i * state_size + PSI];
     state.vx             = opt_x[i * state_size + V];
     state.steering_angle = opt_x[i * state_size + DELTA];
     state.steering_rate  = opt_x[i * state_size + dDELTA];
-    state.time           = time[i];
+    state.time           = origin_time + time[i];
     if( i < control_points - 1 )
     {
-      state.yaw_rate = ( opt_x[( i + 1 ) * state_size + PSI] - opt_x[i * state_size + PSI] ) / options.timeStep;
-      state.ax       = ( opt_x[( i + 1 ) * state_size + V] - opt_x[i * state_size + V] ) / options.timeStep;
+      state.yaw_rate = ( opt_x[( i + 1 ) * state_size + PSI] - opt_x[i * state_size + PSI] ) / ocp_solver.options.timeStep;
+      state.ax       = ( opt_x[( i + 1 ) * state_size + V] - opt_x[i * state_size + V] ) / ocp_solver.options.timeStep;
     }
-    planned_trajectory.states.push_back( state );
+    trajectory.states.push_back( state );
   }
-  planned_trajectory.states[control_points - 1].yaw_rate = planned_trajectory.states[control_points - 2].yaw_rate;
-  planned_trajectory.states[control_points - 1].ax       = planned_trajectory.states[control_points - 2].ax;
+  trajectory.states[control_points - 1].yaw_rate = trajectory.states[control_points - 2].yaw_rate;
+  trajectory.states[control_points - 1].ax       = trajectory.states[control_points - 2].ax;
 
-  // Calculate time taken
-  auto                          end_time        = std::chrono::high_resolution_clock::now();
-  std::chrono::duration<double> elapsed_seconds = end_time - start_time;
+  last_stats.conversion_time = clock.lap();
+  last_stats.total_time      = clock.total();
 
   // Log cost, time taken, and convergence status
   if( bad_condition == false && bad_counter < 5 )
   {
-    previous_trajectory = planned_trajectory;
-    bad_counter         = 0;
-    return planned_trajectory;
-  }
-  else
-  {
+    // The solution is kept by swapping buffers, the old buffer is refilled by the next call
+    std::swap( previous_trajectory, trajectory );
+    bad_counter      = 0;
+    speculative_best = -1;
+    ocp_solver.store( opt_x, opt_u, current_state.time );
     return previous_trajectory;
   }
+  last_stats.fallback = true;
+  return kept_trajectory();
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-SafetyCorridorPlanner::setup_dynamic_model( OptiNLC_OCP<double, input_size, state_size, constraints_size, control_points>& ocp )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::setup_dynamic_model( OptiNLC_OCP<Scalar, input_size, state_size, constraints_size, control_points>& ocp )
 {
-  ocp.setDynamicModel( [&]( const VECTOR<double, state_size>& state, const VECTOR<double, input_size>& input,
-                            VECTOR<double, state_size>& derivative, double, void* ) {
+  ocp.setDynamicModel( [&]( const VECTOR<Scalar, state_size>& state, const VECTOR<Scalar, input_size>& input,
+                            VECTOR<Scalar, state_size>& derivative, Scalar, void* ) {
+    last_stats.model_evaluations++;
     double tau = 2.5; // Higher value means slower acceleration
 
     if( reference_velocity - state[V] > 0 )
@@ -319,34 +419,35 @@ SafetyCorridorPlanner::setup_dynamic_model( OptiNLC_OCP<double, input_size, stat
     }
 
     // Dynamic model equations
-    derivative[X]      = state[V] * cos( state[PSI] );                      // X derivative (velocity * cos(psi))
-    derivative[Y]      = state[V] * sin( state[PSI] );                      // Y derivative (velocity * sin(psi))
-    derivative[PSI]    = state[V] * tan( state[DELTA] ) / wheelbase;        // PSI derivative (steering angle / wheelbase)
-    derivative[V]      = ( 1.0 / tau ) * ( reference_velocity - state[V] ); // Velocity derivative (first order)
-    derivative[DELTA]  = state[dDELTA];                                     // Steering angle derivative
-    derivative[dDELTA] = input[ddDELTA];                                    // Steering angle rate derivative
-    derivative[S]      = state[V];                                          // Progress derivate (velocity)
-
-    // Reference trajectory point at current progress
-    int    index             = pp.findIndex( state[S], safety_corridor_x );
-    double reference_x       = pp.splineEvaluation( index, state[S], safety_corridor_x );
-    double reference_y       = pp.splineEvaluation( index, state[S], safety_corridor_y );
-    double reference_heading = pp.splineEvaluation( index, state[S], safety_corridor_heading );
+    derivative[X]      = state[V] * std::cos( state[PSI] );                                        // X derivative (velocity * cos(psi))
+    derivative[Y]      = state[V] * std::sin( state[PSI] );                                        // Y derivative (velocity * sin(psi))
+    derivative[PSI]    = state[V] * std::tan( state[DELTA] ) / static_cast<Scalar>( wheelbase );   // PSI derivative (steering angle / wheelbase)
+    derivative[V]      = static_cast<Scalar>( ( 1.0 / tau ) * ( reference_velocity - state[V] ) ); // Velocity derivative (first order)
+    derivative[DELTA]  = state[dDELTA];                                                            // Steering angle derivative
+    derivative[dDELTA] = input[ddDELTA];                                                           // Steering angle rate derivative
+    derivative[S]      = state[V];                                                                 // Progress derivate (velocity)
+
+    // Reference trajectory point at current progress, the spline is evaluated in double and moved into the OCP frame
+    ReferencePoint reference         = reference_path.evaluate( border_s_offset + state[S] );
+    Evaluation     reference_x       = reference.x - origin_x;
+    Evaluation     reference_y       = reference.y - origin_y;
+    Evaluation     reference_heading = reference.heading;
 
     // Position error terms
-    double dx = state[X] - reference_x;
-    double dy = state[Y] - reference_y;
+    Evaluation dx = state[X] - reference_x;
+    Evaluation dy = state[Y] - reference_y;
 
     // Calculate longitudinal and lateral errors relative to the vehicle's heading
-    double cos_yaw = cos( reference_heading );
-    double sin_yaw = sin( reference_heading );
+    Evaluation psi     = state[PSI];
+    Evaluation cos_yaw = std::cos( reference_heading );
+    Evaluation sin_yaw = std::sin( reference_heading );
 
-    double lateral_cost  = -dx * sin_yaw + dy * cos_yaw + lateral_distance_from_border;
-    lateral_cost        *= lateral_cost * lateral_weight;
+    Evaluation lateral_cost  = -dx * sin_yaw + dy * cos_yaw + lateral_distance_from_border;
+    lateral_cost            *= lateral_cost * lateral_weight;
 
     // Heading error term
-    double heading_cost = atan2( -sin_yaw * cos( state[PSI] ) + cos_yaw * sin( state[PSI] ),
-                                 cos_yaw * cos( state[PSI] ) + sin_yaw * sin( state[PSI] ) );
+    Evaluation heading_cost = std::atan2( -sin_yaw * std::cos( psi ) + cos_yaw * std::sin( psi ),
+                                          cos_yaw * std::cos( psi ) + sin_yaw * std::sin( psi ) );
 
     heading_cost *= heading_cost * heading_weight;
 
@@ -354,19 +455,21 @@ SafetyCorridorPlanner::setup_dynamic_model( OptiNLC_OCP<double, input_size, stat
     // double steering_cost = input[DELTA] * input[DELTA] * steering_weight;
 
     // Total cost derivative
-    derivative[L] = lateral_cost + heading_cost;
+    derivative[L] = static_cast<Scalar>( lateral_cost + heading_cost );
   } );
 }
 
-SafetyCorridorPlanner::SafetyCorridorPlanner()
+template<int ControlPoints, int HorizonMs, typename Precision>
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::SafetyCorridorPlannerT()
 {
-  options.setDefaults();
+  ocp_solver.options.setDefaults();
   set_parameters( {} );
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 bool
-SafetyCorridorPlanner::find_intersection( const adore::math::Point2d& p1, const adore::math::Point2d& p2,
-                                          const adore::math::Point2d& carPos, double heading, adore::math::Point2d& intersection )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::find_intersection( const adore::math::Point2d& p1, const adore::math::Point2d& p2,
+                                                                               const adore::math::Point2d& carPos, double heading, adore::math::Point2d& intersection )
 {
   // Direction vector along the car's heading
   double cosTheta = std::cos( heading );
@@ -401,81 +504,294 @@ SafetyCorridorPlanner::find_intersection( const adore::math::Point2d& p1, const
   return true;
 }
 
-double
-SafetyCorridorPlanner::get_border_parameters( const std::vector<adore::math::Point2d>& border,
-                                              const dynamics::VehicleStateDynamic&     current_state )
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::search_border_segments( const std::vector<adore::math::Point2d>& border,
+                                                                                    const dynamics::VehicleStateDynamic& current_state, size_t first, size_t last,
+                                                                                    BorderQuery& query )
 {
+  adore::math::Point2d car_position;
+  car_position.x = current_state.x;
+  car_position.y = current_state.y;
+
   // Check each segment of the polyline
-  double min_distance = std::numeric_limits<double>::max();
-  for( size_t i = 0; i < border.size() - 1; i++ )
+  for( size_t i = first; i < last; i++ )
   {
     adore::math::Point2d intersection;
-    adore::math::Point2d p1;
-    p1.x = border[i].x;
-    p1.y = border[i].y;
-    adore::math::Point2d p2;
-    p2.x = border[i + 1].x;
-    p2.y = border[i + 1].y;
-    adore::math::Point2d car_position;
-    car_position.x = current_state.x;
-    car_position.y = current_state.y;
-    if( find_intersection( p1, p2, car_position, current_state.yaw_angle, intersection ) )
+    if( find_intersection( border[i], border[i + 1], car_position, current_state.yaw_angle, intersection ) )
     {
       double distance = std::hypot( intersection.x - car_position.x, intersection.y - car_position.y );
-      if( distance < min_distance )
+      // Ties go to the first segment, as in a scan of the whole border
+      if( distance < query.distance || ( distance == query.distance && static_cast<int>( i + 1 ) < query.closest_index ) )
+      {
+        query.found         = true;
+        query.distance      = distance;
+        query.intersection  = intersection;
+        query.closest_index = i + 1;
+        query.side          = get_relative_position( border[i], border[i + 1], car_position );
+      }
+    }
+  }
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::update_segment_grid( const std::vector<adore::math::Point2d>& border,
+                                                                                 size_t fingerprint, BorderHint& hint )
+{
+  if( hint.segments_valid && hint.segments_of == fingerprint )
+    return;
+  hint.segments.clear( border_grid_cell_size );
+  hint.segment_reach = 0.0;
+  for( size_t i = 0; i + 1 < border.size(); i++ )
+  {
+    hint.segments.insert( static_cast<int>( i ), 0.5 * ( border[i].x + border[i + 1].x ), 0.5 * ( border[i].y + border[i + 1].y ) );
+    hint.segment_reach = std::max( hint.segment_reach, 0.5 * std::hypot( border[i + 1].x - border[i].x, border[i + 1].y - border[i].y ) );
+  }
+  hint.segments.finalize();
+  hint.segments_of    = fingerprint;
+  hint.segments_valid = true;
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+BorderQuery
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::get_border_parameters( const std::vector<adore::math::Point2d>& border, size_t fingerprint,
+                                                                                   const dynamics::VehicleStateDynamic& current_state, BorderHint& hint )
+{
+  BorderQuery query;
+  if( border.size() < 2 )
+    return query;
+
+  const size_t segments = border.size() - 1;
+
+  // Search around the segment of the last cycle first. An intersection nearer than the windowed one lies within its
+  // distance of the vehicle, so its segment has the midpoint within that distance plus the longest half segment. These
+  // segments are searched as well, the result is the nearest intersection of the whole border.
+  if( hint.closest_index > 0 && hint.fingerprint == fingerprint )
+  {
+    size_t hinted = static_cast<size_t>( hint.closest_index - 1 );
+    size_t first  = hinted > static_cast<size_t>( border_search_window ) ? hinted - border_search_window : 0;
+    size_t last   = std::min( segments, hinted + border_search_window + 1 );
+    search_border_segments( border, current_state, first, last, query );
+    if( query.found )
+    {
+      update_segment_grid( border, fingerprint, hint );
+      hint.segments.query( current_state.x, current_state.y, query.distance + hint.segment_reach, border_segment_candidates );
+      for( int candidate : border_segment_candidates )
       {
-        min_distance         = distance;
-        closest_intersection = intersection;
-        closest_index        = i + 1;
-        relative_position    = get_relative_position( p1, p2, car_position );
+        size_t segment = static_cast<size_t>( candidate );
+        if( segment < first || segment >= last )
+          search_border_segments( border, current_state, segment, segment + 1, query );
       }
     }
   }
-  return min_distance;
+  if( !query.found )
+    search_border_segments( border, current_state, 0, segments, query );
+
+  hint.fingerprint   = fingerprint;
+  hint.closest_index = query.found ? query.closest_index : -1;
+  hint.distance      = query.distance;
+  return query;
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-SafetyCorridorPlanner::drive_left( const std::vector<adore::math::Point2d>& border, const double& lateral_distance )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::apply_border_query( const BorderQuery& query )
 {
-  if( relative_position == "left" && lateral_distance > 0.5 )
+  if( !query.found )
+    return;
+  closest_intersection = query.intersection;
+  closest_index        = query.closest_index;
+  relative_position    = query.side;
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::drive_left( const double& lateral_distance )
+{
+  if( relative_position == border_side::left && lateral_distance > 0.5 )
   {
     reference_velocity = 0.0;
   }
-  border_to_plan               = border;
   lateral_distance_from_border = -1.5;
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
 void
-SafetyCorridorPlanner::drive_right( const std::vector<adore::math::Point2d>& border, const double& lateral_distance )
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::drive_right( const double& lateral_distance )
 {
-  if( relative_position == "right" && lateral_distance > 0.5 )
+  if( relative_position == border_side::right && lateral_distance > 0.5 )
   {
     reference_velocity = 0.0;
   }
-  border_to_plan               = border;
   lateral_distance_from_border = 1.5;
 }
 
-std::string
-SafetyCorridorPlanner::get_relative_position( const adore::math::Point2d& p1, const adore::math::Point2d& p2,
-                                              const adore::math::Point2d& carPos )
+template<int ControlPoints, int HorizonMs, typename Precision>
+size_t
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::border_fingerprint( const std::vector<adore::math::Point2d>& border )
+{
+  size_t fingerprint = border.size();
+  for( const auto& point : border )
+  {
+    fingerprint ^= std::hash<double>{}( point.x ) + 0x9e3779b9 + ( fingerprint << 6 ) + ( fingerprint >> 2 );
+    fingerprint ^= std::hash<double>{}( point.y ) + 0x9e3779b9 + ( fingerprint << 6 ) + ( fingerprint >> 2 );
+  }
+  return fingerprint;
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::fit_corridor( const std::vector<double>& progress, const std::vector<double>& border_x,
+                                                                          const std::vector<double>& border_y )
+{
+  size_t              N = progress.size();
+  std::vector<double> w( N, 1.0 );
+  safety_corridor_x = pp.CubicSplineSmoother( progress, border_x, w, 0.9 );
+  safety_corridor_y = pp.CubicSplineSmoother( progress, border_y, w, 0.9 );
+  std::vector<double> x, dx;
+  std::vector<double> y, dy;
+  pp.CubicSplineEvaluation( x, dx, progress, safety_corridor_x );
+  pp.CubicSplineEvaluation( y, dy, progress, safety_corridor_y );
+  std::vector<double> border_heading( N );
+  for( size_t i = 0; i + 1 < N; i++ )
+  {
+    border_heading[i] = std::atan2( dy[i], dx[i] );
+  }
+  border_heading[N - 1]   = border_heading[N - 2];
+  safety_corridor_heading = pp.CubicSplineSmoother( progress, border_heading, w, 0.75 );
+  reference_path.set_path( safety_corridor_x, safety_corridor_y, safety_corridor_heading );
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+border_side
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::get_relative_position( const adore::math::Point2d& p1, const adore::math::Point2d& p2,
+                                                                                   const adore::math::Point2d& carPos )
 {
   // Calculate the cross product
   double cross_product = ( p2.x - p1.x ) * ( carPos.y - p1.y ) - ( p2.y - p1.y ) * ( carPos.x - p1.x );
 
   if( cross_product > 0 )
   {
-    return "left";
+    return border_side::left;
   }
   else if( cross_product < 0 )
   {
-    return "right";
+    return border_side::right;
   }
   else
   {
-    return "on the line";
+    return border_side::on_the_line;
+  }
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::reset_speculative_planners()
+{
+  if( speculative_best >= 0 )
+    std::swap( previous_trajectory, speculative_planners[speculative_best]->previous_trajectory );
+  speculative_planners.clear();
+  speculative_results.clear();
+  speculative_best = -1;
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+const dynamics::Trajectory&
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::kept_trajectory() const
+{
+  if( speculative_best >= 0 )
+    return speculative_planners[speculative_best]->previous_trajectory;
+  return previous_trajectory;
+}
+
+template<int ControlPoints, int HorizonMs, typename Precision>
+const dynamics::Trajectory&
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::plan_speculative( const std::vector<adore::math::Point2d>& left_border,
+                                                                              const std::vector<adore::math::Point2d>& right_border,
+                                                                              const dynamics::VehicleStateDynamic&     current_state )
+{
+  StageClock clock;
+
+  // Candidate k plans on the left border for even k and on the right border for odd k, the second pair starts cold
+  size_t candidate_count = 2 * static_cast<size_t>( speculative_initial_guesses );
+  if( speculative_planners.size() != candidate_count )
+  {
+    reset_speculative_planners();
+    for( size_t k = 0; k < candidate_count; k++ )
+    {
+      auto candidate_parameters                               = parameters;
+      candidate_parameters["speculative_solves"]              = 0.0;
+      candidate_parameters["drive_direction_safety_corridor"] = k % 2 == 0 ? safety_corridor_drive_direction::left
+                                                                           : safety_corridor_drive_direction::right;
+      if( k >= 2 )
+        candidate_parameters["warm_start"] = 0.0;
+
+      auto planner = std::make_unique<SafetyCorridorPlannerT>();
+      planner->set_parameters( candidate_parameters );
+      planner->set_cycle_budget( ocp_solver.real_time_iteration.cycle_budget );
+      planner->limits = limits;
+      speculative_planners.push_back( std::move( planner ) );
+    }
+    speculative_results.resize( candidate_count, nullptr );
+  }
+  if( !speculative_pool || speculative_pool->size() != candidate_count )
+    speculative_pool = std::make_unique<ThreadPool>( candidate_count );
+
+  // Both borders are hashed once for all candidates
+  BorderFingerprints fingerprints;
+  fingerprints.left  = border_fingerprint( left_border );
+  fingerprints.right = border_fingerprint( right_border );
+
+  // OptiNLC cannot be interrupted, every candidate is bounded by the solver time limit instead
+  speculative_pool->parallel_for( candidate_count, [&]( size_t k ) {
+    speculative_results[k] = &speculative_planners[k]->plan_on_borders( left_border, right_border, current_state, fingerprints );
+  } );
+
+  int best = -1;
+  for( size_t k = 0; k < candidate_count; k++ )
+  {
+    const auto& stats = speculative_planners[k]->get_stats();
+    if( stats.fallback || speculative_results[k]->states.empty() )
+      continue;
+    if( best < 0 || stats.final_cost < speculative_planners[best]->get_stats().final_cost )
+      best = static_cast<int>( k );
+  }
+
+  if( best < 0 )
+  {
+    last_stats            = PlannerStats();
+    last_stats.fallback   = true;
+    last_stats.total_time = clock.lap();
+    speculative_winner    = safety_corridor_drive_direction::automatic;
+    return kept_trajectory();
   }
+
+  last_stats              = speculative_planners[best]->get_stats();
+  last_stats.total_time   = clock.lap();
+  ocp_solver.warm_started = last_stats.solve.warm_started;
+  speculative_winner      = best % 2 == 0 ? safety_corridor_drive_direction::left : safety_corridor_drive_direction::right;
+  speculative_best        = best;
+  return *speculative_results[best];
 }
 
+template<int ControlPoints, int HorizonMs, typename Precision>
+void
+SafetyCorridorPlannerT<ControlPoints, HorizonMs, Precision>::set_cycle_budget( double cycle_budget )
+{
+  ocp_solver.set_cycle_budget( cycle_budget );
+  for( auto& planner : speculative_planners )
+    planner->set_cycle_budget( cycle_budget );
+}
+
+// Horizon variants, see the aliases in the header
+template class SafetyCorridorPlannerT<20, 2000>;
+template class SafetyCorridorPlannerT<30, 3000>;
+template class SafetyCorridorPlannerT<40, 4000>;
+
+// Float solver variants, see planner_precision.hpp
+template class SafetyCorridorPlannerT<30, 3000, FloatSolverPrecision>;
+template class SafetyCorridorPlannerT<30, 3000, SinglePrecision>;
+
 } // namespace planner
 } // namespace adore
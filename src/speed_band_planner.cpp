@@ -0,0 +1,175 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Sanath Himasekhar Konthala
+ ********************************************************************************/
+#include "planning/speed_band_planner.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+SpeedBandTrajectoryPlanner::SpeedBandTrajectoryPlanner()
+{
+  set_lane_attribute_cache( std::make_shared<LaneAttributeCache>() );
+}
+
+void
+SpeedBandTrajectoryPlanner::set_parameters( const std::map<std::string, double>& params )
+{
+  low_speed_planner.set_parameters( params );
+  medium_speed_planner.set_parameters( params );
+  high_speed_planner.set_parameters( params );
+
+  for( const auto& [name, value] : params )
+  {
+    if( name == "low_speed_threshold" )
+      low_speed_threshold = value;
+    if( name == "high_speed_threshold" )
+      high_speed_threshold = value;
+    if( name == "speed_band_hysteresis" )
+      speed_band_hysteresis = value;
+  }
+}
+
+void
+SpeedBandTrajectoryPlanner::update_speed_band( double speed )
+{
+  double low_exit  = low_speed_threshold + speed_band_hysteresis;
+  double high_exit = high_speed_threshold - speed_band_hysteresis;
+
+  switch( speed_band )
+  {
+    case SpeedBand::low:
+      if( speed > high_speed_threshold )
+        speed_band = SpeedBand::high;
+      else if( speed > low_exit )
+        speed_band = SpeedBand::medium;
+      break;
+    case SpeedBand::medium:
+      if( speed < low_speed_threshold )
+        speed_band = SpeedBand::low;
+      else if( speed > high_speed_threshold )
+        speed_band = SpeedBand::high;
+      break;
+    case SpeedBand::high:
+      if( speed < low_speed_threshold )
+        speed_band = SpeedBand::low;
+      else if( speed < high_exit )
+        speed_band = SpeedBand::medium;
+      break;
+  }
+}
+
+dynamics::Trajectory
+SpeedBandTrajectoryPlanner::plan_trajectory( const map::Route& latest_route, const dynamics::VehicleStateDynamic& current_state,
+                                             const map::Map& latest_map, const dynamics::TrafficParticipantSet& traffic_participants )
+{
+  dynamics::Trajectory trajectory;
+  plan_trajectory_into( trajectory, latest_route, current_state, latest_map, traffic_participants );
+  return trajectory;
+}
+
+void
+SpeedBandTrajectoryPlanner::plan_trajectory_into( dynamics::Trajectory& trajectory, const map::Route& latest_route,
+                                                  const dynamics::VehicleStateDynamic& current_state, const map::Map& latest_map,
+                                                  const dynamics::TrafficParticipantSet& traffic_participants )
+{
+  SpeedBand previous_band = speed_band;
+  update_speed_band( current_state.vx );
+
+  // Each variant keeps its own previous solution. The one taking over has been idle, so its solution is stale and is
+  // dropped, otherwise a bad first solve would fall back to it.
+  if( speed_band != previous_band )
+  {
+    switch( speed_band )
+    {
+      case SpeedBand::low:
+        low_speed_planner.reset_solution();
+        break;
+      case SpeedBand::high:
+        high_speed_planner.reset_solution();
+        break;
+      default:
+        medium_speed_planner.reset_solution();
+        break;
+    }
+  }
+
+  switch( speed_band )
+  {
+    case SpeedBand::low:
+      low_speed_planner.plan_trajectory_into( trajectory, latest_route, current_state, latest_map, traffic_participants );
+      break;
+    case SpeedBand::high:
+      high_speed_planner.plan_trajectory_into( trajectory, latest_route, current_state, latest_map, traffic_participants );
+      break;
+    default:
+      medium_speed_planner.plan_trajectory_into( trajectory, latest_route, current_state, latest_map, traffic_participants );
+      break;
+  }
+}
+
+void
+SpeedBandTrajectoryPlanner::set_cycle_budget( double cycle_budget )
+{
+  low_speed_planner.set_cycle_budget( cycle_budget );
+  medium_speed_planner.set_cycle_budget( cycle_budget );
+  high_speed_planner.set_cycle_budget( cycle_budget );
+}
+
+void
+SpeedBandTrajectoryPlanner::set_lane_attribute_cache( const std::shared_ptr<LaneAttributeCache>& cache )
+{
+  low_speed_planner.set_lane_attribute_cache( cache );
+  medium_speed_planner.set_lane_attribute_cache( cache );
+  high_speed_planner.set_lane_attribute_cache( cache );
+}
+
+void
+SpeedBandTrajectoryPlanner::set_participant_filter( const std::vector<int>* ids, std::optional<int> ignored_id )
+{
+  low_speed_planner.set_participant_filter( ids, ignored_id );
+  medium_speed_planner.set_participant_filter( ids, ignored_id );
+  high_speed_planner.set_participant_filter( ids, ignored_id );
+}
+
+const SolveReport&
+SpeedBandTrajectoryPlanner::get_solve_report() const
+{
+  switch( speed_band )
+  {
+    case SpeedBand::low:
+      return low_speed_planner.get_solve_report();
+    case SpeedBand::high:
+      return high_speed_planner.get_solve_report();
+    default:
+      return medium_speed_planner.get_solve_report();
+  }
+}
+
+const PlannerStats&
+SpeedBandTrajectoryPlanner::get_stats() const
+{
+  switch( speed_band )
+  {
+    case SpeedBand::low:
+      return low_speed_planner.get_stats();
+    case SpeedBand::high:
+      return high_speed_planner.get_stats();
+    default:
+      return medium_speed_planner.get_stats();
+  }
+}
+
+} // namespace planner
+} // namespace adore
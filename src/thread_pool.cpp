@@ -0,0 +1,113 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include "planning/thread_pool.hpp"
+
+namespace adore
+{
+namespace planner
+{
+
+ThreadPool::ThreadPool( size_t number_of_threads )
+{
+  for( size_t i = 1; i < number_of_threads; ++i )
+  {
+    workers.emplace_back( [this]() { worker_loop(); } );
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    stop = true;
+  }
+  work_available.notify_all();
+  for( auto& worker : workers )
+  {
+    worker.join();
+  }
+}
+
+size_t
+ThreadPool::size() const
+{
+  return workers.size() + 1;
+}
+
+void
+ThreadPool::parallel_for( size_t count, const std::function<void( size_t )>& task )
+{
+  if( workers.empty() || count < 2 )
+  {
+    for( size_t i = 0; i < count; ++i )
+    {
+      task( i );
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    current_task     = &task;
+    task_count       = count;
+    finished_workers = 0;
+    next_index.store( 0 );
+    ++generation;
+  }
+  work_available.notify_all();
+
+  run_tasks();
+
+  // Every worker has to pass through the generation before the task goes out of scope
+  std::unique_lock<std::mutex> lock( mutex );
+  work_done.wait( lock, [this]() { return finished_workers == workers.size(); } );
+  current_task = nullptr;
+}
+
+void
+ThreadPool::run_tasks()
+{
+  for( size_t i = next_index.fetch_add( 1 ); i < task_count; i = next_index.fetch_add( 1 ) )
+  {
+    ( *current_task )( i );
+  }
+}
+
+void
+ThreadPool::worker_loop()
+{
+  size_t seen_generation = 0;
+  while( true )
+  {
+    {
+      std::unique_lock<std::mutex> lock( mutex );
+      work_available.wait( lock, [&]() { return stop || generation != seen_generation; } );
+      if( stop )
+        return;
+      seen_generation = generation;
+    }
+
+    run_tasks();
+
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      ++finished_workers;
+    }
+    work_done.notify_one();
+  }
+}
+
+} // namespace planner
+} // namespace adore
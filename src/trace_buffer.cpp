@@ -0,0 +1,205 @@
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include "planning/trace_buffer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace adore
+{
+namespace planner
+{
+
+const char*
+trace_event_name( TraceEvent event )
+{
+  switch( event )
+  {
+    case TraceEvent::reference_velocity:
+      return "reference velocity";
+    case TraceEvent::distance_to_object:
+      return "distance to object";
+    case TraceEvent::distance_to_goal:
+      return "distance to goal";
+    case TraceEvent::distance_moved:
+      return "distance moved";
+    case TraceEvent::invalid_route:
+      return "end of route or invalid route received";
+    case TraceEvent::no_border_intersection:
+      return "no intersection with the safety corridor border";
+    case TraceEvent::warm_start_unavailable:
+      return "warm start unavailable, solving from current state";
+    case TraceEvent::empty_route_points:
+      return "Error: route_points is empty.";
+    case TraceEvent::insufficient_points_after_filtering:
+      return "Error: Insufficient points after filtering.";
+    case TraceEvent::insufficient_points_after_spline:
+      return "Error: Insufficient points after spline_into_start.";
+    case TraceEvent::invalid_distances:
+      return "Error: Invalid distances computed.";
+    case TraceEvent::non_finite_curvature:
+      return "Error: Non-finite value in curvatures.";
+    case TraceEvent::invalid_speeds:
+      return "Error: Invalid speeds computed.";
+    case TraceEvent::non_finite_speed:
+      return "Error: Non-finite value in speeds.";
+    case TraceEvent::invalid_times:
+      return "Error: Invalid times computed.";
+    case TraceEvent::empty_trajectory:
+      return "Error: Empty trajectory generated.";
+  }
+  return "unknown trace event";
+}
+
+void
+write_trace_record( std::ostream& stream, const TraceRecord& record )
+{
+  stream << trace_event_name( record.event );
+  switch( record.event )
+  {
+    case TraceEvent::reference_velocity:
+    case TraceEvent::distance_to_object:
+    case TraceEvent::distance_to_goal:
+    case TraceEvent::distance_moved:
+      stream << ": " << record.value;
+      break;
+    case TraceEvent::insufficient_points_after_filtering:
+    case TraceEvent::insufficient_points_after_spline:
+    case TraceEvent::invalid_distances:
+      stream << " Size: " << record.value;
+      break;
+    case TraceEvent::invalid_speeds:
+      stream << " Speeds size: " << record.value << ", Distances size: " << record.detail;
+      break;
+    case TraceEvent::invalid_times:
+      stream << " Times size: " << record.value << ", Distances size: " << record.detail;
+      break;
+    default:
+      break;
+  }
+  stream << '\n';
+}
+
+TraceBuffer::TraceBuffer( size_t capacity )
+{
+  // Power of two, so the ring index is a mask of the running counter
+  size_t size = 1;
+  while( size < std::max( capacity, size_t{ 2 } ) )
+    size <<= 1;
+  records.resize( size );
+  mask = size - 1;
+}
+
+TraceBuffer::TraceBuffer( const TraceBuffer& other ) :
+  records( other.records.size() ),
+  mask( other.mask ),
+  echo( other.echo )
+{}
+
+TraceBuffer&
+TraceBuffer::operator=( const TraceBuffer& other )
+{
+  if( this != &other )
+  {
+    records.assign( other.records.size(), TraceRecord() );
+    mask = other.mask;
+    echo = other.echo;
+    head.store( 0 );
+    tail.store( 0 );
+    dropped.store( 0 );
+  }
+  return *this;
+}
+
+size_t
+TraceBuffer::drain( const std::function<void( const TraceRecord& )>& sink )
+{
+  size_t current_tail = tail.load( std::memory_order_relaxed );
+  size_t current_head = head.load( std::memory_order_acquire );
+  for( size_t i = current_tail; i != current_head; ++i )
+    sink( records[i & mask] );
+  tail.store( current_head, std::memory_order_release );
+  return current_head - current_tail;
+}
+
+size_t
+TraceBuffer::dump( std::ostream& stream )
+{
+  return drain( [&stream]( const TraceRecord& record ) { write_trace_record( stream, record ); } );
+}
+
+void
+TraceBuffer::write_to_stderr( const TraceRecord& record ) const
+{
+  write_trace_record( std::cerr, record );
+}
+
+TraceConsumer::TraceConsumer( std::function<void( const TraceRecord& )> sink, std::chrono::milliseconds period ) :
+  sink( std::move( sink ) ),
+  period( period )
+{
+  worker = std::thread( [this]() { consumer_loop(); } );
+}
+
+TraceConsumer::~TraceConsumer()
+{
+  {
+    std::lock_guard<std::mutex> lock( mutex );
+    stop = true;
+  }
+  wake_up.notify_all();
+  worker.join();
+  flush();
+}
+
+void
+TraceConsumer::add( TraceBuffer& buffer )
+{
+  std::lock_guard<std::mutex> lock( mutex );
+  buffers.push_back( &buffer );
+}
+
+void
+TraceConsumer::remove( TraceBuffer& buffer )
+{
+  std::lock_guard<std::mutex> lock( mutex );
+  auto                        it = std::find( buffers.begin(), buffers.end(), &buffer );
+  if( it == buffers.end() )
+    return;
+  ( *it )->drain( sink );
+  buffers.erase( it );
+}
+
+void
+TraceConsumer::flush()
+{
+  std::lock_guard<std::mutex> lock( mutex );
+  for( auto* buffer : buffers )
+    buffer->drain( sink );
+}
+
+void
+TraceConsumer::consumer_loop()
+{
+  std::unique_lock<std::mutex> lock( mutex );
+  while( !stop )
+  {
+    wake_up.wait_for( lock, period, [this]() { return stop; } );
+    for( auto* buffer : buffers )
+      buffer->drain( sink );
+  }
+}
+
+} // namespace planner
+} // namespace adore
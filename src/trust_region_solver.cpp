@@ -1,280 +1,576 @@
-// /********************************************************************************
-//  * Copyright (C) 2017-2025 German Aerospace Center (DLR).
-//  * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
-//  *
-//  * This program and the accompanying materials are made available under the
-//  * terms of the Eclipse Public License 2.0 which is available at
-//  * http://www.eclipse.org/legal/epl-2.0.
-//  *
-//  * SPDX-License-Identifier: EPL-2.0
-//  *
-//  * Contributors:
-//  *    Giovanni Lucente
-//  *    Marko Mizdrak
-//  ********************************************************************************/
-// #include "planning/trust_region_solver.hpp"
-
-// namespace adore
-// {
-// namespace planner
-// {
-
-
-// void
-// TrustRegionSolver::initialize()
-// {
-//   hessians.resize( num_agents );
-//   gradients.resize( num_agents );
-//   trust_deltas.resize( num_agents, delta_initial );
-
-// for( size_t i = 0; i < num_agents; ++i )
-// {
-//   size_t control_size = agents[i].controls.size() * 2; // Each control has steering_angle and acceleration
-//   hessians[i]         = Eigen::MatrixXd::Identity( control_size, control_size );
-//   gradients[i]        = Eigen::VectorXd::Zero( control_size );
-// }
-// }
-
-// bool
-// TrustRegionSolver::convergence( const Eigen::VectorXd& gradient )
-// {
-//   return gradient.norm() < convergence_tolerance;
-// }
-
-// void
-// TrustRegionSolver::compute_cost_and_gradient( Agent& agent, size_t agent_index )
-// {
-//   double control_effort_weight = 1.0;
-//   double collision_weight      = 1000.0; // High penalty for collisions
-
-// double cost         = 0.0;
-// size_t num_states   = agent.trajectory.states.size();
-// size_t control_size = num_states * 2; // Two control inputs per state
-
-// // Initialize gradient
-// Eigen::VectorXd gradient = Eigen::VectorXd::Zero( control_size );
-
-// // For each time step
-// for( size_t i = 0; i < num_states; ++i )
-// {
-//   dynamics::VehicleCommand& command = agent.controls[i];
-
-// // Control effort term
-// double steering_angle  = command.steering_angle;
-// double acceleration    = command.acceleration;
-// double control_effort  = control_effort_weight * ( steering_angle * steering_angle + acceleration * acceleration );
-// cost                  += control_effort;
-
-// // Gradient of control effort
-// gradient( 2 * i )     += 2 * control_effort_weight * steering_angle;
-// gradient( 2 * i + 1 ) += 2 * control_effort_weight * acceleration;
-
-// // Collision avoidance
-// dynamics::VehicleStateDynamic& curr_state = agent.trajectory.states[i];
-
-// for( size_t j = 0; j < num_agents; ++j )
-// {
-//   if( j == agent_index )
-//     continue;
-
-// dynamics::VehicleStateDynamic& other_state = agents[j].trajectory.states[i];
-
-// double dx               = curr_state.x - other_state.x;
-// double dy               = curr_state.y - other_state.y;
-// double distance_squared = dx * dx + dy * dy;
-// double safe_distance    = 5.0; // Minimum safe distance
-
-// if( distance_squared < safe_distance * safe_distance )
-// {
-//   // Penalize proximity
-//   double collision_penalty  = collision_weight / ( distance_squared + 1e-6 );
-//   cost                     += collision_penalty;
-
-// // Approximate gradient calculation
-// double grad_coeff = -2.0 * collision_weight / ( ( distance_squared + 1e-6 ) * ( distance_squared + 1e-6 ) );
-
-// // Compute partial derivatives (simplified for demonstration)
-// gradient( 2 * i )     += grad_coeff * dx;
-// gradient( 2 * i + 1 ) += grad_coeff * dy;
-// }
-// }
-// }
-
-// // Set the agent's cost and gradient
-// agent.cost             = cost;
-// gradients[agent_index] = gradient;
-// }
-
-// void
-// TrustRegionSolver::update_trust_region( Agent& agent, size_t agent_index, const Eigen::VectorXd& step, double cost_reduction_ratio )
-// {
-//   if( cost_reduction_ratio < 0.25 )
-//   {
-//     trust_deltas[agent_index] *= 0.5;
-//   }
-//   else if( cost_reduction_ratio > 0.75 && step.norm() > 0.8 * trust_deltas[agent_index] )
-//   {
-//     trust_deltas[agent_index] = std::min( 2.0 * trust_deltas[agent_index], delta_initial );
-//   }
-// }
-
-// Eigen::VectorXd
-// TrustRegionSolver::solve_quadratic_subproblem( const Eigen::MatrixXd& hessian, const Eigen::VectorXd& gradient, double delta )
-// {
-//   // Use the scaled gradient method for simplicity
-//   Eigen::VectorXd p      = -gradient;
-//   double          norm_p = p.norm();
-
-// if( norm_p <= delta )
-// {
-//   return p;
-// }
-// else
-// {
-//   return -( delta / norm_p ) * gradient;
-// }
-// }
-
-// void
-// TrustRegionSolver::update_hessian( Agent& agent, size_t agent_index, const Eigen::VectorXd& s, const Eigen::VectorXd& y )
-// {
-//   Eigen::VectorXd Bs         = hessians[agent_index] * s;
-//   Eigen::VectorXd y_minus_Bs = y - Bs;
-
-// double denominator = y_minus_Bs.transpose() * s;
-// if( std::abs( denominator ) > 1e-8 )
-// {
-//   hessians[agent_index] += ( y_minus_Bs * y_minus_Bs.transpose() ) / denominator;
-// }
-// }
-
-// Eigen::VectorXd
-// controls_to_eigen( const std::vector<dynamics::VehicleCommand>& controls )
-// {
-//   size_t          num_controls = controls.size();
-//   Eigen::VectorXd control_vector( num_controls * 2 );
-
-// for( size_t i = 0; i < num_controls; ++i )
-// {
-//   control_vector( 2 * i )     = controls[i].steering_angle;
-//   control_vector( 2 * i + 1 ) = controls[i].acceleration;
-// }
-// return control_vector;
-// }
-
-// void
-// eigen_to_controls( const Eigen::VectorXd& control_vector, std::vector<dynamics::VehicleCommand>& controls )
-// {
-//   size_t num_controls = controls.size();
-
-// for( size_t i = 0; i < num_controls; ++i )
-// {
-//   controls[i].steering_angle = control_vector( 2 * i );
-//   controls[i].acceleration   = control_vector( 2 * i + 1 );
-// }
-// }
-
-// void
-// TrustRegionSolver::solve()
-// {
-//   bool all_converged = false;
-//   int  iteration     = 0;
-
-// // Initialize old gradients vector
-// old_gradients.resize( num_agents );
-
-// while( !all_converged && iteration < max_iterations )
-// {
-//   all_converged = true;
-
-// // First Loop: Compute proposed control updates independently for each agent
-// std::vector<Eigen::VectorXd> steps( num_agents );
-// std::vector<double>          old_costs( num_agents );
-// std::vector<Eigen::VectorXd> old_control_vectors( num_agents );
-
-// for( size_t i = 0; i < num_agents; ++i )
-// {
-//   Agent& agent = agents[i];
-
-// // Compute cost and gradient
-// compute_cost_and_gradient( agent, i );
-
-// // Save old gradient for Hessian update later
-// old_gradients[i] = gradients[i];
-
-// // Check convergence
-// if( !convergence( gradients[i] ) )
-// {
-//   all_converged = false;
-
-// // Save old controls and cost
-// old_control_vectors[i] = controls_to_eigen( agent.controls );
-// old_costs[i]           = agent.cost;
-
-// // Solve quadratic subproblem independently
-// steps[i] = solve_quadratic_subproblem( hessians[i], gradients[i], trust_deltas[i] );
-// }
-// else
-// {
-// // Agent has converged; set step to zero
-// steps[i] = Eigen::VectorXd::Zero( gradients[i].size() );
-// }
-// }
-
-// // Second Loop: Apply updates, evaluate new cost, update Hessians
-// for( size_t i = 0; i < num_agents; ++i )
-// {
-//   Agent& agent = agents[i];
-
-// if( steps[i].norm() > 0 )
-// {
-//   // Update control vector
-//   Eigen::VectorXd new_control_vector = old_control_vectors[i] + steps[i];
-
-// // Update agent controls from Eigen vector
-// eigen_to_controls( new_control_vector, agent.controls );
-
-// // Enforce command limits
-// for( auto& command : agent.controls )
-// {
-//   command.clamp_within_limits( agent.command_limits );
-// }
-
-// // Update trajectory
-// agent.update_trajectory_from_controls( dt, wheelbase );
-
-// // Compute new cost and gradient
-// compute_cost_and_gradient( agent, i );
-
-// // Actual reduction
-// double actual_reduction = old_costs[i] - agent.cost;
-
-// // Predicted reduction
-// double predicted_reduction = -gradients[i].dot( steps[i] ) - 0.5 * steps[i].dot( hessians[i] * steps[i] );
-// // Compute cost reduction ratio
-// double cost_reduction_ratio = actual_reduction / ( predicted_reduction + 1e-8 ); // Add epsilon to avoid division by zero
-
-// // Update trust region
-// update_trust_region( agent, i, steps[i], cost_reduction_ratio );
-
-// // Update Hessian approximation
-// Eigen::VectorXd y = gradients[i] - old_gradients[i];
-// update_hessian( agent, i, steps[i], y );
-// }
-// }
-
-// ++iteration;
-// }
-
-// if( all_converged )
-// {
-//   std::cerr << "Converged in " << iteration << " iterations." << std::endl;
-// }
-// else
-// {
-//   std::cerr << "Reached maximum iterations without full convergence." << std::endl;
-// }
-// }
-
-// } // namespace planner
-// } // namespace adore
+/********************************************************************************
+ * Copyright (C) 2017-2025 German Aerospace Center (DLR).
+ * Eclipse ADORe, Automated Driving Open Research https://eclipse.org/adore
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0.
+ *
+ * SPDX-License-Identifier: EPL-2.0
+ *
+ * Contributors:
+ *    Giovanni Lucente
+ *    Marko Mizdrak
+ ********************************************************************************/
+#include "planning/trust_region_solver.hpp"
+
+#include <cmath>
+
+#include <algorithm>
+#include <limits>
+
+namespace adore
+{
+namespace planner
+{
+
+TrustRegionSolver::TrustRegionSolver() = default;
+
+void
+TrustRegionSolver::set_parameters( const std::map<std::string, double>& params )
+{
+  for( const auto& [name, value] : params )
+  {
+    if( name == "effort_weight" )
+      effort_weight = value;
+    else if( name == "tracking_weight" )
+      tracking_weight = value;
+    else if( name == "collision_weight" )
+      collision_weight = value;
+    else if( name == "safe_distance" )
+      safe_distance = value;
+    else if( name == "pair_margin" )
+      pair_margin = value;
+    else if( name == "broad_phase_window" )
+      broad_phase_window = std::max( static_cast<int>( value ), 1 );
+    else if( name == "convergence_tolerance" )
+      convergence_tolerance = value;
+    else if( name == "max_iterations" )
+      max_iterations = static_cast<int>( value );
+    else if( name == "delta_initial" )
+      delta_initial = value;
+    else if( name == "delta_max" )
+      delta_max = value;
+    else if( name == "eta" )
+      eta = value;
+    else if( name == "dt" )
+      dt = value;
+    else if( name == "number_of_threads" )
+      number_of_threads = std::max( static_cast<int>( value ), 1 );
+  }
+}
+
+void
+TrustRegionSolver::solve( dynamics::TrafficParticipantSet& traffic_participant_set )
+{
+  report = TrustRegionReport();
+  load_agents( traffic_participant_set );
+  for( size_t k = 0; k < participants.size(); ++k )
+    report.optimized_agents += optimized[k];
+  if( report.optimized_agents == 0 )
+    return;
+
+  if( number_of_threads > 1 && ( !thread_pool || thread_pool->size() != static_cast<size_t>( number_of_threads ) ) )
+  {
+    thread_pool = std::make_unique<ThreadPool>( number_of_threads );
+  }
+
+  for( int iteration = 0; iteration < max_iterations; ++iteration )
+  {
+    build_collision_pairs();
+
+    // Every agent steps against the positions of the last iteration and only writes its own storage
+    if( number_of_threads > 1 )
+      thread_pool->parallel_for( participants.size(), [this]( size_t k ) { step_agent( k ); } );
+    else
+      for( size_t k = 0; k < participants.size(); ++k )
+        step_agent( k );
+
+    bool all_converged = true;
+    report.total_cost  = 0.0;
+    for( size_t k = 0; k < participants.size(); ++k )
+    {
+      if( !optimized[k] )
+        continue;
+      all_converged          = all_converged && agent_converged[k];
+      report.total_cost     += agent_cost[k];
+      report.accepted_steps += agent_accepted[k];
+    }
+    report.iterations = iteration + 1;
+
+    position_x.swap( next_position_x );
+    position_y.swap( next_position_y );
+
+    if( all_converged )
+    {
+      report.converged = true;
+      break;
+    }
+  }
+
+  store_agents();
+}
+
+void
+TrustRegionSolver::load_agents( dynamics::TrafficParticipantSet& traffic_participant_set )
+{
+  participants.clear();
+  optimized.clear();
+  horizon   = 0;
+  step_time = dt;
+
+  bool step_time_found = false;
+  for( auto& [id, participant] : traffic_participant_set.participants )
+  {
+    bool has_prediction = participant.trajectory && participant.trajectory->states.size() >= 2;
+    participants.push_back( &participant );
+    optimized.push_back( has_prediction );
+    if( !has_prediction )
+      continue;
+
+    const auto& states = participant.trajectory->states;
+    if( !step_time_found && states[1].time > states[0].time )
+    {
+      step_time       = states[1].time - states[0].time;
+      step_time_found = true;
+    }
+  }
+
+  // The model integrates every agent with step_time, predictions sampled otherwise are not optimized
+  for( size_t k = 0; k < participants.size(); ++k )
+  {
+    if( !optimized[k] )
+      continue;
+    const auto&  states    = participants[k]->trajectory->states;
+    const double tolerance = 1e-3 * step_time;
+    for( size_t i = 1; i < states.size() && optimized[k]; ++i )
+      optimized[k] = std::abs( states[i].time - states[i - 1].time - step_time ) <= tolerance;
+    if( !optimized[k] )
+    {
+      report.skipped_agents++;
+      continue;
+    }
+    horizon = std::max( horizon, states.size() );
+  }
+
+  // Static obstacles occupy their position over the whole horizon
+  size_t agent_count = participants.size();
+  offset.resize( agent_count );
+  steps.resize( agent_count );
+  wheelbase.resize( agent_count );
+  size_t total = 0;
+  for( size_t k = 0; k < agent_count; ++k )
+  {
+    offset[k]    = total;
+    steps[k]     = optimized[k] ? participants[k]->trajectory->states.size() : std::max<size_t>( horizon, 1 );
+    wheelbase[k] = participants[k]->physical_parameters.wheelbase == 0 ? 0.5 : participants[k]->physical_parameters.wheelbase;
+    total       += steps[k];
+  }
+
+  trust_radius.assign( agent_count, delta_initial );
+  agent_cost.assign( agent_count, 0.0 );
+  agent_converged.assign( agent_count, 0 );
+  agent_accepted.assign( agent_count, 0 );
+
+  for( auto* field : { &reference_x, &reference_y, &position_x, &position_y, &yaw, &speed, &steering, &steering_command, &acceleration,
+                       &gradient_steering, &gradient_acceleration, &step_steering, &step_acceleration, &trial_x, &trial_y, &trial_yaw,
+                       &trial_speed, &trial_steering, &trial_steering_command, &trial_acceleration, &trial_gradient_steering,
+                       &trial_gradient_acceleration, &cost_gradient_x, &cost_gradient_y } )
+    field->assign( total, 0.0 );
+  hessian.assign( total, HessianBlock::Identity() );
+
+  for( size_t k = 0; k < agent_count; ++k )
+  {
+    const size_t o = offset[k];
+    const size_t n = steps[k];
+    if( !optimized[k] )
+    {
+      std::fill( position_x.begin() + o, position_x.begin() + o + n, participants[k]->state.x );
+      std::fill( position_y.begin() + o, position_y.begin() + o + n, participants[k]->state.y );
+      continue;
+    }
+
+    // The first predicted state is fixed, the controls are initialized from the prediction
+    const auto& states = participants[k]->trajectory->states;
+    yaw[o]             = states[0].yaw_angle;
+    speed[o]           = states[0].vx;
+    steering[o]        = states[0].steering_angle;
+    for( size_t i = 0; i < n; ++i )
+    {
+      reference_x[o + i] = states[i].x;
+      reference_y[o + i] = states[i].y;
+    }
+    for( size_t i = 0; i + 1 < n; ++i )
+    {
+      steering_command[o + i] = states[i + 1].steering_angle;
+      acceleration[o + i]     = states[i + 1].ax;
+    }
+    rollout( k, steering_command.data() + o, acceleration.data() + o, position_x.data() + o, position_y.data() + o, yaw.data() + o,
+             speed.data() + o, steering.data() + o );
+  }
+
+  next_position_x = position_x;
+  next_position_y = position_y;
+}
+
+void
+TrustRegionSolver::store_agents() const
+{
+  for( size_t k = 0; k < participants.size(); ++k )
+  {
+    if( !optimized[k] )
+      continue;
+
+    auto&        states = participants[k]->trajectory->states;
+    const size_t o      = offset[k];
+    for( size_t i = 1; i < steps[k]; ++i )
+    {
+      auto& state          = states[i];
+      state.x              = position_x[o + i];
+      state.y              = position_y[o + i];
+      state.yaw_angle      = yaw[o + i];
+      state.vx             = speed[o + i];
+      state.steering_angle = steering[o + i];
+      state.ax             = acceleration[o + i - 1];
+      state.yaw_rate       = speed[o + i] * std::tan( steering[o + i] ) / wheelbase[k];
+    }
+  }
+}
+
+void
+TrustRegionSolver::build_collision_pairs()
+{
+  pairs.clear();
+  const size_t agent_count = participants.size();
+  const size_t window      = static_cast<size_t>( std::max( broad_phase_window, 1 ) );
+  const double padding     = 0.5 * ( safe_distance + pair_margin );
+
+  for( size_t first = 0; first < horizon; first += window )
+  {
+    const size_t last = std::min( first + window, horizon ) - 1;
+
+    boxes.clear();
+    for( size_t k = 0; k < agent_count; ++k )
+    {
+      if( steps[k] <= first )
+        continue;
+      const size_t o   = offset[k];
+      const size_t end = std::min( last, steps[k] - 1 );
+      BoundingBox  box{ std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(), std::numeric_limits<double>::max(),
+                       std::numeric_limits<double>::lowest(), static_cast<uint32_t>( k ) };
+      for( size_t i = first; i <= end; ++i )
+      {
+        box.min_x = std::min( box.min_x, position_x[o + i] );
+        box.max_x = std::max( box.max_x, position_x[o + i] );
+        box.min_y = std::min( box.min_y, position_y[o + i] );
+        box.max_y = std::max( box.max_y, position_y[o + i] );
+      }
+      box.min_x -= padding;
+      box.max_x += padding;
+      box.min_y -= padding;
+      box.max_y += padding;
+      boxes.push_back( box );
+    }
+
+    // Sort and sweep along x, only boxes that overlap in x are tested in y
+    std::sort( boxes.begin(), boxes.end(), []( const BoundingBox& a, const BoundingBox& b ) { return a.min_x < b.min_x; } );
+    for( size_t a = 0; a < boxes.size(); ++a )
+    {
+      for( size_t b = a + 1; b < boxes.size() && boxes[b].min_x <= boxes[a].max_x; ++b )
+      {
+        if( boxes[b].min_y > boxes[a].max_y || boxes[b].max_y < boxes[a].min_y )
+          continue;
+        uint32_t agent_a = boxes[a].agent;
+        uint32_t agent_b = boxes[b].agent;
+        if( !optimized[agent_a] && !optimized[agent_b] )
+          continue;
+        uint32_t end = static_cast<uint32_t>( std::min( { last, steps[agent_a] - 1, steps[agent_b] - 1 } ) );
+        pairs.push_back( { agent_a, Neighbor{ agent_b, static_cast<uint32_t>( first ), end } } );
+        pairs.push_back( { agent_b, Neighbor{ agent_a, static_cast<uint32_t>( first ), end } } );
+      }
+    }
+  }
+  report.collision_pairs = pairs.size() / 2;
+
+  // Counting sort by agent into one contiguous neighbor list
+  neighbor_offset.assign( agent_count + 1, 0 );
+  for( const auto& [agent, neighbor] : pairs )
+    neighbor_offset[agent + 1]++;
+  for( size_t k = 0; k < agent_count; ++k )
+    neighbor_offset[k + 1] += neighbor_offset[k];
+  neighbors.resize( pairs.size() );
+  neighbor_fill.assign( neighbor_offset.begin(), neighbor_offset.end() - 1 );
+  for( const auto& [agent, neighbor] : pairs )
+    neighbors[neighbor_fill[agent]++] = neighbor;
+}
+
+void
+TrustRegionSolver::step_agent( size_t k )
+{
+  agent_accepted[k] = 0;
+  if( !optimized[k] )
+    return;
+
+  const size_t o        = offset[k];
+  const size_t n        = steps[k];
+  const size_t controls = n - 1;
+
+  // Cost and gradient at the current controls, the other agents moved in the last iteration
+  double cost = evaluate_cost( k, position_x.data() + o, position_y.data() + o, steering_command.data() + o, acceleration.data() + o,
+                               cost_gradient_x.data() + o, cost_gradient_y.data() + o );
+  backpropagate( k, yaw.data() + o, speed.data() + o, steering.data() + o, steering_command.data() + o, acceleration.data() + o,
+                 cost_gradient_x.data() + o, cost_gradient_y.data() + o, gradient_steering.data() + o, gradient_acceleration.data() + o );
+  agent_cost[k] = cost;
+
+  std::copy( position_x.begin() + o, position_x.begin() + o + n, next_position_x.begin() + o );
+  std::copy( position_y.begin() + o, position_y.begin() + o + n, next_position_y.begin() + o );
+
+  double gradient_norm = 0.0;
+  for( size_t i = 0; i < controls; ++i )
+    gradient_norm += gradient_steering[o + i] * gradient_steering[o + i] + gradient_acceleration[o + i] * gradient_acceleration[o + i];
+  agent_converged[k] = std::sqrt( gradient_norm ) < convergence_tolerance;
+  if( agent_converged[k] )
+    return;
+
+  solve_subproblem( k );
+
+  // Trial controls within the command limits, the step is shortened to what was applied
+  double predicted_reduction = 0.0;
+  double step_norm           = 0.0;
+  for( size_t i = 0; i < controls; ++i )
+  {
+    trial_steering_command[o + i] = std::clamp( steering_command[o + i] + step_steering[o + i], -limits.max_steering_angle,
+                                                limits.max_steering_angle );
+    trial_acceleration[o + i]     = std::clamp( acceleration[o + i] + step_acceleration[o + i], limits.min_acceleration,
+                                                limits.max_acceleration );
+    step_steering[o + i]          = trial_steering_command[o + i] - steering_command[o + i];
+    step_acceleration[o + i]      = trial_acceleration[o + i] - acceleration[o + i];
+
+    Eigen::Vector2d step( step_steering[o + i], step_acceleration[o + i] );
+    Eigen::Vector2d gradient( gradient_steering[o + i], gradient_acceleration[o + i] );
+    predicted_reduction -= gradient.dot( step ) + 0.5 * step.dot( hessian[o + i] * step );
+    step_norm           += step.squaredNorm();
+  }
+  step_norm = std::sqrt( step_norm );
+
+  rollout( k, trial_steering_command.data() + o, trial_acceleration.data() + o, trial_x.data() + o, trial_y.data() + o,
+           trial_yaw.data() + o, trial_speed.data() + o, trial_steering.data() + o );
+  double trial_cost = evaluate_cost( k, trial_x.data() + o, trial_y.data() + o, trial_steering_command.data() + o,
+                                     trial_acceleration.data() + o, cost_gradient_x.data() + o, cost_gradient_y.data() + o );
+
+  double ratio = predicted_reduction > 0.0 ? ( cost - trial_cost ) / predicted_reduction : -1.0;
+
+  if( ratio < 0.25 )
+    trust_radius[k] *= 0.5;
+  else if( ratio > 0.75 && step_norm > 0.8 * trust_radius[k] )
+    trust_radius[k] = std::min( 2.0 * trust_radius[k], delta_max );
+
+  if( ratio <= eta )
+    return;
+
+  backpropagate( k, trial_yaw.data() + o, trial_speed.data() + o, trial_steering.data() + o, trial_steering_command.data() + o,
+                 trial_acceleration.data() + o, cost_gradient_x.data() + o, cost_gradient_y.data() + o,
+                 trial_gradient_steering.data() + o, trial_gradient_acceleration.data() + o );
+  update_hessian( k );
+
+  for( auto [source, target] : { std::make_pair( &trial_steering_command, &steering_command ), std::make_pair( &trial_acceleration, &acceleration ),
+                                 std::make_pair( &trial_yaw, &yaw ), std::make_pair( &trial_speed, &speed ),
+                                 std::make_pair( &trial_steering, &steering ), std::make_pair( &trial_x, &next_position_x ),
+                                 std::make_pair( &trial_y, &next_position_y ) } )
+    std::copy( source->begin() + o, source->begin() + o + n, target->begin() + o );
+  agent_cost[k]     = trial_cost;
+  agent_accepted[k] = 1;
+}
+
+void
+TrustRegionSolver::rollout( size_t k, const double* controls_steering, const double* controls_acceleration, double* x, double* y,
+                            double* yaws, double* speeds, double* steerings ) const
+{
+  const size_t o = offset[k];
+  const double L = wheelbase[k];
+  const double h = step_time;
+
+  x[0]         = reference_x[o];
+  y[0]         = reference_y[o];
+  yaws[0]      = yaw[o];
+  speeds[0]    = speed[o];
+  steerings[0] = steering[o];
+  for( size_t i = 1; i < steps[k]; ++i )
+  {
+    double v     = speeds[i - 1];
+    double psi   = yaws[i - 1];
+    x[i]         = x[i - 1] + v * std::cos( psi ) * h;
+    y[i]         = y[i - 1] + v * std::sin( psi ) * h;
+    yaws[i]      = psi + v * std::tan( steerings[i - 1] ) / L * h;
+    speeds[i]    = v + controls_acceleration[i - 1] * h;
+    steerings[i] = controls_steering[i - 1];
+  }
+}
+
+double
+TrustRegionSolver::evaluate_cost( size_t k, const double* x, const double* y, const double* controls_steering,
+                                  const double* controls_acceleration, double* gradient_x, double* gradient_y ) const
+{
+  const size_t o    = offset[k];
+  const size_t n    = steps[k];
+  double       cost = 0.0;
+
+  for( size_t i = 0; i + 1 < n; ++i )
+    cost += effort_weight * ( controls_steering[i] * controls_steering[i] + controls_acceleration[i] * controls_acceleration[i] );
+
+  gradient_x[0] = 0.0;
+  gradient_y[0] = 0.0;
+  for( size_t i = 1; i < n; ++i )
+  {
+    double dx      = x[i] - reference_x[o + i];
+    double dy      = y[i] - reference_y[o + i];
+    cost          += tracking_weight * ( dx * dx + dy * dy );
+    gradient_x[i]  = 2.0 * tracking_weight * dx;
+    gradient_y[i]  = 2.0 * tracking_weight * dy;
+  }
+
+  // ( safe_distance^2 - d^2 )^2 inside the safe distance, continuous gradient at the border
+  const double safe_distance_squared = safe_distance * safe_distance;
+  for( size_t e = neighbor_offset[k]; e < neighbor_offset[k + 1]; ++e )
+  {
+    const Neighbor& neighbor = neighbors[e];
+    const size_t    other    = offset[neighbor.other];
+    for( size_t i = std::max<size_t>( neighbor.first_step, 1 ); i <= neighbor.last_step; ++i )
+    {
+      double dx               = x[i] - position_x[other + i];
+      double dy               = y[i] - position_y[other + i];
+      double distance_squared = dx * dx + dy * dy;
+      if( distance_squared >= safe_distance_squared )
+        continue;
+      double penetration  = safe_distance_squared - distance_squared;
+      cost               += collision_weight * penetration * penetration;
+      gradient_x[i]      -= 4.0 * collision_weight * penetration * dx;
+      gradient_y[i]      -= 4.0 * collision_weight * penetration * dy;
+    }
+  }
+  return cost;
+}
+
+void
+TrustRegionSolver::backpropagate( size_t k, const double* yaws, const double* speeds, const double* steerings, const double* controls_steering,
+                                  const double* controls_acceleration, const double* gradient_x, const double* gradient_y,
+                                  double* gradient_steering_out, double* gradient_acceleration_out ) const
+{
+  const size_t n = steps[k];
+  const double L = wheelbase[k];
+  const double h = step_time;
+
+  // Sensitivities of the cost to the states x, y, yaw, v, steering of the current step
+  double lambda_x = 0.0, lambda_y = 0.0, lambda_yaw = 0.0, lambda_v = 0.0, lambda_steering = 0.0;
+  gradient_steering_out[n - 1]     = 0.0;
+  gradient_acceleration_out[n - 1] = 0.0;
+  for( size_t i = n - 1; i >= 1; --i )
+  {
+    lambda_x += gradient_x[i];
+    lambda_y += gradient_y[i];
+
+    // Control i - 1 sets the steering of step i and changes the speed of step i
+    gradient_steering_out[i - 1]     = 2.0 * effort_weight * controls_steering[i - 1] + lambda_steering;
+    gradient_acceleration_out[i - 1] = 2.0 * effort_weight * controls_acceleration[i - 1] + h * lambda_v;
+
+    // Transposed Jacobian of the Euler step from step i - 1
+    double v         = speeds[i - 1];
+    double psi       = yaws[i - 1];
+    double delta     = steerings[i - 1];
+    double cos_delta = std::cos( delta );
+    double previous_lambda_yaw      = lambda_yaw + h * v * ( -std::sin( psi ) * lambda_x + std::cos( psi ) * lambda_y );
+    double previous_lambda_v        = lambda_v + h * ( std::cos( psi ) * lambda_x + std::sin( psi ) * lambda_y + std::tan( delta ) / L * lambda_yaw );
+    double previous_lambda_steering = h * v / ( L * cos_delta * cos_delta ) * lambda_yaw;
+
+    lambda_yaw      = previous_lambda_yaw;
+    lambda_v        = previous_lambda_v;
+    lambda_steering = previous_lambda_steering;
+  }
+}
+
+void
+TrustRegionSolver::solve_subproblem( size_t k )
+{
+  const size_t o        = offset[k];
+  const size_t controls = steps[k] - 1;
+  const double delta    = trust_radius[k];
+
+  // Newton step of every block, the blocks stay positive definite
+  double newton_norm   = 0.0;
+  double gradient_norm = 0.0;
+  double curvature     = 0.0;
+  for( size_t i = 0; i < controls; ++i )
+  {
+    Eigen::Vector2d gradient( gradient_steering[o + i], gradient_acceleration[o + i] );
+    Eigen::Vector2d newton  = -hessian[o + i].ldlt().solve( gradient );
+    step_steering[o + i]     = newton( 0 );
+    step_acceleration[o + i] = newton( 1 );
+    newton_norm             += newton.squaredNorm();
+    gradient_norm           += gradient.squaredNorm();
+    curvature               += gradient.dot( hessian[o + i] * gradient );
+  }
+  newton_norm   = std::sqrt( newton_norm );
+  gradient_norm = std::sqrt( gradient_norm );
+  if( newton_norm <= delta )
+    return;
+
+  // Cauchy point along the negative gradient, cut at the trust region if it lies outside
+  double cauchy_scale = gradient_norm * gradient_norm / curvature;
+  if( cauchy_scale * gradient_norm >= delta )
+  {
+    double scale = delta / gradient_norm;
+    for( size_t i = 0; i < controls; ++i )
+    {
+      step_steering[o + i]     = -scale * gradient_steering[o + i];
+      step_acceleration[o + i] = -scale * gradient_acceleration[o + i];
+    }
+    return;
+  }
+
+  // Dogleg, the point on the segment from the Cauchy point to the Newton step on the trust region border
+  double a = 0.0, b = 0.0, c = 0.0;
+  for( size_t i = 0; i < controls; ++i )
+  {
+    Eigen::Vector2d cauchy( -cauchy_scale * gradient_steering[o + i], -cauchy_scale * gradient_acceleration[o + i] );
+    Eigen::Vector2d direction = Eigen::Vector2d( step_steering[o + i], step_acceleration[o + i] ) - cauchy;
+    a += direction.squaredNorm();
+    b += 2.0 * cauchy.dot( direction );
+    c += cauchy.squaredNorm();
+  }
+  c          -= delta * delta;
+  double tau  = ( -b + std::sqrt( std::max( b * b - 4.0 * a * c, 0.0 ) ) ) / ( 2.0 * a );
+  for( size_t i = 0; i < controls; ++i )
+  {
+    double cauchy_steering     = -cauchy_scale * gradient_steering[o + i];
+    double cauchy_acceleration = -cauchy_scale * gradient_acceleration[o + i];
+    step_steering[o + i]       = cauchy_steering + tau * ( step_steering[o + i] - cauchy_steering );
+    step_acceleration[o + i]   = cauchy_acceleration + tau * ( step_acceleration[o + i] - cauchy_acceleration );
+  }
+}
+
+void
+TrustRegionSolver::update_hessian( size_t k )
+{
+  const size_t o        = offset[k];
+  const size_t controls = steps[k] - 1;
+
+  // BFGS update of every block with its part of the step and the gradient change, skipped where it would lose
+  // positive definiteness
+  for( size_t i = 0; i < controls; ++i )
+  {
+    Eigen::Vector2d s( step_steering[o + i], step_acceleration[o + i] );
+    Eigen::Vector2d y( trial_gradient_steering[o + i] - gradient_steering[o + i],
+                       trial_gradient_acceleration[o + i] - gradient_acceleration[o + i] );
+    double          sy = s.dot( y );
+    if( sy <= 1e-10 * s.norm() * y.norm() || sy <= 0.0 )
+      continue;
+    Eigen::Vector2d Bs  = hessian[o + i] * s;
+    double          sBs = s.dot( Bs );
+    if( sBs <= 0.0 )
+      continue;
+    hessian[o + i] += y * y.transpose() / sy - Bs * Bs.transpose() / sBs;
+  }
+}
+
+} // namespace planner
+} // namespace adore